@@ -0,0 +1,89 @@
+// Whole-playlist time over 1M tracks: summing a duration per entry (time
+// before the current track, which track holds 3h12m) against the Fenwick
+// tree in DurationIndex, plus the cost of keeping the tree current as
+// durations arrive one by one.
+//   make bench && ./build/bin/bench/duration_bench
+#include "duration_index.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const size_t ENTRIES = 1000000;
+static const int QUERIES = 1000;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::mt19937 rng(5);
+    std::vector<int64_t> ms(ENTRIES);
+    for (int64_t& d : ms) d = 120000 + rng() % 240000;
+    int64_t total = 0;
+    for (int64_t d : ms) total += d;
+    std::vector<size_t> positions(QUERIES);
+    std::vector<int64_t> times(QUERIES);
+    for (int i = 0; i < QUERIES; i++) {
+        positions[i] = rng() % ENTRIES;
+        times[i] = std::uniform_int_distribution<int64_t>(0, total - 1)(rng);
+    }
+
+    std::printf("%zu entries\n", ENTRIES);
+    std::printf("%-24s %14s %14s\n", "", "linear", "DurationIndex");
+    int64_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    DurationIndex index;
+    index.build(ms);
+    double built = since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t p : positions) {
+        int64_t before = 0;
+        for (size_t i = 0; i < p; i++) before += ms[i];
+        sink += before;
+    }
+    double linear = since(start) / QUERIES;
+    start = std::chrono::steady_clock::now();
+    for (size_t p : positions) sink += index.prefix(p);
+    double tree = since(start) / QUERIES;
+    std::printf("%-24s %11.2f us %11.3f us\n", "time before current", linear, tree);
+
+    start = std::chrono::steady_clock::now();
+    for (int64_t t : times) {
+        size_t i = 0;
+        int64_t at = 0;
+        while (i + 1 < ENTRIES && at + ms[i] <= t) at += ms[i++];
+        sink += i + (t - at);
+    }
+    linear = since(start) / QUERIES;
+    start = std::chrono::steady_clock::now();
+    for (int64_t t : times) {
+        int64_t offset;
+        sink += index.find(t, &offset) + offset;
+    }
+    tree = since(start) / QUERIES;
+    std::printf("%-24s %11.2f us %11.3f us\n", "seek to a playlist time", linear, tree);
+
+    // A duration arrives from a tag worker
+    start = std::chrono::steady_clock::now();
+    for (size_t p : positions) {
+        ms[p] += 1000;
+        sink += ms[p];
+    }
+    linear = since(start) / QUERIES;
+    start = std::chrono::steady_clock::now();
+    for (size_t p : positions) index.set(p, ms[p]);
+    tree = since(start) / QUERIES;
+    std::printf("%-24s %11.3f us %11.3f us\n", "duration arrives", linear, tree);
+
+    DurationIndex grown;
+    start = std::chrono::steady_clock::now();
+    for (int64_t d : ms) grown.append(d);
+    double appended = since(start) * 1000.0 / ENTRIES;
+    std::printf("%-24s %14s %11.1f ms\n", "build after reorder", "", built / 1000.0);
+    std::printf("%-24s %14s %11.1f ns\n", "append", "", appended);
+    std::printf("%-24s %14s %11.1f MB\n", "memory", "", index.memoryBytes() / 1e6);
+    return sink == 42 && grown.total() == index.total() ? 1 : 0;
+}
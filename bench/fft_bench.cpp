@@ -0,0 +1,52 @@
+// Micro-benchmark of the visualizer FFT kernel (FFT::magnitudes)
+//   make bench && ./build/bin/bench/fft_bench
+#include "fft.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__aarch64__)
+static const char* ARCH = "aarch64";
+#elif defined(__arm__)
+static const char* ARCH = "arm";
+#elif defined(__x86_64__)
+static const char* ARCH = "x86_64";
+#elif defined(__i386__)
+static const char* ARCH = "x86";
+#else
+static const char* ARCH = "unknown";
+#endif
+
+int main() {
+    std::printf("FFT kernel benchmark (%s)\n", ARCH);
+    std::printf("%8s %12s %12s\n", "points", "ns/frame", "MFLOPS");
+
+    for (size_t n : {512, 1024, 2048}) {
+        FFT fft(n);
+        std::vector<float> samples(n), mags(n / 2);
+        for (size_t i = 0; i < n; i++) {
+            samples[i] = (float)(std::sin(0.05 * i) + 0.25 * std::sin(0.7 * i));
+        }
+
+        // Warm up caches and twiddles, then run for roughly half a second
+        for (int i = 0; i < 1000; i++) fft.magnitudes(samples.data(), mags.data());
+
+        size_t iterations = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed(0);
+        while (elapsed.count() < 0.5) {
+            for (int i = 0; i < 1000; i++) fft.magnitudes(samples.data(), mags.data());
+            iterations += 1000;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+
+        double ns = elapsed.count() * 1e9 / iterations;
+        double flops = 5.0 * n * std::log2((double)n);
+        std::printf("%8zu %12.1f %12.1f\n", n, ns, flops / ns * 1e3);
+
+        // Keep the result observable
+        if (mags[1] < 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// The two engine pipelines (see pipeline.h), playbin and lean, each in a
+// fresh process: time to build the pipeline and preroll the first track
+// (plugins load here), preroll time per track over the next 50 loads, and
+// the process's resident memory after them. Uses the given files, or
+// writes two 10 s WAVs to /tmp. The sink can be named, e.g. fakesink on a
+// machine without audio:
+//   make bench-gst && ./build/bin/bench/gst_backend_bench [sink] [files...]
+#include "pipeline.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const int LOADS = 50;
+
+static bool writeWav(const char* path, int seconds, double hz) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t rate = 44100, frames = rate * seconds, bytes = frames * 4;
+    auto u32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto u16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    u32(36 + bytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    u32(16);            // PCM, stereo, 16-bit
+    u16(1);
+    u16(2);
+    u32(rate);
+    u32(rate * 4);
+    u16(4);
+    u16(16);
+    std::fwrite("data", 1, 4, f);
+    u32(bytes);
+    std::vector<int16_t> frame(2);
+    for (uint32_t i = 0; i < frames; i++) {
+        frame[0] = frame[1] = (int16_t)(2000 * std::sin(i * 2 * M_PI * hz / rate));
+        std::fwrite(frame.data(), 2, 2, f);
+    }
+    std::fclose(f);
+    return true;
+}
+
+// VmRSS or VmHWM from /proc/self/status, in MB
+static double memoryMb(const char* field) {
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    double kb = 0;
+    size_t len = std::strlen(field);
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, field, len) == 0 && line[len] == ':') {
+            kb = std::atof(line + len + 1);
+            break;
+        }
+    }
+    std::fclose(f);
+    return kb / 1024.0;
+}
+
+// READY, new URI, PAUSED and wait for the preroll: ms, or -1 on failure
+static double preroll(GstElement* bin, const std::string& uri) {
+    gint64 start = g_get_monotonic_time();
+    gst_element_set_state(bin, GST_STATE_READY);
+    Pipeline::setUri(bin, uri.c_str());
+    gst_element_set_state(bin, GST_STATE_PAUSED);
+    GstState state = GST_STATE_NULL;
+    bool ok = gst_element_get_state(bin, &state, NULL, 5 * GST_SECOND) == GST_STATE_CHANGE_SUCCESS &&
+              state == GST_STATE_PAUSED;
+    double ms = (g_get_monotonic_time() - start) / 1000.0;
+
+    GstBus* bus = gst_element_get_bus(bin);
+    while (GstMessage* msg = gst_bus_pop(bus)) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) ok = false;
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    return ok ? ms : -1;
+}
+
+// Child process: one backend from gst_init on
+static int run(PipelineBackend backend, const char* sink, const std::vector<std::string>& uris) {
+    gint64 start = g_get_monotonic_time();
+    gst_init(NULL, NULL);
+    double initMs = (g_get_monotonic_time() - start) / 1000.0;
+    double initRss = memoryMb("VmRSS");
+
+    start = g_get_monotonic_time();
+    GstElement* tap;
+    GstElement* bin = Pipeline::create(backend, NULL, sink, &tap);
+    if (!bin || preroll(bin, uris[0]) < 0) {
+        std::fprintf(stderr, "%s: could not preroll %s\n", Pipeline::backendName(backend), uris[0].c_str());
+        return 1;
+    }
+    double firstMs = (g_get_monotonic_time() - start) / 1000.0;
+
+    std::vector<double> ms;
+    for (int i = 1; i <= LOADS; i++) {
+        double t = preroll(bin, uris[i % uris.size()]);
+        if (t < 0) {
+            std::fprintf(stderr, "%s: could not preroll %s\n", Pipeline::backendName(backend),
+                         uris[i % uris.size()].c_str());
+            return 1;
+        }
+        ms.push_back(t);
+    }
+    double rss = memoryMb("VmRSS"), peak = memoryMb("VmHWM");
+    gst_element_set_state(bin, GST_STATE_NULL);
+    gst_object_unref(bin);
+
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double t : ms) sum += t;
+    std::printf("%-8s %7.1f ms %7.1f ms %7.1f ms %7.1f ms %7.1f ms %7.1f MB %7.1f MB %7.1f MB\n",
+                Pipeline::backendName(backend), initMs, firstMs, sum / ms.size(), ms[ms.size() / 2],
+                ms.back(), initRss, rss, peak);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* sink = argc > 1 ? argv[1] : "autoaudiosink";
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        const char* wavs[] = {"/tmp/termamp-backend-a.wav", "/tmp/termamp-backend-b.wav"};
+        for (int i = 0; i < 2; i++) {
+            if (!writeWav(wavs[i], 10, 440.0 * (i + 1))) {
+                std::fprintf(stderr, "Could not write to /tmp\n");
+                return 1;
+            }
+            paths.push_back(wavs[i]);
+        }
+    }
+    std::vector<std::string> uris;
+    for (const std::string& path : paths) {
+        gchar* uri = g_filename_to_uri(path.c_str(), NULL, NULL);
+        if (uri) uris.push_back(uri);
+        g_free(uri);
+    }
+    if (uris.empty()) {
+        std::fprintf(stderr, "Give absolute paths\n");
+        return 1;
+    }
+
+    std::printf("%zu files into %s, %d prerolls after the first\n", uris.size(), sink, LOADS);
+    std::printf("%-8s %10s %10s %10s %10s %10s %10s %10s %10s\n", "", "gst_init", "first",
+                "mean", "p50", "worst", "RSS init", "RSS", "peak");
+    std::fflush(stdout);
+    int failed = 0;
+    for (PipelineBackend backend : {BACKEND_PLAYBIN, BACKEND_LEAN}) {
+        // A process each: plugins one backend loaded must not count for the other
+        pid_t pid = fork();
+        if (pid == 0) {
+            int code = run(backend, sink, uris);
+            std::fflush(stdout);
+            _exit(code);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+    return failed;
+}
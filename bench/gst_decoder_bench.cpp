@@ -0,0 +1,145 @@
+// The lean pipeline (see pipeline.h) loading tracks by autoplugging against
+// loading them from the decoder cache (see decoder_cache.h): 100 prerolls
+// each, interleaved, after one untimed autoplugged load per file that loads
+// the plugins and teaches the cache. Times READY to prerolled PAUSED. Uses
+// the given files (a mix of formats shows more), or writes two 10 s WAVs to
+// /tmp. The sink can be named, e.g. fakesink on a machine without audio:
+//   make bench-gst && ./build/bin/bench/gst_decoder_bench [sink] [files...]
+#include "decoder_cache.h"
+#include "pipeline.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const int LOADS = 100;
+
+static bool writeWav(const char* path, int seconds, double hz) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t rate = 44100, frames = rate * seconds, bytes = frames * 4;
+    auto u32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto u16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    u32(36 + bytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    u32(16);            // PCM, stereo, 16-bit
+    u16(1);
+    u16(2);
+    u32(rate);
+    u32(rate * 4);
+    u16(4);
+    u16(16);
+    std::fwrite("data", 1, 4, f);
+    u32(bytes);
+    std::vector<int16_t> frame(2);
+    for (uint32_t i = 0; i < frames; i++) {
+        frame[0] = frame[1] = (int16_t)(2000 * std::sin(i * 2 * M_PI * hz / rate));
+        std::fwrite(frame.data(), 2, 2, f);
+    }
+    std::fclose(f);
+    return true;
+}
+
+// READY, new source, PAUSED and wait for the preroll: ms, or -1 on failure.
+// An empty chain autoplugs.
+static double preroll(GstElement* bin, const std::string& path, const std::string& chain) {
+    gint64 start = g_get_monotonic_time();
+    gst_element_set_state(bin, GST_STATE_READY);
+    if (chain.empty()) {
+        gchar* uri = g_filename_to_uri(path.c_str(), NULL, NULL);
+        Pipeline::setUri(bin, uri);
+        g_free(uri);
+    } else if (!Pipeline::setChain(bin, path.c_str(), chain)) {
+        return -1;
+    }
+    gst_element_set_state(bin, GST_STATE_PAUSED);
+    GstState state = GST_STATE_NULL;
+    bool ok = gst_element_get_state(bin, &state, NULL, 5 * GST_SECOND) == GST_STATE_CHANGE_SUCCESS &&
+              state == GST_STATE_PAUSED;
+    double ms = (g_get_monotonic_time() - start) / 1000.0;
+
+    GstBus* bus = gst_element_get_bus(bin);
+    while (GstMessage* msg = gst_bus_pop(bus)) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) ok = false;
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    return ok ? ms : -1;
+}
+
+struct Run {
+    std::vector<double> ms;
+    void print(const char* label) {
+        if (ms.empty()) return;
+        std::sort(ms.begin(), ms.end());
+        double sum = 0;
+        for (double m : ms) sum += m;
+        std::printf("%-12s %8.2f ms %8.2f ms %8.2f ms %8.2f ms\n", label, sum / ms.size(),
+                    ms[ms.size() / 2], ms[(size_t)(0.99 * (ms.size() - 1))], ms.back());
+    }
+};
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    const char* sink = argc > 1 ? argv[1] : "autoaudiosink";
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        const char* wavs[] = {"/tmp/termamp-decoder-a.wav", "/tmp/termamp-decoder-b.wav"};
+        for (int i = 0; i < 2; i++) {
+            if (!writeWav(wavs[i], 10, 440.0 * (i + 1))) {
+                std::fprintf(stderr, "Could not write to /tmp\n");
+                return 1;
+            }
+            paths.push_back(wavs[i]);
+        }
+    }
+
+    GstElement* tap;
+    GstElement* bin = Pipeline::create(BACKEND_LEAN, NULL, sink, &tap);
+    if (!bin) {
+        std::fprintf(stderr, "No uridecodebin or %s\n", sink);
+        return 1;
+    }
+
+    // A fresh cache: this run's chains only
+    const char* cacheFile = "/tmp/termamp-decoders-bench";
+    std::remove(cacheFile);
+    DecoderCache cache(cacheFile);
+    for (const std::string& path : paths) {
+        std::string chain, caps;
+        if (preroll(bin, path, "") < 0 || !Pipeline::autoplugged(bin, &chain, &caps)) {
+            std::fprintf(stderr, "Could not autoplug %s\n", path.c_str());
+            return 1;
+        }
+        std::string signature = DecoderCache::signature(path);
+        cache.put(signature, caps, chain);
+        std::printf("%-20s %s\n  %s\n", signature.c_str(), chain.c_str(), caps.c_str());
+    }
+
+    Run autoplug, cached;
+    for (int i = 0; i < LOADS; i++) {
+        size_t f = i % paths.size();
+        std::string chain;
+        cache.lookup(DecoderCache::signature(paths[f]), &chain);
+        double a = preroll(bin, paths[f], "");
+        double c = preroll(bin, paths[f], chain);
+        if (a < 0 || c < 0) {
+            std::fprintf(stderr, "Could not preroll %s (%s)\n", paths[f].c_str(), a < 0 ? "autoplug" : "cached");
+            return 1;
+        }
+        autoplug.ms.push_back(a);
+        cached.ms.push_back(c);
+    }
+    gst_element_set_state(bin, GST_STATE_NULL);
+    gst_object_unref(bin);
+
+    std::printf("%zu files into %s, %d prerolls each way\n", paths.size(), sink, LOADS);
+    std::printf("%-12s %11s %11s %11s %11s\n", "", "mean", "p50", "p99", "worst");
+    autoplug.print("autoplug");
+    cached.print("cached chain");
+    return 0;
+}
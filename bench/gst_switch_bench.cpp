@@ -0,0 +1,122 @@
+// Track switches on one playbin, as the engine does them: 200 loads that
+// tear the pipeline down to NULL before the new URI (closing the audio
+// device and dropping the sink) against 200 that only go down to READY
+// with the sink kept. Times each load until the pipeline is PLAYING.
+// Writes two 10 s WAVs with the same caps to /tmp. Needs GStreamer and an
+// audio device; the sink can be named, e.g. pulsesink or fakesink:
+//   make bench-gst && ./build/bin/bench/gst_switch_bench [sink]
+#include "pipeline.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const int LOADS = 200;
+
+static bool writeWav(const char* path, int seconds, double hz) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t rate = 44100, frames = rate * seconds, bytes = frames * 4;
+    auto u32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto u16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    u32(36 + bytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    u32(16);            // PCM, stereo, 16-bit
+    u16(1);
+    u16(2);
+    u32(rate);
+    u32(rate * 4);
+    u16(4);
+    u16(16);
+    std::fwrite("data", 1, 4, f);
+    u32(bytes);
+    std::vector<int16_t> frame(2);
+    for (uint32_t i = 0; i < frames; i++) {
+        frame[0] = frame[1] = (int16_t)(2000 * std::sin(i * 2 * M_PI * hz / rate));
+        std::fwrite(frame.data(), 2, 2, f);
+    }
+    std::fclose(f);
+    return true;
+}
+
+// False on an error message: the run is meaningless after it
+static bool drainBus(GstElement* bin) {
+    GstBus* bus = gst_element_get_bus(bin);
+    bool ok = true;
+    while (GstMessage* msg = gst_bus_pop(bus)) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* error = NULL;
+            gst_message_parse_error(msg, &error, NULL);
+            std::fprintf(stderr, "error: %s\n", error ? error->message : "?");
+            if (error) g_error_free(error);
+            ok = false;
+        }
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    return ok;
+}
+
+struct Run {
+    std::vector<double> ms;
+    void print(const char* label) {
+        if (ms.empty()) return;
+        std::sort(ms.begin(), ms.end());
+        double sum = 0;
+        for (double m : ms) sum += m;
+        std::printf("%-22s %8.1f ms %8.1f ms %8.1f ms %8.1f ms\n", label, sum / ms.size(),
+                    ms[ms.size() / 2], ms[(size_t)(0.99 * (ms.size() - 1))], ms.back());
+    }
+};
+
+static bool switches(const char* sinkName, GstState down, const std::vector<std::string>& uris, Run* run) {
+    // Set up as the engine does: one sink kept for the pipeline's lifetime
+    GstElement* tap;
+    GstElement* bin = Pipeline::create(BACKEND_PLAYBIN, NULL, sinkName, &tap);
+    if (!bin) {
+        std::fprintf(stderr, "No playbin or %s\n", sinkName);
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < LOADS && ok; i++) {
+        gint64 start = g_get_monotonic_time();
+        gst_element_set_state(bin, down);
+        Pipeline::setUri(bin, uris[i % uris.size()].c_str());
+        gst_element_set_state(bin, GST_STATE_PLAYING);
+        GstState state = GST_STATE_NULL;
+        ok = gst_element_get_state(bin, &state, NULL, 5 * GST_SECOND) == GST_STATE_CHANGE_SUCCESS &&
+             state == GST_STATE_PLAYING;
+        run->ms.push_back((g_get_monotonic_time() - start) / 1000.0);
+        ok = drainBus(bin) && ok;
+    }
+    gst_element_set_state(bin, GST_STATE_NULL);
+    gst_object_unref(bin);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    const char* sink = argc > 1 ? argv[1] : "autoaudiosink";
+    std::vector<std::string> uris;
+    const char* paths[] = {"/tmp/termamp-switch-a.wav", "/tmp/termamp-switch-b.wav"};
+    for (int i = 0; i < 2; i++) {
+        if (!writeWav(paths[i], 10, 440.0 * (i + 1))) {
+            std::fprintf(stderr, "Could not write to /tmp\n");
+            return 1;
+        }
+        gchar* uri = gst_filename_to_uri(paths[i], NULL);
+        uris.push_back(uri);
+        g_free(uri);
+    }
+
+    Run null, ready;
+    if (!switches(sink, GST_STATE_NULL, uris, &null) || !switches(sink, GST_STATE_READY, uris, &ready)) return 1;
+    std::printf("%d loads into %s, until PLAYING\n", LOADS, sink);
+    std::printf("%-22s %11s %11s %11s %11s\n", "", "mean", "p50", "p99", "worst");
+    null.print("through NULL");
+    ready.print("through READY");
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Library index: compaction, open (map + validate), O(1) lookups and
+// journal replay at 200k entries; then a delta rescan over the files that
+// tags_bench generates (full read vs stat-only for unchanged files).
+//   make bench && ./build/bin/bench/library_bench
+#include "library.h"
+#include "tags.h"
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static const size_t ENTRIES = 200000;
+static const size_t JOURNAL = 4000;   // below the compact-at-open threshold
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string pathOf(size_t i) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "/sdcard/Music/Artist %03zu/Album %02zu/%02zu - Track %zu.flac",
+                  i / 2000, (i / 50) % 40, i % 50 + 1, i);
+    return buf;
+}
+
+static TrackInfo infoOf(size_t i) {
+    TrackInfo info;
+    info.title = "Track " + std::to_string(i);
+    info.artist = "Artist " + std::to_string(i / 2000);
+    info.album = "Album " + std::to_string((i / 50) % 40);
+    info.duration = 180 + i % 120;
+    return info;
+}
+
+static void removeDir(const std::string& dir) {
+    for (const char* name : {"library.idx", "library.journal", "library.idx.tmp"}) {
+        unlink((dir + "/" + name).c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+static size_t fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+static void indexBench(const std::string& dir) {
+    removeDir(dir);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < ENTRIES; i++) paths.push_back(pathOf(i));
+
+    {
+        Library library(dir);
+        for (size_t i = 0; i < ENTRIES; i++) {
+            FileStamp stamp;
+            stamp.mtime = 1700000000000000000ll + i;
+            stamp.size = 4000000 + i;
+            library.put(paths[i], stamp, infoOf(i));
+        }
+        library.flush();
+        std::printf("journal:  %zu records, %.1f MB\n", ENTRIES, fileSize(dir + "/library.journal") / 1e6);
+        auto start = std::chrono::steady_clock::now();
+        library.compact();
+        std::printf("compact:  %.1f ms\n", since(start));
+    }
+    size_t bytes = fileSize(dir + "/library.idx");
+    std::printf("index:    %.1f MB, %.1f bytes/entry\n", bytes / 1e6, (double)bytes / ENTRIES);
+
+    auto start = std::chrono::steady_clock::now();
+    Library* library = new Library(dir);
+    std::printf("open:     %.3f ms (%zu entries)\n", since(start), library->size());
+
+    // First pass faults the index pages in; the second is steady state
+    LibraryEntry entry;
+    for (const char* pass : {"first", "again"}) {
+        size_t hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ENTRIES; i++) {
+            if (library->lookup(paths[(i * 7919) % ENTRIES], &entry)) hits++;
+        }
+        std::printf("lookup:   %.0f ns/hit, %s (%zu hits)\n", since(start) * 1e6 / ENTRIES, pass, hits);
+    }
+
+    std::string missing = "/sdcard/Music/Not There.mp3";
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ENTRIES; i++) {
+        missing.back() = 'a' + i % 26;
+        library->lookup(missing, &entry);
+    }
+    std::printf("miss:     %.0f ns/lookup\n", since(start) * 1e6 / ENTRIES);
+
+    // Journal replay on top of the mapped index
+    for (size_t i = 0; i < JOURNAL; i++) {
+        FileStamp stamp;
+        stamp.size = 1;
+        library->put(pathOf(ENTRIES + i), stamp, infoOf(ENTRIES + i));
+    }
+    library->flush();
+    // Leak the instance so its destructor does not compact the journal away
+    library = nullptr;
+    start = std::chrono::steady_clock::now();
+    {
+        Library reopened(dir);
+        std::printf("reopen:   %.1f ms with %zu journal records\n", since(start), reopened.journalRecords());
+    }
+    removeDir(dir);
+}
+
+// Rescan: every file read once, then again with stamps from the index
+static void rescanBench(const std::string& root, const std::string& dir) {
+    DIR* d = opendir(root.c_str());
+    if (!d) {
+        std::printf("rescan:   skipped (run tags_bench first to generate %s)\n", root.c_str());
+        return;
+    }
+    std::vector<std::string> paths;
+    while (struct dirent* e = readdir(d)) {
+        if (e->d_name[0] != '.') paths.push_back(root + "/" + e->d_name);
+    }
+    closedir(d);
+
+    removeDir(dir);
+    Library library(dir);
+    TagReader reader;
+    TagView view;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        if (reader.read(path, &view)) library.put(path, view.stamp, view.toInfo());
+    }
+    library.flush();
+    double full = since(start);
+
+    size_t unchanged = 0;
+    LibraryEntry entry;
+    start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        struct stat st;
+        if (library.lookup(path, &entry) && stat(path.c_str(), &st) == 0 &&
+            entry.stamp.size == (uint64_t)st.st_size &&
+            entry.stamp.mtime == (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec) {
+            unchanged++;
+        } else if (reader.read(path, &view)) {
+            library.put(path, view.stamp, view.toInfo());
+        }
+    }
+    double delta = since(start);
+    std::printf("rescan:   %zu files, full read %.1f ms, delta %.1f ms (%zu unchanged)\n", paths.size(),
+                full, delta, unchanged);
+    removeDir(dir);
+}
+
+int main() {
+    std::string dir = "/tmp/termamp-library-bench";
+    indexBench(dir);
+    rescanBench("/tmp/termamp-tags-bench", dir);
+    return 0;
+}
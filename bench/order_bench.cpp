@@ -0,0 +1,203 @@
+// Row activation and shuffle toggling at 1M entries: the previous linear
+// scans over a std::vector<size_t> play order against PlayOrder's inverse.
+// Also adding a 1k-track album with shuffle on: reshuffling everything
+// (the old way to get it shuffled in) against PlayOrder::extendShuffled.
+// Next-track latency and memory compare a shuffled vector against the
+// keyed permutation PlayOrder uses right after a shuffle.
+// Deleting 10k selected rows of a shuffled 100k playlist: one erase per row
+// from the handle and track arrays and an order/inverse array pair (the
+// old delete), against the single compaction PlaylistManager::deleteSelected
+// does.
+//   make bench && ./build/bin/bench/order_bench
+#include "play_order.h"
+#include "tags.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+static const size_t ENTRIES = 1000000;
+static const int CLICKS = 1000;
+static const int TOGGLES = 10;
+static const size_t ALBUM = 1000;
+static const size_t ROWS = 100000;
+static const size_t SELECTED = 10000;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Before: find the clicked playlist index in the shuffled order
+static size_t scan(const std::vector<size_t>& order, size_t index) {
+    for (size_t i = 0; i < order.size(); i++) {
+        if (order[i] == index) return i;
+    }
+    return 0;
+}
+
+// Before: drop one entry from an order and its inverse, renumbering the rest
+static void eraseOne(std::vector<uint32_t>& order, std::vector<uint32_t>& pos, size_t index) {
+    size_t gone = pos[index];
+    order.erase(order.begin() + gone);
+    pos.erase(pos.begin() + index);
+    for (uint32_t& i : order) {
+        if (i > index) i--;
+    }
+    for (uint32_t& p : pos) {
+        if (p > gone) p--;
+    }
+}
+
+int main() {
+    std::mt19937 rng(7);
+    std::vector<size_t> rows(CLICKS);
+    for (size_t& r : rows) r = rng() % ENTRIES;
+
+    std::vector<size_t> vec(ENTRIES);
+    std::iota(vec.begin(), vec.end(), 0);
+    std::shuffle(vec.begin(), vec.end(), std::default_random_engine(1));
+    PlayOrder order;
+    order.reset(ENTRIES);
+    order.shuffle(1);
+
+    std::printf("%zu entries\n", ENTRIES);
+    std::printf("%-22s %14s %14s\n", "", "vector + scan", "PlayOrder");
+
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r : rows) sink += scan(vec, r);
+    double before = since(start) * 1000.0 / CLICKS;
+    start = std::chrono::steady_clock::now();
+    for (size_t r : rows) sink += order.positionOf(r);
+    double after = since(start) * 1000.0 / CLICKS;
+    std::printf("%-22s %11.2f us %11.3f us\n", "row activation", before, after);
+
+    // Shuffle on: permute, then find the current track again
+    size_t current = ENTRIES / 2;
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < TOGGLES; t++) {
+        std::shuffle(vec.begin(), vec.end(), std::default_random_engine(t));
+        sink += scan(vec, current);
+    }
+    before = since(start) / TOGGLES;
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < TOGGLES; t++) {
+        order.shuffle(t);
+        sink += order.positionOf(current);
+    }
+    after = since(start) / TOGGLES;
+    std::printf("%-22s %11.2f ms %11.2f ms\n", "shuffle on", before, after);
+
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < TOGGLES; t++) std::iota(vec.begin(), vec.end(), 0);
+    before = since(start) / TOGGLES;
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < TOGGLES; t++) order.reset(ENTRIES);
+    after = since(start) / TOGGLES;
+    std::printf("%-22s %11.2f ms %11.2f ms\n", "shuffle off", before, after);
+
+    // Stepping through the shuffled order, as next() does
+    order.shuffle(1);
+    start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < ENTRIES; p++) sink += vec[p];
+    before = since(start) * 1e6 / ENTRIES;
+    start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < ENTRIES; p++) sink += order[p];
+    after = since(start) * 1e6 / ENTRIES;
+    std::printf("%-22s %11.2f ns %11.2f ns\n", "next track", before, after);
+    std::printf("%-22s %11.1f MB %11.1f MB\n", "memory, shuffled", vec.capacity() * sizeof(size_t) / 1e6,
+                order.memoryBytes() / 1e6);
+
+    // Album added while shuffled, half the list already played
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < TOGGLES; t++) {
+        vec.resize(ENTRIES);
+        for (size_t i = 0; i < ALBUM; i++) vec.push_back(ENTRIES + i);
+        std::shuffle(vec.begin(), vec.end(), std::default_random_engine(t));
+        sink += scan(vec, current);
+    }
+    before = since(start) / TOGGLES;
+    // Both batches go into the small tree beside the keyed permutation;
+    // the second one finds the first already there
+    after = 0.0;
+    double again = 0.0;
+    for (int t = 0; t < TOGGLES; t++) {
+        PlayOrder copy = order;
+        start = std::chrono::steady_clock::now();
+        copy.extendShuffled(ENTRIES + ALBUM, ENTRIES / 2, t);
+        after += since(start);
+        start = std::chrono::steady_clock::now();
+        copy.extendShuffled(ENTRIES + 2 * ALBUM, ENTRIES / 2, t);
+        again += since(start);
+    }
+    std::printf("%-22s %11.2f ms %11.3f ms\n", "add 1k, shuffle on", before, after / TOGGLES);
+    std::printf("%-22s %14s %11.3f ms\n", "  second batch", "", again / TOGGLES);
+
+    // Reads now merge the added entries in
+    PlayOrder edited = order;
+    edited.extendShuffled(ENTRIES + ALBUM, ENTRIES / 2, 1);
+    start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < ENTRIES; p++) sink += vec[p];
+    before = since(start) * 1e6 / ENTRIES;
+    start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < ENTRIES; p++) sink += edited[p];
+    after = since(start) * 1e6 / ENTRIES;
+    std::printf("%-22s %11.2f ns %11.2f ns\n", "next track, after add", before, after);
+    std::printf("%-22s %11.1f MB %11.2f MB\n", "memory, after add", vec.capacity() * sizeof(size_t) / 1e6,
+                edited.memoryBytes() / 1e6);
+
+    std::vector<uint32_t> handles(ROWS);
+    std::iota(handles.begin(), handles.end(), 0);
+    std::vector<TrackInfo> tracks(ROWS);
+    for (size_t i = 0; i < ROWS; i++) tracks[i].title = "Track " + std::to_string(i);
+    PlayOrder rowsOrder;
+    rowsOrder.reset(ROWS);
+    rowsOrder.shuffle(3);
+    std::vector<size_t> selected(ROWS);
+    std::iota(selected.begin(), selected.end(), 0);
+    std::shuffle(selected.begin(), selected.end(), rng);
+    selected.resize(SELECTED);
+    std::sort(selected.begin(), selected.end());
+    {
+        std::vector<uint32_t> h = handles;
+        std::vector<TrackInfo> t = tracks;
+        std::vector<uint32_t> order(ROWS), pos(ROWS);
+        for (size_t p = 0; p < ROWS; p++) order[p] = rowsOrder[p];
+        for (size_t p = 0; p < ROWS; p++) pos[order[p]] = p;
+        start = std::chrono::steady_clock::now();
+        // Highest first so the lower indices stay put
+        for (size_t k = selected.size(); k-- > 0;) {
+            size_t i = selected[k];
+            h.erase(h.begin() + i);
+            t.erase(t.begin() + i);
+            eraseOne(order, pos, i);
+        }
+        before = since(start);
+        sink += order[0];
+    }
+    {
+        std::vector<uint32_t> h = handles;
+        std::vector<TrackInfo> t = tracks;
+        PlayOrder o = rowsOrder;
+        start = std::chrono::steady_clock::now();
+        size_t kept = selected[0], removed = 0;
+        for (size_t i = selected[0]; i < h.size(); i++) {
+            if (removed < selected.size() && selected[removed] == i) {
+                removed++;
+                continue;
+            }
+            h[kept] = h[i];
+            t[kept] = std::move(t[i]);
+            kept++;
+        }
+        h.resize(kept);
+        t.resize(kept);
+        o.erase(selected);
+        after = since(start);
+        sink += o[0];
+    }
+    std::printf("%-22s %11.2f ms %11.2f ms\n", "delete 10k of 100k", before, after);
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+// Reordering a playlist of 100k and 1M rows: a std::vector of ids (erase +
+// insert to move, a scan to find an id) against OrderTree. Also the cost
+// of reading a position, which the view does per drawn row and playback
+// once per track.
+//   make bench && ./build/bin/bench/order_tree_bench
+#include "order_tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+static const int MOVES = 1000;
+static const int READS = 1000000;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::printf("%-10s %-12s %14s %14s\n", "rows", "", "vector", "OrderTree");
+    size_t sink = 0;
+    for (size_t n : {100000, 1000000}) {
+        std::mt19937 rng(11);
+        std::vector<size_t> from(MOVES), to(MOVES), ids(MOVES), at(READS);
+        for (int i = 0; i < MOVES; i++) {
+            from[i] = rng() % n;
+            to[i] = rng() % n;
+            ids[i] = rng() % n;
+        }
+        for (size_t& p : at) p = rng() % n;
+
+        std::vector<uint32_t> vec(n);
+        std::iota(vec.begin(), vec.end(), 0);
+        OrderTree tree;
+        tree.reset(n);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < MOVES; i++) {
+            uint32_t id = vec[from[i]];
+            vec.erase(vec.begin() + from[i]);
+            vec.insert(vec.begin() + to[i], id);
+        }
+        double before = since(start) / MOVES;
+        // The first move writes the tree out; it is timed separately
+        start = std::chrono::steady_clock::now();
+        tree.move(from[0], to[0]);
+        double first = since(start);
+        start = std::chrono::steady_clock::now();
+        for (int i = 1; i < MOVES; i++) tree.move(from[i], to[i]);
+        double after = since(start) / (MOVES - 1);
+        std::printf("%-10zu %-12s %11.2f us %11.2f us\n", n, "move", before, after);
+        std::printf("%-10s %-12s %14s %11.0f us\n", "", "first move", "", first);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t id : ids) sink += std::find(vec.begin(), vec.end(), (uint32_t)id) - vec.begin();
+        before = since(start) / MOVES;
+        start = std::chrono::steady_clock::now();
+        for (size_t id : ids) sink += tree.indexOf(id);
+        after = since(start) / MOVES;
+        std::printf("%-10s %-12s %11.2f us %11.2f us\n", "", "index of", before, after);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < MOVES; i++) vec.insert(vec.begin() + to[i] % vec.size(), (uint32_t)vec.size());
+        before = since(start) / MOVES;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < MOVES; i++) tree.insert(to[i] % tree.size());
+        after = since(start) / MOVES;
+        std::printf("%-10s %-12s %11.2f us %11.2f us\n", "", "insert at", before, after);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t p : at) sink += vec[p];
+        before = since(start) * 1000.0 / READS;
+        start = std::chrono::steady_clock::now();
+        for (size_t p : at) sink += tree.at(p);
+        after = since(start) * 1000.0 / READS;
+        std::printf("%-10s %-12s %11.2f ns %11.2f ns\n", "", "at", before, after);
+        std::printf("%-10s %-12s %11.1f MB %11.1f MB\n", "", "memory", vec.capacity() * 4 / 1e6,
+                    tree.memoryBytes() / 1e6);
+    }
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+// Playlist path storage for a 250k-track library (250 artists x 20 albums
+// x 50 tracks under /storage/emulated/0/Music): std::vector<std::string>
+// against PathStore plus a vector of handles. Heap bytes and allocation
+// counts come from counting operator new; bytes include malloc's rounding.
+//   make bench && ./build/bin/bench/path_store_bench
+#include "path_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <vector>
+
+static const int ARTISTS = 250, ALBUMS = 20, TRACKS = 50;
+
+static size_t allocations = 0;
+static size_t liveBytes = 0;
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    allocations++;
+    liveBytes += malloc_usable_size(p);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    liveBytes -= malloc_usable_size(p);
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    // Generated up front, outside the counts: the scanner's strings
+    std::vector<std::string> scanned;
+    scanned.reserve((size_t)ARTISTS * ALBUMS * TRACKS);
+    char buf[256];
+    for (int a = 0; a < ARTISTS; a++) {
+        for (int b = 0; b < ALBUMS; b++) {
+            for (int t = 0; t < TRACKS; t++) {
+                std::snprintf(buf, sizeof(buf), "/storage/emulated/0/Music/Artist Name %03d/Album Title %02d/"
+                              "%02d - Track Title %d.flac", a, b, t + 1, (a * ALBUMS + b) * TRACKS + t);
+                scanned.push_back(buf);
+            }
+        }
+    }
+    size_t n = scanned.size();
+    size_t textBytes = 0;
+    for (const std::string& s : scanned) textBytes += s.size();
+    std::printf("%zu paths, %.1f bytes of text each\n", n, (double)textBytes / n);
+    std::printf("%-26s %12s %12s %12s %12s\n", "", "bytes/entry", "allocations", "build ms", "resolve ms");
+
+    size_t sink = 0;
+    {
+        size_t allocs = allocations, bytes = liveBytes;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> playlist;
+        for (const std::string& s : scanned) playlist.push_back(s);
+        double built = since(start);
+        size_t used = liveBytes - bytes, count = allocations - allocs;
+        start = std::chrono::steady_clock::now();
+        std::string path;
+        for (const std::string& s : playlist) {
+            path = s;
+            sink += path.size();
+        }
+        std::printf("%-26s %12.1f %12zu %12.2f %12.2f\n", "vector<string>", (double)used / n, count, built,
+                    since(start));
+    }
+    {
+        size_t allocs = allocations, bytes = liveBytes;
+        auto start = std::chrono::steady_clock::now();
+        PathStore store;
+        std::vector<PathHandle> playlist;
+        for (const std::string& s : scanned) playlist.push_back(store.add(s));
+        double built = since(start);
+        size_t used = liveBytes - bytes, count = allocations - allocs;
+        start = std::chrono::steady_clock::now();
+        std::string path;
+        for (PathHandle h : playlist) {
+            store.pathInto(h, &path);
+            sink += path.size();
+        }
+        double resolved = since(start);
+        std::printf("%-26s %12.1f %12zu %12.2f %12.2f\n", "PathStore + handles", (double)used / n, count, built,
+                    resolved);
+
+        size_t wrong = 0;
+        for (size_t i = 0; i < n; i++) wrong += !store.equals(playlist[i], scanned[i]) || store.path(playlist[i]) != scanned[i];
+        std::printf("%zu directories interned, %zu mismatches\n", store.directories(), wrong);
+    }
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Playlist import at 1M lines: the previous std::getline reader (trim by
+// erase(), one directory + line string per entry, #EXTINF ignored) against
+// PlaylistFile, parse only and with every entry resolved to a full path
+// (what the scanner does with them).
+// Also PLS and XSPF files with the same entries. Files go to /tmp.
+//   make bench && ./build/bin/bench/playlist_file_bench
+#include "playlist_file.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const size_t LINES = 1000000;
+static const int RUNS = 5;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Before: Scanner::readPlaylist
+static std::vector<std::string> readPlaylist(const std::string& path) {
+    std::vector<std::string> entries;
+    std::string m3uDir = "";
+    size_t lastSlash = path.find_last_of("/");
+    if (lastSlash != std::string::npos) {
+        m3uDir = path.substr(0, lastSlash + 1);
+    }
+
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line[0] == '/' || line.find("://") != std::string::npos) {
+            entries.push_back(line);
+        } else {
+            entries.push_back(m3uDir + line);
+        }
+    }
+    return entries;
+}
+
+static void track(size_t i, char* buf, size_t len) {
+    std::snprintf(buf, len, "Artist %03zu/Album %02zu/%02zu - Track %zu.flac", i / 2000, i / 50 % 40, i % 50 + 1, i);
+}
+
+static bool generate(const std::string& m3u, const std::string& pls, const std::string& xspf, size_t entries) {
+    FILE* a = std::fopen(m3u.c_str(), "w");
+    FILE* b = std::fopen(pls.c_str(), "w");
+    FILE* c = std::fopen(xspf.c_str(), "w");
+    if (!a || !b || !c) return false;
+    std::fprintf(a, "#EXTM3U\n");
+    std::fprintf(b, "[playlist]\n");
+    std::fprintf(c, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n<trackList>\n");
+    char path[128];
+    for (size_t i = 0; i < entries; i++) {
+        track(i, path, sizeof(path));
+        int seconds = 120 + i % 300;
+        std::fprintf(a, "#EXTINF:%d,Artist %03zu - Track %zu\n%s\n", seconds, i / 2000, i, path);
+        std::fprintf(b, "File%zu=%s\nTitle%zu=Artist %03zu - Track %zu\nLength%zu=%d\n",
+                     i + 1, path, i + 1, i / 2000, i, i + 1, seconds);
+        std::fprintf(c, "<track><location>%s</location><creator>Artist %03zu</creator>"
+                        "<title>Track %zu</title><duration>%d000</duration></track>\n",
+                     path, i / 2000, i, seconds);
+    }
+    std::fprintf(b, "NumberOfEntries=%zu\nVersion=2\n", entries);
+    std::fprintf(c, "</trackList>\n</playlist>\n");
+    std::fclose(a);
+    std::fclose(b);
+    std::fclose(c);
+    return true;
+}
+
+int main() {
+    const std::string m3u = "/tmp/termamp-bench.m3u";
+    const std::string pls = "/tmp/termamp-bench.pls";
+    const std::string xspf = "/tmp/termamp-bench.xspf";
+    const size_t entries = LINES / 2;
+    if (!generate(m3u, pls, xspf, entries)) {
+        std::fprintf(stderr, "Could not write the playlists to /tmp\n");
+        return 1;
+    }
+    std::printf("%zu M3U lines (%zu entries with #EXTINF), best of %d, warm cache\n", LINES, entries, RUNS);
+
+    size_t sink = 0;
+    double best = 1e9;
+    for (int r = 0; r < RUNS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> paths = readPlaylist(m3u);
+        best = std::min(best, since(start));
+        sink += paths.size();
+    }
+    std::printf("%-28s %8.1f ms\n", "getline + concat", best);
+
+    best = 1e9;
+    size_t infos = 0;
+    for (int r = 0; r < RUNS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        PlaylistFile file;
+        file.open(m3u);
+        PlaylistEntry e;
+        infos = 0;
+        while (file.next(&e)) {
+            sink += e.location.size();
+            infos += e.hasInfo();
+        }
+        best = std::min(best, since(start));
+    }
+    std::printf("%-28s %8.1f ms   %zu with title and duration\n", "PlaylistFile, parse", best, infos);
+
+    struct Case { const char* label; const std::string* path; } cases[] = {
+        {"PlaylistFile, M3U resolved", &m3u},
+        {"PlaylistFile, PLS resolved", &pls},
+        {"PlaylistFile, XSPF resolved", &xspf},
+    };
+    for (const Case& c : cases) {
+        best = 1e9;
+        size_t count = 0;
+        for (int r = 0; r < RUNS; r++) {
+            auto start = std::chrono::steady_clock::now();
+            PlaylistFile file;
+            file.open(*c.path);
+            std::vector<std::string> paths;
+            PlaylistEntry e;
+            while (file.next(&e)) paths.push_back(file.resolve(e));
+            best = std::min(best, since(start));
+            count = paths.size();
+        }
+        std::printf("%-28s %8.1f ms   %zu entries\n", c.label, best, count);
+    }
+    return sink == 42 ? 1 : 0;
+}
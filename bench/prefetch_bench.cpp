@@ -0,0 +1,126 @@
+// Track-boundary reads with and without read-ahead: 8 files of 8 MB are
+// written to a directory (give one on the SD card or /sdcard to see the
+// stall), dropped from the page cache with posix_fadvise(DONTNEED), then
+// the first 64 KB (a decoder's first read) and the first 2 MB are timed
+// cold and after Prefetcher has read the file ahead. On tmpfs nothing can
+// be dropped, and the run says so.
+//   make bench && ./build/bin/bench/prefetch_bench [dir]
+#include "prefetch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int FILES = 8;
+static const size_t FILE_BYTES = 8 << 20;
+static const size_t FIRST_READ = 64 << 10;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Writes it back and evicts it; false if pages stayed resident
+static bool dropCache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    bool dropped = true;
+    void* map = mmap(NULL, FILE_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+        long page = sysconf(_SC_PAGESIZE);
+        std::vector<unsigned char> resident((FILE_BYTES + page - 1) / page);
+        if (mincore(map, FILE_BYTES, resident.data()) == 0) {
+            dropped = std::count_if(resident.begin(), resident.end(), [](unsigned char r) { return r & 1; }) == 0;
+        }
+        munmap(map, FILE_BYTES);
+    }
+    close(fd);
+    return dropped;
+}
+
+// open, then read `bytes` from the start: ms
+static double readHead(const std::string& path, size_t bytes) {
+    auto start = std::chrono::steady_clock::now();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    std::vector<char> buf(FIRST_READ);
+    for (size_t done = 0; done < bytes;) {
+        ssize_t got = read(fd, buf.data(), std::min(buf.size(), bytes - done));
+        if (got <= 0) break;
+        done += got;
+    }
+    close(fd);
+    return since(start);
+}
+
+struct Run {
+    std::vector<double> first, head;
+    void print(const char* label) {
+        std::sort(first.begin(), first.end());
+        std::sort(head.begin(), head.end());
+        double a = 0, b = 0;
+        for (double t : first) a += t;
+        for (double t : head) b += t;
+        std::printf("%-14s %9.3f ms %9.3f ms %9.3f ms %9.3f ms\n", label, a / first.size(), first.back(),
+                    b / head.size(), head.back());
+    }
+};
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+    std::vector<std::string> paths;
+    std::vector<char> data(FILE_BYTES);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (char)(i * 2654435761u >> 24);
+    for (int i = 0; i < FILES; i++) {
+        std::string path = dir + "/termamp-prefetch-" + std::to_string(i) + ".bin";
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f || std::fwrite(data.data(), 1, data.size(), f) != data.size()) {
+            std::fprintf(stderr, "Could not write %s\n", path.c_str());
+            if (f) std::fclose(f);
+            return 1;
+        }
+        std::fclose(f);
+        paths.push_back(path);
+    }
+
+    Prefetcher prefetcher;
+    Run cold, ahead;
+    bool dropped = true;
+    double warmMs = 0;
+    for (const std::string& path : paths) {
+        dropped = dropCache(path) && dropped;
+        cold.first.push_back(readHead(path, FIRST_READ));
+        dropCache(path);
+        cold.head.push_back(readHead(path, Prefetcher::HEAD_BYTES));
+
+        dropCache(path);
+        auto start = std::chrono::steady_clock::now();
+        prefetcher.predict(path);
+        while (!prefetcher.ready(path)) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        warmMs += since(start);
+        // readahead() returns once the reads are issued; in the player the
+        // current track keeps playing for minutes, here 50 ms
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ahead.first.push_back(readHead(path, FIRST_READ));
+        ahead.head.push_back(readHead(path, Prefetcher::HEAD_BYTES));
+        prefetcher.loaded(path);
+    }
+    for (const std::string& path : paths) unlink(path.c_str());
+
+    Prefetcher::Stats stats = prefetcher.stats();
+    std::printf("%d files of %zu MB in %s%s\n", FILES, FILE_BYTES >> 20, dir.c_str(),
+                dropped ? "" : " (pages stayed cached: cold numbers are warm)");
+    std::printf("read-ahead: %.1f ms per file in the background, %llu MB, %u/%u hits\n", warmMs / FILES,
+                (unsigned long long)(stats.bytes >> 20), stats.hits, stats.loads);
+    std::printf("%-14s %12s %12s %12s %12s\n", "", "64 KB mean", "worst", "2 MB mean", "worst");
+    cold.print("cold");
+    ahead.print("read ahead");
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Library scanner on a generated tree of 200k audio files (100 artists x
+// 40 albums x 50 tracks, plus a cover.jpg per album), single thread vs the
+// pool, cold and warm dentry/inode cache. Cold runs need root to drop caches.
+//   make bench && ./build/bin/bench/scan_bench [tree-dir]
+#include "scanner.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+
+static const int ARTISTS = 100, ALBUMS = 40, TRACKS = 50;
+
+static void touch(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0) close(fd);
+}
+
+static bool generate(const std::string& root) {
+    std::string marker = root + "/.complete";
+    if (access(marker.c_str(), F_OK) == 0) return true;
+
+    std::printf("Generating %d files under %s...\n", ARTISTS * ALBUMS * TRACKS, root.c_str());
+    mkdir(root.c_str(), 0755);
+    static const char* EXTS[] = {"mp3", "flac", "ogg", "m4a", "opus"};
+    char buf[256];
+    for (int a = 0; a < ARTISTS; a++) {
+        std::snprintf(buf, sizeof(buf), "%s/Artist %03d", root.c_str(), a);
+        std::string artist = buf;
+        if (mkdir(artist.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        for (int b = 0; b < ALBUMS; b++) {
+            std::snprintf(buf, sizeof(buf), "%s/Album %02d", artist.c_str(), b);
+            std::string album = buf;
+            mkdir(album.c_str(), 0755);
+            touch(album + "/cover.jpg");
+            for (int t = 0; t < TRACKS; t++) {
+                std::snprintf(buf, sizeof(buf), "%s/%02d - Track.%s", album.c_str(), t + 1, EXTS[(a + t) % 5]);
+                touch(buf);
+            }
+        }
+    }
+    touch(marker);
+    return true;
+}
+
+static bool dropCaches() {
+    sync();
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = write(fd, "3", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+static void countBatch(void* data, std::vector<std::string>& batch, std::vector<ScanInfo>&) {
+    *(size_t*)data += batch.size();
+}
+
+static void run(const std::string& root, unsigned threads, const char* cache) {
+    Scanner scanner(threads);
+    size_t delivered = 0;
+    ScanStats stats = scanner.scan({root}, countBatch, &delivered);
+    std::printf("%8u %8s %10zu %8zu %10.1f %12.0f\n", threads, cache, delivered, stats.dirs,
+                stats.seconds * 1000.0, delivered / stats.seconds);
+}
+
+int main(int argc, char** argv) {
+    std::string root = argc > 1 ? argv[1] : "/tmp/termamp-scan-bench";
+    if (!generate(root)) {
+        std::fprintf(stderr, "Could not create %s\n", root.c_str());
+        return 1;
+    }
+
+    unsigned pool = std::thread::hardware_concurrency();
+    std::printf("%8s %8s %10s %8s %10s %12s\n", "threads", "cache", "files", "dirs", "ms", "files/s");
+    for (unsigned threads : {1u, pool}) {
+        if (dropCaches()) run(root, threads, "cold");
+        else std::printf("%8u %8s  (skipped: needs root to drop caches)\n", threads, "cold");
+        run(root, threads, "warm");
+        run(root, threads, "warm");
+    }
+    return 0;
+}
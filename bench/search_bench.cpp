@@ -0,0 +1,217 @@
+// Type-to-filter over 200k entries (file name, title, artist, album): every
+// keystroke of a few hundred typed queries, answered by a case-insensitive
+// check of every entry's fields against SearchIndex, with and without
+// narrowing the previous keystroke's results. The app filters from the
+// 2nd key on. Each keystroke is timed as the best of three runs, after one
+// untimed pass over every query: a stall of the machine is not the worst
+// case, and neither is the one-time sorting of lists tags reached late
+// (the pass is timed as a whole). Also what keeping the index costs as
+// entries and then their tags arrive.
+//   make bench && ./build/bin/bench/search_bench
+#include "search_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const size_t ENTRIES = 200000;
+static const int QUERIES = 300;
+// The plain check takes tens of ms a key: it is timed on these queries only
+static const int CHECKED = 20;
+
+static const char* WORDS =
+    "love night heart time day life world away dream fire light rain baby girl home road song "
+    "blue black gold summer winter river city street dance party rock soul star sky moon sun "
+    "wild free young old lost broken little big sweet cold hot high low long last first new "
+    "never always forever again together tonight tomorrow yesterday morning midnight heaven "
+    "angel devil ghost shadow thunder ocean mountain desert garden window door mirror story "
+    "letter train highway freedom money power glory crazy lonely happy sad beautiful golden "
+    "silver electric running falling burning shining crying calling waiting dancing dreaming "
+    "walking flying talking holding breaking leaving coming going rising fading turning";
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Entry {
+    std::string name, title, artist, album;
+};
+
+// What a filter without an index does: every field of every entry
+static bool plainContains(const std::string& text, const std::string& term) {
+    return std::search(text.begin(), text.end(), term.begin(), term.end(), [](char a, char b) {
+        return (char)tolower((unsigned char)a) == b;
+    }) != text.end();
+}
+
+struct Stat {
+    double sum = 0, worst = 0;
+    size_t n = 0;
+    void add(double us) {
+        sum += us;
+        worst = std::max(worst, us);
+        n++;
+    }
+    void print(const char* label) const {
+        if (n) std::printf("%-28s %9.0f us %9.0f us\n", label, sum / n, worst);
+    }
+};
+
+int main() {
+    std::mt19937 rng(20);
+    std::vector<std::string> words;
+    std::istringstream in(WORDS);
+    for (std::string w; in >> w;) words.push_back(w);
+    // Names for artists and albums from syllables
+    const char* syllables[] = {"ka", "lo", "mi", "ra", "ne", "to", "su", "vi", "de", "an", "or", "el",
+                               "bri", "sta", "mon", "qu", "ze", "ho", "ly", "ter", "gun", "pha", "wex", "jo"};
+    auto capital = [](std::string s) {
+        for (size_t i = 0; i < s.size(); i++) {
+            if (i == 0 || s[i - 1] == ' ') s[i] = toupper(s[i]);
+        }
+        return s;
+    };
+    auto name = [&]() {
+        std::string s;
+        for (int p = 2 + rng() % 3; p > 0; p--) s += syllables[rng() % 24];
+        return s;
+    };
+    auto phrase = [&](int count) {
+        std::string s;
+        for (int i = 0; i < count; i++) s += (i ? " " : "") + words[rng() % words.size()];
+        return s;
+    };
+    std::vector<std::string> artists(4000), albums(16000);
+    for (std::string& a : artists) a = capital(rng() % 2 ? name() : name() + " " + name());
+    for (std::string& a : albums) a = capital(rng() % 2 ? phrase(1 + rng() % 3) : name());
+    std::vector<Entry> entries(ENTRIES);
+    for (Entry& e : entries) {
+        e.title = capital(phrase(1 + rng() % 4));
+        e.artist = artists[rng() % artists.size()];
+        e.album = albums[rng() % albums.size()];
+        char track[8];
+        std::snprintf(track, sizeof(track), "%02d", (int)(1 + rng() % 20));
+        e.name = std::string(track) + " - " + e.artist + " - " + e.title + ".mp3";
+    }
+
+    // Import sets file names in order; tags come back from workers later
+    SearchIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ENTRIES; i++) index.set(i, {entries[i].name});
+    double named = since(start) / ENTRIES;
+    std::vector<uint32_t> order(ENTRIES);
+    for (size_t i = 0; i < ENTRIES; i++) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i : order) {
+        const Entry& e = entries[i];
+        index.set(i, {e.name, e.title, e.artist, e.album});
+    }
+    double tagged = since(start) / ENTRIES;
+
+    // Typed a key at a time: the start of a title or an artist, or a word
+    // and part of an artist
+    std::vector<std::string> queries(QUERIES);
+    for (std::string& q : queries) {
+        const Entry& e = entries[rng() % ENTRIES];
+        switch (rng() % 3) {
+            case 0: q = e.title.substr(0, 12); break;
+            case 1: q = e.artist.substr(0, 8); break;
+            default: q = words[rng() % words.size()] + " " + e.artist.substr(0, 4); break;
+        }
+    }
+
+    // The first pass puts back in order the lists tags reached late, and
+    // the arena the tags grew
+    std::vector<uint32_t> results, previous, expected;
+    start = std::chrono::steady_clock::now();
+    for (const std::string& query : queries) {
+        previous.clear();
+        for (size_t len = 1; len <= query.size(); len++) {
+            index.search(SearchIndex::terms(query.substr(0, len)), len == 1 ? nullptr : &previous, &results);
+            previous.swap(results);
+        }
+    }
+    double tidied = since(start);
+
+    auto best = [&index](const std::vector<std::string>& terms, const std::vector<uint32_t>* within,
+                         std::vector<uint32_t>* out) {
+        double us = 0;
+        for (int run = 0; run < 3; run++) {
+            auto start = std::chrono::steady_clock::now();
+            index.search(terms, within, out);
+            us = run ? std::min(us, since(start)) : since(start);
+        }
+        return us;
+    };
+
+    Stat plain, indexed, narrowed, filtered, keys[4];
+    size_t sink = 0;
+    for (int q = 0; q < QUERIES; q++) {
+        const std::string& query = queries[q];
+        previous.clear();
+        for (size_t len = 1; len <= query.size(); len++) {
+            if (query[len - 1] == ' ') continue;
+            std::vector<std::string> terms = SearchIndex::terms(query.substr(0, len));
+
+            indexed.add(best(terms, nullptr, &expected));
+            sink += expected.size();
+
+            double us = best(terms, len == 1 ? nullptr : &previous, &results);
+            narrowed.add(us);
+            keys[std::min(len, (size_t)4) - 1].add(us);
+            if (len >= 2) filtered.add(us);
+            if (results != expected) {
+                std::fprintf(stderr, "narrowing differs on \"%s\"\n", query.substr(0, len).c_str());
+                return 1;
+            }
+            previous.swap(results);
+
+            if (q >= CHECKED) continue;
+            start = std::chrono::steady_clock::now();
+            results.clear();
+            for (uint32_t id = 0; id < ENTRIES; id++) {
+                const Entry& e = entries[id];
+                bool all = true;
+                for (const std::string& t : terms) {
+                    if (!plainContains(e.name, t) && !plainContains(e.title, t) &&
+                        !plainContains(e.artist, t) && !plainContains(e.album, t)) {
+                        all = false;
+                        break;
+                    }
+                }
+                if (all) results.push_back(id);
+            }
+            plain.add(since(start));
+            if (results != expected) {
+                std::fprintf(stderr, "index differs on \"%s\"\n", query.substr(0, len).c_str());
+                return 1;
+            }
+        }
+    }
+
+    std::printf("%zu entries, %d typed queries, %zu keystrokes\n", ENTRIES, QUERIES, indexed.n);
+    std::printf("%-28s %12s %12s\n", "per keystroke", "mean", "worst");
+    plain.print("every field of every entry");
+    indexed.print("index");
+    narrowed.print("index, narrowing");
+    keys[0].print("  1st key");
+    keys[1].print("  2nd key");
+    keys[2].print("  3rd key");
+    keys[3].print("  later keys");
+    filtered.print("  2nd key on (as the app)");
+    std::printf("%-28s %9.2f us\n", "set file name", named);
+    std::printf("%-28s %9.2f us\n", "set tags (out of order)", tagged);
+    std::printf("%-28s %9.0f ms\n", "first pass after tags", tidied / 1000.0);
+    std::printf("%-28s %9.1f MB\n", "index memory", index.memoryBytes() / 1e6);
+
+    std::vector<size_t> doomed;
+    for (size_t i = 0; i < ENTRIES; i += 997) doomed.push_back(i);
+    start = std::chrono::steady_clock::now();
+    index.erase(doomed);
+    std::printf("%-28s %9.2f ms\n", "delete 201 rows", since(start) / 1000.0);
+    return sink == 42 ? 1 : 0;
+}
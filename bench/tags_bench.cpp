@@ -0,0 +1,372 @@
+// Tag reading on 10k files: TagReader on one thread, the TagPool, and (when
+// built with gstreamer-pbutils) GstDiscoverer as the baseline. Without an
+// argument it generates synthetic MP3 (ID3v2.3 UTF-16 + Xing, ID3v2.4 CBR),
+// FLAC, Ogg Vorbis, Opus and M4A headers with cover art; the generated audio
+// is not decodable, so point it at a real library for the Discoverer column.
+//   make bench && ./build/bin/bench/tags_bench [music-dir]
+#include "tags.h"
+#include "scanner.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#ifdef HAVE_DISCOVERER
+#include <gst/pbutils/pbutils.h>
+#endif
+
+static const size_t FILES = 10000;
+static const size_t COVER = 48 * 1024;
+
+// --- SYNTHETIC FILES ---
+typedef std::string Bytes;
+
+static void be32(Bytes& b, uint32_t v) {
+    for (int s = 24; s >= 0; s -= 8) b += (char)(v >> s);
+}
+static void le32(Bytes& b, uint32_t v) {
+    for (int s = 0; s < 32; s += 8) b += (char)(v >> s);
+}
+static void le16(Bytes& b, uint32_t v) {
+    b += (char)v;
+    b += (char)(v >> 8);
+}
+static void syncsafe(Bytes& b, uint32_t v) {
+    for (int s = 21; s >= 0; s -= 7) b += (char)((v >> s) & 0x7f);
+}
+
+static Bytes id3Frame(const char* id, const Bytes& body, int major) {
+    Bytes f(id, 4);
+    if (major == 4) syncsafe(f, body.size());
+    else be32(f, body.size());
+    f += std::string(2, '\0');
+    return f + body;
+}
+
+static Bytes id3Tag(int major, const std::string& title, const std::string& artist, const std::string& album) {
+    auto text = [&](const std::string& s) {
+        if (major == 4) return Bytes(1, '\3') + s;
+        Bytes b("\1\xff\xfe", 3);   // UTF-16LE with BOM
+        for (char c : s) {
+            b += c;
+            b += '\0';
+        }
+        return b;
+    };
+    Bytes frames = id3Frame("TIT2", text(title), major) + id3Frame("TPE1", text(artist), major) +
+                   id3Frame("TALB", text(album), major) +
+                   id3Frame("APIC", Bytes("\0image/jpeg\0\3\0", 14) + Bytes(COVER, '\x55'), major);
+    frames += Bytes(1024, '\0');   // padding
+    Bytes tag("ID3", 3);
+    tag += (char)major;
+    tag += std::string(2, '\0');
+    syncsafe(tag, frames.size());
+    return tag + frames;
+}
+
+// MPEG-1 layer III, 128 kbit/s, 44.1 kHz, stereo: 417-byte frames
+static Bytes mpegFrames(size_t count, uint32_t xingFrames) {
+    Bytes out;
+    for (size_t i = 0; i < count; i++) {
+        Bytes frame("\xff\xfb\x90\x00", 4);
+        frame += Bytes(32, '\0');
+        if (i == 0 && xingFrames) {
+            frame += "Xing";
+            be32(frame, 1);
+            be32(frame, xingFrames);
+        }
+        frame.resize(417, '\0');
+        out += frame;
+    }
+    return out;
+}
+
+static Bytes vorbisComments(const std::string& title, const std::string& artist, const std::string& album) {
+    Bytes b;
+    std::string vendor = "termamp bench";
+    le32(b, vendor.size());
+    b += vendor;
+    le32(b, 3);
+    for (std::string c : {"TITLE=" + title, "ARTIST=" + artist, "ALBUM=" + album}) {
+        le32(b, c.size());
+        b += c;
+    }
+    return b;
+}
+
+static Bytes flac(const std::string& title, const std::string& artist, const std::string& album, uint64_t samples) {
+    Bytes out("fLaC", 4);
+    Bytes info(34, '\0');
+    uint32_t rate = 44100;
+    info[10] = (char)(rate >> 12);
+    info[11] = (char)(rate >> 4);
+    info[12] = (char)(((rate & 0xf) << 4) | (1 << 1));   // 2 channels
+    info[13] = (char)((15 << 4) | ((samples >> 32) & 0xf));   // 16 bits
+    for (int i = 0; i < 4; i++) info[14 + i] = (char)(samples >> (24 - 8 * i));
+
+    auto block = [&](int type, bool last, const Bytes& body) {
+        out += (char)((last ? 0x80 : 0) | type);
+        out += (char)(body.size() >> 16);
+        out += (char)(body.size() >> 8);
+        out += (char)body.size();
+        out += body;
+    };
+    block(0, false, info);
+    block(6, false, Bytes(COVER, '\x55'));   // PICTURE
+    block(4, false, vorbisComments(title, artist, album));
+    block(1, true, Bytes(4096, '\0'));       // PADDING
+    out += Bytes(16 * 1024, '\x11');
+    return out;
+}
+
+static Bytes oggPage(uint32_t serial, uint32_t seq, uint64_t granule, int type, const std::vector<Bytes>& packets) {
+    Bytes segments, body;
+    for (const Bytes& p : packets) {
+        size_t n = p.size();
+        while (n >= 255) {
+            segments += '\xff';
+            n -= 255;
+        }
+        segments += (char)n;
+        body += p;
+    }
+    Bytes page("OggS\0", 5);
+    page += (char)type;
+    le32(page, (uint32_t)granule);
+    le32(page, (uint32_t)(granule >> 32));
+    le32(page, serial);
+    le32(page, seq);
+    le32(page, 0);   // CRC: not checked by the reader
+    page += (char)segments.size();
+    return page + segments + body;
+}
+
+static Bytes ogg(bool opus, const std::string& title, const std::string& artist, const std::string& album,
+                 uint64_t granule) {
+    uint32_t serial = 0x7e57;
+    Bytes id, comments;
+    if (opus) {
+        id = Bytes("OpusHead\1\2", 10);
+        le16(id, 312);
+        le32(id, 48000);
+        id += Bytes(3, '\0');
+        comments = "OpusTags" + vorbisComments(title, artist, album);
+    } else {
+        id = Bytes("\1vorbis", 7);
+        le32(id, 0);
+        id += '\2';
+        le32(id, 44100);
+        id += Bytes(14, '\0');
+        comments = "\3vorbis" + vorbisComments(title, artist, album) + Bytes(1, '\1');
+    }
+    Bytes out = oggPage(serial, 0, 0, 2, {id});
+    out += oggPage(serial, 1, 0, 0, {comments});
+    for (uint32_t seq = 2; seq < 12; seq++) out += oggPage(serial, seq, seq * 4096, 0, {Bytes(4000, '\x22')});
+    out += oggPage(serial, 12, granule, 4, {Bytes(1000, '\x22')});
+    return out;
+}
+
+static Bytes atom(const char* type, const Bytes& body) {
+    Bytes a;
+    be32(a, body.size() + 8);
+    return a + Bytes(type, 4) + body;
+}
+
+static Bytes m4a(const std::string& title, const std::string& artist, const std::string& album, uint32_t seconds) {
+    auto item = [](const char* type, const std::string& value) {
+        Bytes data;
+        be32(data, 1);   // UTF-8
+        be32(data, 0);
+        return atom(type, atom("data", data + value));
+    };
+    Bytes mvhd(4, '\0');
+    be32(mvhd, 0);
+    be32(mvhd, 0);
+    be32(mvhd, 1000);
+    be32(mvhd, seconds * 1000);
+    mvhd += Bytes(80, '\0');
+
+    Bytes hdlr(8, '\0');
+    hdlr += "mdirappl";
+    hdlr += Bytes(9, '\0');
+    Bytes ilst = item("\xa9nam", title) + item("\xa9" "ART", artist) + item("\xa9" "alb", album) +
+                 atom("covr", atom("data", Bytes(8, '\0') + Bytes(COVER, '\x55')));
+    Bytes meta = Bytes(4, '\0') + atom("hdlr", hdlr) + atom("ilst", ilst);
+
+    Bytes ftyp("M4A ", 4);
+    be32(ftyp, 0);
+    ftyp += "M4A mp42isom";
+    // moov after mdat, as many encoders write it
+    return atom("ftyp", ftyp) + atom("mdat", Bytes(64 * 1024, '\x33')) +
+           atom("moov", atom("mvhd", mvhd) + atom("udta", atom("meta", meta)));
+}
+
+static bool writeFile(const std::string& path, const Bytes& data) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size();
+    close(fd);
+    return ok;
+}
+
+static bool generate(const std::string& root, std::vector<std::string>& paths) {
+    static const char* EXTS[] = {"mp3", "mp3", "flac", "ogg", "opus", "m4a"};
+    std::string marker = root + "/.complete";
+    bool exists = access(marker.c_str(), F_OK) == 0;
+    if (!exists) {
+        std::printf("Generating %zu files under %s...\n", FILES, root.c_str());
+        mkdir(root.c_str(), 0755);
+    }
+
+    char buf[256];
+    for (size_t i = 0; i < FILES; i++) {
+        std::snprintf(buf, sizeof(buf), "%s/%05zu.%s", root.c_str(), i, EXTS[i % 6]);
+        paths.push_back(buf);
+        if (exists) continue;
+
+        std::string title = "Title " + std::to_string(i);
+        std::string artist = "Artist " + std::to_string(i / 100);
+        std::string album = "Album " + std::to_string(i / 10);
+        Bytes data;
+        switch (i % 6) {
+            case 0: data = id3Tag(3, title, artist, album) + mpegFrames(20, 10000); break;
+            case 1: data = id3Tag(4, title, artist, album) + mpegFrames(200, 0); break;
+            case 2: data = flac(title, artist, album, 44100ull * 240); break;
+            case 3: data = ogg(false, title, artist, album, 44100ull * 200); break;
+            case 4: data = ogg(true, title, artist, album, 48000ull * 180 + 312); break;
+            case 5: data = m4a(title, artist, album, 300); break;
+        }
+        if (!writeFile(buf, data)) return false;
+    }
+    if (!exists) writeFile(marker, "");
+    return true;
+}
+
+static void collect(void* data, std::vector<std::string>& batch, std::vector<ScanInfo>&) {
+    std::vector<std::string>& paths = *(std::vector<std::string>*)data;
+    for (std::string& path : batch) {
+        if (paths.size() < FILES) paths.push_back(std::move(path));
+    }
+}
+
+// --- RUNS ---
+static bool dropCaches() {
+    sync();
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = write(fd, "3", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, const char* cache, size_t tagged, size_t timed, double ms) {
+    std::printf("%-12s %6s %8zu %8zu %10.1f %12.0f\n", name, cache, tagged, timed, ms, FILES * 1000.0 / ms);
+}
+
+static double runReader(const std::vector<std::string>& paths, const char* cache) {
+    TagReader reader;
+    TagView view;
+    size_t tagged = 0, timed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        if (!reader.read(path, &view)) continue;
+        if (!view.title.empty()) tagged++;
+        if (view.duration > 0) timed++;
+    }
+    double ms = since(start);
+    report("reader", cache, tagged, timed, ms);
+    return ms;
+}
+
+struct PoolCount {
+    std::mutex mutex;
+    size_t tagged = 0, timed = 0;
+};
+
+static double runPool(const std::vector<std::string>& paths, const char* cache) {
+    PoolCount count;
+    auto start = std::chrono::steady_clock::now();
+    {
+        TagPool pool([](void* data, std::vector<TagResult>& batch) {
+            PoolCount* count = (PoolCount*)data;
+            std::lock_guard<std::mutex> lock(count->mutex);
+            for (const TagResult& r : batch) {
+                if (!r.info.title.empty()) count->tagged++;
+                if (r.info.duration > 0) count->timed++;
+            }
+        }, &count);
+        std::vector<TagJob> jobs;
+        for (size_t i = 0; i < paths.size(); i++) jobs.push_back({i, paths[i], FileStamp()});
+        pool.submit(jobs);
+        pool.wait();
+    }
+    double ms = since(start);
+    report("pool", cache, count.tagged, count.timed, ms);
+    return ms;
+}
+
+#ifdef HAVE_DISCOVERER
+static double runDiscoverer(const std::vector<std::string>& paths, const char* cache) {
+    GstDiscoverer* discoverer = gst_discoverer_new(5 * GST_SECOND, NULL);
+    size_t tagged = 0, timed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        gchar* uri = gst_filename_to_uri(path.c_str(), NULL);
+        GstDiscovererInfo* info = gst_discoverer_discover_uri(discoverer, uri, NULL);
+        g_free(uri);
+        if (!info) continue;
+        const GstTagList* tags = gst_discoverer_info_get_tags(info);
+        gchar* title = NULL;
+        if (tags && gst_tag_list_get_string(tags, GST_TAG_TITLE, &title)) tagged++;
+        g_free(title);
+        if (gst_discoverer_info_get_duration(info) != GST_CLOCK_TIME_NONE) timed++;
+        g_object_unref(info);
+    }
+    double ms = since(start);
+    report("discoverer", cache, tagged, timed, ms);
+    g_object_unref(discoverer);
+    return ms;
+}
+#endif
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    if (argc > 1) {
+        Scanner scanner;
+        scanner.scan({argv[1]}, collect, &paths);
+    } else if (!generate("/tmp/termamp-tags-bench", paths)) {
+        std::fprintf(stderr, "Could not create /tmp/termamp-tags-bench\n");
+        return 1;
+    }
+    if (paths.empty()) {
+        std::fprintf(stderr, "No audio files\n");
+        return 1;
+    }
+    std::printf("%zu files\n", paths.size());
+    std::printf("%-12s %6s %8s %8s %10s %12s\n", "reader", "cache", "titles", "times", "ms", "files/s");
+
+    bool cold = dropCaches();
+    double native = cold ? runReader(paths, "cold") : 0.0;
+    native = runReader(paths, "warm");
+    if (dropCaches()) runPool(paths, "cold");
+    runPool(paths, "warm");
+
+#ifdef HAVE_DISCOVERER
+    gst_init(&argc, &argv);
+    if (dropCaches()) runDiscoverer(paths, "cold");
+    double baseline = runDiscoverer(paths, "warm");
+    std::printf("TagReader is %.1fx faster than GstDiscoverer (warm, one thread each)\n", baseline / native);
+#else
+    (void)native;
+    std::printf("discoverer   (skipped: built without gstreamer-pbutils-1.0)\n");
+#endif
+    if (!cold) std::printf("cold runs skipped: needs root to drop caches\n");
+    return 0;
+}
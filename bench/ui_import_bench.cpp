@@ -0,0 +1,105 @@
+// Background import of a 500k-entry M3U while a track plays: import wall
+// time and how late a 1 ms main-loop timer fires meanwhile (the longest
+// stall is what the window and the player's event handling would see).
+// Writes a 30 s WAV and the playlist to /tmp. Needs a display and
+// GStreamer; headless: xvfb-run ./build/bin/bench/ui_import_bench
+//   make bench-ui && ./build/bin/bench/ui_import_bench
+#include "playlist.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const size_t ENTRIES = 500000;
+
+static bool writeWav(const char* path, int seconds) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t rate = 44100, frames = rate * seconds, bytes = frames * 4;
+    auto u32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto u16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    u32(36 + bytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    u32(16);            // PCM, stereo, 16-bit
+    u16(1);
+    u16(2);
+    u32(rate);
+    u32(rate * 4);
+    u16(4);
+    u16(16);
+    std::fwrite("data", 1, 4, f);
+    u32(bytes);
+    std::vector<int16_t> frame(2);
+    for (uint32_t i = 0; i < frames; i++) {
+        frame[0] = frame[1] = (int16_t)(8000 * std::sin(i * 2 * M_PI * 440 / rate));
+        std::fwrite(frame.data(), 2, 2, f);
+    }
+    std::fclose(f);
+    return true;
+}
+
+struct Probe {
+    gint64 expected = 0;
+    std::vector<gint64> late;
+};
+
+int main(int argc, char** argv) {
+    if (!gtk_init_check(&argc, &argv)) {
+        std::fprintf(stderr, "No display (try xvfb-run)\n");
+        return 1;
+    }
+    const char* wav = "/tmp/termamp-import-bench.wav";
+    const char* m3u = "/tmp/termamp-import-bench.m3u";
+    FILE* f = writeWav(wav, 30) ? std::fopen(m3u, "w") : nullptr;
+    if (!f) {
+        std::fprintf(stderr, "Could not write to /tmp\n");
+        return 1;
+    }
+    std::fprintf(f, "#EXTM3U\n%s\n", wav);
+    for (size_t i = 1; i < ENTRIES; i++) {
+        std::fprintf(f, "#EXTINF:%zu,Artist %03zu - Track %zu\n/nonexistent/Artist %03zu/%02zu - Track %zu.flac\n",
+                     120 + i % 300, i / 2000, i, i / 2000, i % 50 + 1, i);
+    }
+    std::fclose(f);
+
+    AppState app;
+    Player* player = new Player(&app);
+    GtkWidget* window = gtk_offscreen_window_new();
+    gtk_window_set_default_size(GTK_WINDOW(window), 320, 360);
+    GtkWidget* scrolled = gtk_scrolled_window_new(NULL, NULL);
+    GtkWidget* view = gtk_tree_view_new();
+    gtk_container_add(GTK_CONTAINER(scrolled), view);
+    gtk_container_add(GTK_CONTAINER(window), scrolled);
+    gtk_widget_show_all(window);
+    PlaylistManager* mgr = new PlaylistManager(&app, player, view);
+
+    Probe probe;
+    probe.expected = g_get_monotonic_time() + 1000;
+    guint timer = g_timeout_add(1, [](gpointer d) -> gboolean {
+        Probe* probe = (Probe*)d;
+        gint64 now = g_get_monotonic_time();
+        probe->late.push_back(std::max<gint64>(0, now - probe->expected));
+        probe->expected = now + 1000;
+        return G_SOURCE_CONTINUE;
+    }, &probe);
+
+    gint64 start = g_get_monotonic_time();
+    mgr->addPaths({m3u}, true);
+    while (mgr->importing()) gtk_main_iteration();
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+    g_source_remove(timer);
+
+    std::sort(probe.late.begin(), probe.late.end());
+    auto pct = [&](double p) { return probe.late.empty() ? 0.0 : probe.late[(size_t)(p * (probe.late.size() - 1))] / 1000.0; };
+    std::printf("%zu entries imported in %.2f s, playing: %s\n", app.playlist.size(), seconds,
+                app.playing ? "yes" : "no");
+    std::printf("main loop lateness: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", pct(0.5), pct(0.99), pct(1.0));
+
+    gtk_widget_destroy(window);
+    delete mgr;
+    delete player;
+    return 0;
+}
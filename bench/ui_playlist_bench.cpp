@@ -0,0 +1,72 @@
+// Playlist view cost: PlaylistManager::refreshUI time (including the first
+// layout and draw) and resident memory at 1k, 10k and 100k entries.
+// Needs a display; headless: xvfb-run ./build/bin/bench/ui_playlist_bench
+//   make bench-ui && ./build/bin/bench/ui_playlist_bench
+#include "playlist.h"
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+static double rssMB() {
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0.0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+static void drainEvents() {
+    while (gtk_events_pending()) gtk_main_iteration();
+}
+
+int main(int argc, char** argv) {
+    if (!gtk_init_check(&argc, &argv)) {
+        std::fprintf(stderr, "No display (try xvfb-run)\n");
+        return 1;
+    }
+
+    std::printf("%8s %14s %14s %12s\n", "entries", "refreshUI ms", "first draw ms", "view RSS MB");
+
+    for (size_t n : {1000, 10000, 100000}) {
+        AppState app;
+        app.playlist.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            char path[128];
+            std::snprintf(path, sizeof(path), "/sdcard/Music/Artist %03zu/Album %02zu/%02zu - Track %zu.flac",
+                          i / 200, (i / 20) % 10, i % 20 + 1, i);
+            app.playlist.push_back(app.paths.add(path));
+        }
+        app.rows.reset(n);
+        app.play_order.reset(n);
+
+        GtkWidget* window = gtk_offscreen_window_new();
+        gtk_window_set_default_size(GTK_WINDOW(window), 320, 360);
+        GtkWidget* scrolled = gtk_scrolled_window_new(NULL, NULL);
+        GtkWidget* view = gtk_tree_view_new();
+        gtk_container_add(GTK_CONTAINER(scrolled), view);
+        gtk_container_add(GTK_CONTAINER(window), scrolled);
+        gtk_widget_show_all(window);
+
+        // refreshUI does not touch the player
+        PlaylistManager* mgr = new PlaylistManager(&app, nullptr, view);
+        drainEvents();
+        double before = rssMB();
+
+        auto start = std::chrono::steady_clock::now();
+        mgr->refreshUI();
+        auto refreshed = std::chrono::steady_clock::now();
+        drainEvents();
+        auto drawn = std::chrono::steady_clock::now();
+
+        std::printf("%8zu %14.2f %14.2f %12.1f\n", n,
+                    std::chrono::duration<double, std::milli>(refreshed - start).count(),
+                    std::chrono::duration<double, std::milli>(drawn - refreshed).count(),
+                    rssMB() - before);
+
+        gtk_widget_destroy(window);
+        delete mgr;
+        drainEvents();
+    }
+    return 0;
+}
@@ -2,6 +2,9 @@
 #define COMMON_H
 
 #include <gtk/gtk.h>
+#include "tags.h"
+#include "play_order.h"
+#include "path_store.h"
 #include <string>
 #include <vector>
 #include <atomic>
@@ -25,10 +28,14 @@ struct AppState {
     // Advanced Playback
     bool shuffle = false;
     int repeatMode = REP_OFF;
+    bool gapless = true;
     
     // Audio Data
-    std::vector<std::string> playlist;
-    std::vector<size_t> play_order; 
+    PathStore paths;                 // playlist entries point in here
+    std::vector<PathHandle> playlist;
+    std::vector<TrackInfo> tracks;   // parallel to playlist, filled as tags are read
+    OrderTree rows;                  // view row -> playlist index, reordered by drag and drop
+    PlayOrder play_order;            // with its inverse, see play_order.h
     int current_track_idx = -1;     
     double volume = 1.0;
     
@@ -0,0 +1,55 @@
+#ifndef DECODER_CACHE_H
+#define DECODER_CACHE_H
+
+#include <string>
+#include <unordered_map>
+
+// The demuxer/parser/decoder chain autoplugging picked for a kind of file,
+// remembered across runs so the next file of that kind is built straight
+// from it, without typefinding. A kind is its signature: the lower-case
+// extension and the first four bytes of the file, which name the container
+// and usually the codec ("mp3 49443304", "flac 664c6143"). Where the
+// container leaves the codec open, the bytes that name it follow: the
+// first packet of an Ogg stream ("ogg 4f676753 4f70757348656164" is
+// Opus), the format tag of a WAV. MP4 starts with a box size, so its
+// magic is the ftyp box type and major brand instead ("m4a 667479704d344120").
+// Other bytes run into per-file sizes (ID3, RIFF, MP4 boxes). Stored as
+// text, one line per signature with the typefound caps and the chain as
+// factory names ("id3demux ! mpegaudioparse ! mpg123audiodec"), rewritten
+// on change. Engine thread only.
+class DecoderCache {
+public:
+    static const size_t MAGIC_BYTES = 4;
+    // Read for a signature: an Ogg segment table can be 255 bytes
+    static const size_t HEAD_BYTES = 512;
+
+    // Loads `file` if there is one
+    explicit DecoderCache(const std::string& file);
+    DecoderCache(const DecoderCache&) = delete;
+    DecoderCache& operator=(const DecoderCache&) = delete;
+
+    // Empty when the file cannot be read
+    static std::string signature(const std::string& path);
+
+    bool lookup(const std::string& signature, std::string* chain);
+    void put(const std::string& signature, const std::string& caps, const std::string& chain);
+    // The chain failed on a file of this kind: autoplug it again
+    void forget(const std::string& signature);
+
+    size_t size() const { return entries.size(); }
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned failures = 0;
+
+private:
+    struct Entry {
+        std::string caps;
+        std::string chain;
+    };
+    void save();
+
+    std::string path;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+#endif
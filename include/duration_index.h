@@ -0,0 +1,36 @@
+#ifndef DURATION_INDEX_H
+#define DURATION_INDEX_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Track durations in play order, in milliseconds, as a Fenwick tree:
+// prefix sums, point updates and "which track holds time t" are O(log n),
+// appending is O(log n), building from a list O(n). Unknown durations are
+// 0 and are skipped over by find(). Integer milliseconds so that updates
+// as tags arrive never drift.
+class DurationIndex {
+public:
+    size_t size() const { return tree.size(); }
+    int64_t total() const { return sum; }
+
+    void build(const std::vector<int64_t>& durations);
+    void append(int64_t duration);
+    void set(size_t position, int64_t duration);
+    int64_t get(size_t position) const;
+    // Sum of the first `count` durations
+    int64_t prefix(size_t count) const;
+    // Position of the track playing at time t from the start and the
+    // offset into it; past the end, the last track and its length
+    size_t find(int64_t t, int64_t* offset) const;
+    void clear();
+
+    size_t memoryBytes() const { return tree.capacity() * sizeof(int64_t); }
+
+private:
+    std::vector<int64_t> tree;   // tree[i]: sum over (i - lowbit(i + 1), i]
+    int64_t sum = 0;
+};
+
+#endif
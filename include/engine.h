@@ -0,0 +1,184 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "decoder_cache.h"
+#include "pipeline.h"
+#include <gst/gst.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+// Audio tap: mono float samples, called on the streaming thread. Must not block.
+typedef void (*PcmCallback)(void* user_data, const float* samples, size_t count, int rate);
+
+enum EngineCommandType { CMD_LOAD, CMD_PLAY, CMD_PAUSE, CMD_STOP, CMD_SEEK, CMD_VOLUME, CMD_PREPARE, CMD_QUIT };
+
+struct EngineCommand {
+    EngineCommandType type;
+    std::string path;      // CMD_LOAD, CMD_PREPARE
+    double value = 0.0;    // CMD_SEEK (seconds), CMD_VOLUME, CMD_LOAD (start, seconds)
+    bool accurate = false; // CMD_SEEK: ACCURATE instead of KEY_UNIT
+    gint64 posted = 0;     // monotonic time the UI issued it, set by post()
+    unsigned generation = 0;  // CMD_LOAD, CMD_STOP: tags the events that follow
+};
+
+// EV_SEEK_DONE: the last CMD_SEEK landed (or failed); EV_SEEK_AUDIO: first
+// buffer after its flush reached the audio tap; EV_READY: GStreamer is
+// initialized and the pipeline built, sent once
+enum EngineEventType { EV_EOS, EV_ERROR, EV_STREAM_START, EV_TAGS, EV_DURATION, EV_POSITION,
+                       EV_SEEK_DONE, EV_SEEK_AUDIO, EV_READY };
+
+struct EngineEvent {
+    EngineEventType type;
+    unsigned generation = 0;  // of the load/stop the pipeline was serving
+    std::string text;      // EV_STREAM_START: gapless track that started; EV_TAGS: display name
+    double value = 0.0;    // EV_DURATION: seconds; EV_READY: gst_init time, ms
+
+    // EV_POSITION: stream position at a running time of `clock` (running is
+    // NONE when the pipeline is not PLAYING). The clock ref is released
+    // after delivery; take your own to keep it.
+    gint64 position = 0;
+    GstClockTime running = GST_CLOCK_TIME_NONE;
+    GstClockTime base_time = 0;
+    GstClock* clock = nullptr;
+};
+
+// Called on the GTK main thread for every event the engine posts
+typedef void (*EngineEventCallback)(void* user_data, const EngineEvent& event);
+
+// Owns the GStreamer pipelines on a dedicated thread with its own main
+// context. The UI only queues commands and reads posted events, so nothing
+// on the GTK main loop ever waits for a state change. gst_init runs on that
+// thread too: commands queue until it is done (EV_READY).
+class Engine {
+public:
+    Engine(EngineEventCallback cb, void* data, PipelineBackend backend = BACKEND_PLAYBIN);
+    ~Engine();
+
+    // Any thread. Never blocks on GStreamer.
+    void post(EngineCommand cmd);
+
+    // Gapless handoff, consumed by about-to-finish. An empty path clears it.
+    void setNext(const std::string& path);
+    // A next track was already handed to playbin and has not started yet
+    bool isQueued();
+
+    // Set before audio starts flowing
+    void setPcmCallback(PcmCallback cb, void* data);
+
+    static std::string toUri(const std::string& path);
+
+private:
+    // --- Engine thread ---
+    void run();
+    static gboolean dispatch(gpointer data);
+    void execute(const EngineCommand& cmd);
+    void load(const std::string& path, gint64 posted, double start);
+    // READY keeps the audio sink and its device open for the next track;
+    // NULL releases everything (stop, errors)
+    void stop(GstState state = GST_STATE_NULL);
+    void prepare(const std::string& path);
+    bool setSource(GstElement* bin, const std::string& path, std::string* signature);
+    bool retryAutoplug();
+
+    GstElement* createPipeline(const char* name, GstElement** tapOut);
+    void destroyPipeline(GstElement* bin);
+    bool isActiveBus(GstBus* bus);
+    static gboolean busCallback(GstBus* bus, GstMessage* msg, gpointer data);
+    void handleTags(GstTagList* tags);
+
+    void emit(EngineEvent event);
+    static gboolean deliver(gpointer data);
+    void postDuration();
+    void postPosition();
+
+    EngineEventCallback onEvent;
+    void* eventData;
+    PipelineBackend backend;
+
+    GMainContext* context = nullptr;
+    GMainLoop* loop = nullptr;
+    std::thread thread;
+
+    std::mutex queue_mutex;
+    std::deque<EngineCommand> queue;   // guarded by queue_mutex
+
+    GstElement* pipeline = nullptr;
+    double volume = 1.0;
+    std::atomic<unsigned> generation{0};
+    bool seeking = false;   // a flushing seek is waiting for ASYNC_DONE
+    double start_at = 0.0;  // seconds to seek to once the new track prerolls
+
+    // Standby pipeline, PAUSED and prerolled on the predicted skip target,
+    // and the tags its bus posted meanwhile
+    GstElement* standby = nullptr;
+    std::string standby_path;
+    GstTagList* standby_tags = nullptr;
+    void clearStandby();
+
+    // Fix: Guard against spurious EOS signals on resume
+    guint64 last_play_time = 0;
+
+    // Time to first audio: UI load request until the pipeline reaches
+    // PLAYING, and where the load started from: "cold" (NULL), "ready" or
+    // "standby"
+    gint64 load_time = 0;
+    const char* load_from = "cold";
+
+    // Decoder chains autoplugging picked, by file signature (lean pipeline
+    // only). Until the active load prerolls, load_signature is its file's:
+    // an autoplugged load teaches the cache its chain, a load built from a
+    // cached chain (load_direct) that fails is autoplugged again.
+    DecoderCache* decoders = nullptr;
+    std::string load_path;
+    std::string load_signature;
+    bool load_direct = false;
+
+    // UI input to dispatch latency, bucket b counts commands that waited <= 2^b us
+    static const int LATENCY_BUCKETS = 24;
+    unsigned latency[LATENCY_BUCKETS] = {};
+    unsigned latency_count = 0;
+    void recordLatency(gint64 us);
+    void reportLatency();
+
+    // --- Gapless: filled by the UI, consumed by about-to-finish on the streaming thread ---
+    // (playbin only: the lean pipeline ends each track with EOS)
+    std::mutex next_mutex;
+    std::string next_path;      // guarded by next_mutex
+    std::string next_uri;       // guarded by next_mutex
+    std::string queued_path;    // guarded by next_mutex: handed to playbin, not started yet
+    static void onAboutToFinish(GstElement* playbin, gpointer data);
+
+    // Identity element just before the sink of each pipeline
+    std::atomic<GstElement*> tap{nullptr};
+    GstElement* standby_tap = nullptr;
+    bool isActiveTap(GstPad* pad);
+    // The probes skip a standby tap's CAPS and SEGMENT; on the swap they are
+    // read back from its pad's sticky events
+    void adoptTap();
+
+    // PCM tap: format comes from the CAPS event, scratch is streaming-thread only
+    PcmCallback onPcm = nullptr;
+    void* pcmData = nullptr;
+    std::string pcm_format;
+    gint pcm_channels = 0;
+    gint pcm_rate = 0;
+    std::vector<float> pcm_scratch;
+    static GstPadProbeReturn pcmProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+
+    // Boundary gap measurement (TERMAMP_STATS=1)
+    GstSegment tap_segment;
+    gint tap_rate = 0;
+    GstClockTime tap_last_end = GST_CLOCK_TIME_NONE;
+    bool tap_boundary = false;
+    static GstPadProbeReturn gapProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+
+    // Seek-to-audio: armed by FLUSH_STOP, fires on the next buffer (streaming thread)
+    bool seek_flushed = false;
+    static GstPadProbeReturn seekProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+};
+
+#endif
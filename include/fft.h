@@ -0,0 +1,31 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+#include <cstddef>
+
+// Radix-2 complex FFT over split (structure-of-arrays) float buffers.
+// Twiddles are stored contiguously per stage so the butterfly loop is a
+// plain unit-stride loop the compiler vectorizes (SSE/AVX on x86, NEON on ARM).
+class FFT {
+public:
+    // size must be a power of two
+    explicit FFT(size_t size);
+
+    size_t size() const { return n; }
+
+    // In-place forward transform
+    void forward(float* re, float* im) const;
+
+    // Hann-windows `samples` (size() of them) and writes |X[k]| for k < size()/2
+    void magnitudes(const float* samples, float* out);
+
+private:
+    size_t n;
+    std::vector<unsigned> bitrev;
+    std::vector<float> tw_re, tw_im;   // stage h uses [h - 1, 2h - 1)
+    std::vector<float> window;
+    std::vector<float> work_re, work_im;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include "tags.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// A cached entry. Views point into the mapped index or the journal overlay
+// and stay valid until the next put(), compact() or destruction.
+struct LibraryEntry {
+    std::string_view title;
+    std::string_view artist;
+    std::string_view album;
+    double duration = 0.0;
+    FileStamp stamp;
+
+    TrackInfo toInfo() const;
+};
+
+// Persistent metadata index, one per user:
+//   library.idx      columnar, mapped read-only at open, never parsed
+//   library.journal  puts since the last compaction, replayed at open
+// The index holds a string pool (directories, file names, tag text, each
+// stored once), one column per field, and an open-addressing hash table
+// over the path hashes, so lookup() is O(1) without touching other rows.
+// Native byte order: it is a local cache, rebuilt if it does not validate.
+class Library {
+public:
+    // Opens (or starts) the index in dir; the directory is created if needed
+    explicit Library(const std::string& dir);
+    // Compacts when the journal has grown long
+    ~Library();
+    Library(const Library&) = delete;
+    Library& operator=(const Library&) = delete;
+
+    bool lookup(const std::string& path, LibraryEntry* out) const;
+    // Buffered until flush()
+    void put(const std::string& path, const FileStamp& stamp, const TrackInfo& info);
+    // Appends buffered puts to the journal in one write
+    void flush();
+    // Rewrites the index with the journal folded in, then empties the journal
+    bool compact();
+
+    size_t size() const;
+    size_t journalRecords() const { return overlay.size(); }
+
+    // $XDG_CACHE_HOME/termamp, else ~/.cache/termamp
+    static std::string defaultDir();
+
+private:
+    struct Header;
+
+    bool mapIndex();
+    void unmapIndex();
+    void replayJournal();
+    bool findMapped(const std::string& path, uint32_t* row) const;
+    std::string_view pooled(uint32_t ref) const;
+
+    struct Record {
+        FileStamp stamp;
+        TrackInfo info;
+    };
+
+    std::string indexPath;
+    std::string journalPath;
+
+    // Mapped index
+    void* map = nullptr;
+    size_t mapSize = 0;
+    const Header* header = nullptr;
+
+    // Journal: replayed records plus puts since, newest wins
+    std::unordered_map<std::string, Record> overlay;
+    std::string pending;    // encoded puts not written yet
+    int journalFd = -1;
+};
+
+#endif
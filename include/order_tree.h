@@ -0,0 +1,69 @@
+#ifndef ORDER_TREE_H
+#define ORDER_TREE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// A sequence of the ids [0, n), each once, where at(), indexOf(), move()
+// and insert() are all O(log n). An implicit treap: node `id` holds id,
+// subtree sizes give positions, parent links walk back up from a node for
+// indexOf(). Priorities are a hash of the id, so nodes are 16 bytes.
+// Until the first edit the sequence is 0, 1, 2... and nothing is stored.
+class OrderTree {
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t at(size_t position) const {
+        return identity ? (uint32_t)position : nodeAt(position);
+    }
+    size_t indexOf(uint32_t id) const {
+        return identity ? id : positionOfNode(id);
+    }
+
+    // 0, 1, 2... over n ids
+    void reset(size_t n);
+    void clear() { reset(0); }
+    // Any permutation of [0, n), built in O(n)
+    void assign(const std::vector<uint32_t>& sequence);
+    // Ids [size(), n) were added: they go last, in order
+    void extend(size_t n);
+    // The next new id, size(), goes in at `position`
+    void insert(size_t position);
+    // The id at `from` is taken out and put back so it ends up at `to`
+    void move(size_t from, size_t to);
+    // These ids (ascending, no duplicates) are dropped and the rest
+    // renumbered to stay dense, in their current order. O(n).
+    void erase(const std::vector<size_t>& ids);
+    // The whole sequence, in O(n)
+    void sequence(std::vector<uint32_t>* out) const;
+
+    // Heap bytes held by the nodes (0 until the first edit)
+    size_t memoryBytes() const;
+
+private:
+    static const uint32_t NIL = UINT32_MAX;
+    struct Node {
+        uint32_t left, right, parent, size;
+    };
+
+    uint32_t nodeAt(size_t position) const;
+    size_t positionOfNode(uint32_t id) const;
+    static uint32_t priority(uint32_t id);
+    uint32_t sizeOf(uint32_t node) const { return node == NIL ? 0 : nodes[node].size; }
+    void setLeft(uint32_t node, uint32_t child);
+    void setRight(uint32_t node, uint32_t child);
+    void update(uint32_t node) { nodes[node].size = sizeOf(nodes[node].left) + sizeOf(nodes[node].right) + 1; }
+    uint32_t merge(uint32_t a, uint32_t b);
+    void split(uint32_t node, size_t k, uint32_t* a, uint32_t* b);
+    void setRoot(uint32_t node);
+    void materialize();
+    void reserveNodes(size_t n);
+
+    size_t count = 0;
+    bool identity = true;
+    std::vector<Node> nodes;    // nodes[id]
+    uint32_t root = NIL;
+};
+
+#endif
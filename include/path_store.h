@@ -0,0 +1,61 @@
+#ifndef PATH_STORE_H
+#define PATH_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Index of a path in a PathStore; stays valid until clear()
+typedef uint32_t PathHandle;
+
+// Append-only store for playlist paths. Directories are interned as a tree
+// of components ("/", "storage/", "emulated/", ...), each stored once, and
+// every path is its directory node plus a file name slice; all text lives
+// in one arena. A path costs 12 bytes plus its file name, instead of a
+// std::string with its own heap block for the whole path.
+class PathStore {
+public:
+    PathHandle add(std::string_view path);
+
+    std::string path(PathHandle handle) const;
+    // Replaces *out with the path, reusing its buffer
+    void pathInto(PathHandle handle, std::string* out) const;
+    // Last component; valid until the next add()
+    std::string_view name(PathHandle handle) const;
+    bool equals(PathHandle handle, std::string_view path) const;
+
+    size_t size() const { return entries.size(); }
+    size_t directories() const { return dirs.size(); }
+    size_t memoryBytes() const;
+    void clear();
+
+private:
+    struct Dir {
+        uint32_t parent;
+        uint32_t text;      // component, with its trailing '/'
+        uint32_t length;
+        uint32_t prefixLength;   // whole directory path up to here
+    };
+    struct Entry {
+        uint32_t dir;
+        uint32_t text;
+        uint32_t length;
+    };
+
+    uint32_t internDir(std::string_view dir);
+    uint32_t child(uint32_t parent, std::string_view component);
+    uint32_t store(std::string_view text);
+    void grow();
+
+    std::vector<char> arena;
+    std::vector<Dir> dirs;          // dirs[0] is the empty root
+    std::vector<Entry> entries;
+    std::vector<uint32_t> table;    // open addressing over (parent, component): dir + 1, 0 empty
+    // Paths come in directory order: the last directory is reused as is
+    std::string lastDir;
+    uint32_t lastDirId = 0;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <gst/gst.h>
+#include <string>
+
+// How tracks are decoded. PLAYBIN autoplugs whatever a file holds and can
+// hand over to the next URI gaplessly (about-to-finish). LEAN is
+// uridecodebin, kept to audio, into audioconvert ! audioresample ! volume
+// ! tap ! sink: fewer plugins loaded and less built per track, but no
+// gapless handoff.
+enum PipelineBackend { BACKEND_PLAYBIN, BACKEND_LEAN };
+
+// Builds either kind and drives it with the same calls. Needs only
+// GStreamer, so the gst_* benchmarks link it without the app.
+class Pipeline {
+public:
+    // TERMAMP_BACKEND=lean picks LEAN, anything else PLAYBIN
+    static PipelineBackend backendFromEnv();
+    static const char* backendName(PipelineBackend backend);
+
+    // `sink` is an element factory name. `tap` gets the identity element
+    // just before it, owned by the pipeline. NULL when an element is missing.
+    static GstElement* create(PipelineBackend backend, const char* name, const char* sink, GstElement** tap);
+    // In NULL or READY
+    static void setUri(GstElement* bin, const char* uri);
+    // Lean only, in NULL or READY: decodes the file at `path` with `chain`,
+    // factory names as autoplugged() gives them, instead of typefinding and
+    // autoplugging. False (pipeline unchanged) if it cannot be built; a
+    // chain that does not fit the file fails with an error message.
+    static bool setChain(GstElement* bin, const char* path, const std::string& chain);
+    // Lean only, after a preroll that autoplugged: the chain it picked and
+    // the caps typefinding found
+    static bool autoplugged(GstElement* bin, std::string* chain, std::string* caps);
+    static void setVolume(GstElement* bin, double volume);
+    // Only playbin takes a next URI from about-to-finish
+    static bool isPlaybin(GstElement* bin);
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef PLAY_ORDER_H
+#define PLAY_ORDER_H
+
+#include "order_tree.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Seeded bijection over [0, n), computed per call instead of stored.
+// A Feistel network on the smallest power of two covering n, split into
+// halves of floor/ceil bits (so the domain is under 2n), with cycle-walking
+// to stay inside [0, n): values that land at or past n are encrypted again
+// until they come back in range, about twice on average at worst.
+class KeyedPermutation {
+public:
+    void init(size_t n, unsigned seed);
+    size_t forward(size_t x) const;
+    size_t inverse(size_t y) const;
+
+private:
+    static const int ROUNDS = 6;
+
+    uint64_t encrypt(uint64_t x) const;
+    uint64_t decrypt(uint64_t y) const;
+    uint64_t round(int i, uint64_t half) const;
+
+    uint64_t n = 0;
+    int lowBits = 0;        // ceil(bits / 2)
+    int highBits = 0;       // floor(bits / 2)
+    uint64_t keys[ROUNDS] = {};
+};
+
+// Playback order over playlist indices, with its inverse:
+// order[position] is a playlist index, positionOf(index) its place in the
+// order. Three representations behind the same calls:
+//   identity  shuffle off: the row order (see setRows), or 0, 1, 2...
+//             without one. No storage of its own, O(1) or the rows' cost
+//   keyed     after a shuffle: a KeyedPermutation over the entries there
+//             were then, no storage, O(1). Entries added since sit in a
+//             small OrderTree of their own, each with the gap between
+//             permuted entries it went into; reads merge the two in
+//             O(log^2 m) for m added entries
+//   tree      after edits a bijection cannot express (deleting from a
+//             shuffled order, moving an entry, adding more than the
+//             shuffle held): an OrderTree, 16 bytes per entry, O(log n)
+//             lookups and moves
+// reset() and shuffle() drop back to the storage-free forms.
+class PlayOrder {
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t operator[](size_t position) const {
+        if (mode == TREE) return tree.at(position);
+        if (mode == KEYED) return added.empty() ? keyed.forward(position) : mergedAt(position);
+        return rows ? rows->at(position) : position;
+    }
+    size_t positionOf(size_t index) const {
+        if (mode == TREE) return tree.indexOf(index);
+        if (mode == KEYED) return added.empty() ? keyed.inverse(index) : mergedPositionOf(index);
+        return rows ? rows->indexOf(index) : index;
+    }
+
+    // The view's row order, followed while unshuffled. The owner keeps it
+    // the same size as this order and applies the same appends and erases.
+    void setRows(const OrderTree* rowOrder) { rows = rowOrder; }
+    // Identity order over n entries
+    void reset(size_t n);
+    void clear();
+    // Playlist entries [size(), n) were appended: they go last, in order
+    void extend(size_t n);
+    // Like extend(), but each new entry is inserted at a uniformly random
+    // position in [from, size]: the random-insertion form of Fisher-Yates,
+    // so positions before `from` (already played) do not move and the
+    // cost follows the batch, not the playlist. With from == 0 the whole
+    // list is simply reshuffled.
+    void extendShuffled(size_t n, size_t from, unsigned seed);
+    // Pseudo-random permutation from the seed, same seed same order
+    void shuffle(unsigned seed);
+    // The entry at position `from` now plays at `to`, the rest keep their
+    // relative order ("play next" is a move to just after the current one)
+    void move(size_t from, size_t to);
+    // Playlist entry `index` was removed: drops it and renumbers the
+    // entries after it, keeping the relative order of everything else
+    void erase(size_t index);
+    // Same for several entries (ascending, no duplicates), in O(n)
+    // however many there are
+    void erase(const std::vector<size_t>& indices);
+
+    // Playlist indices in play order, in O(n)
+    void sequence(std::vector<uint32_t>* out) const;
+
+    // Heap bytes held by the trees (0 in identity and plain keyed form)
+    size_t memoryBytes() const;
+
+private:
+    enum Mode { IDENTITY, KEYED, TREE };
+
+    // Writes out the current order as a tree
+    void materialize();
+
+    // --- Keyed form with added entries ---
+    // Added entry i (in order) plays at addedGap[i's id] + i
+    size_t addedPosition(size_t i) const { return addedGap[added.at(i)] + i; }
+    size_t addedBefore(size_t position) const;
+    size_t mergedAt(size_t position) const;
+    size_t mergedPositionOf(size_t index) const;
+    void insertAdded(size_t position);
+    void clearAdded();
+    bool addedOutgrown() const;
+
+    Mode mode = IDENTITY;
+    size_t count = 0;
+    KeyedPermutation keyed;
+    size_t keyedCount = 0;          // entries the permutation covers
+    OrderTree added;                // ids: playlist index - keyedCount
+    std::vector<uint32_t> addedGap; // by id: permuted entries before it
+    OrderTree tree;
+    const OrderTree* rows = nullptr;
+};
+
+#endif
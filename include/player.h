@@ -2,17 +2,34 @@
 #define PLAYER_H
 
 #include "common.h"
+#include "engine.h"
+#include "prefetch.h"
 #include <gst/gst.h>
 #include <functional>
 
 typedef void (*EOSCallback)(void* user_data);
 
+// Gapless: asked on the main thread for the path that should follow the
+// current track. Return false when playback should end after this track.
+typedef bool (*NextTrackCallback)(void* user_data, std::string* path);
+// Gapless: the queued track has actually started playing.
+typedef void (*TrackChangedCallback)(void* user_data);
+// Something the UI shows changed (state, track, duration, position anchor).
+// Always called on the main thread.
+typedef void (*PlayerEventCallback)(void* user_data);
+
+// Main-thread face of the engine: updates AppState right away, queues the
+// actual GStreamer work and folds the engine's events back into AppState.
 class Player {
 public:
+    // Starts the engine, which initializes GStreamer on its own thread.
+    // Commands are queued until it is ready.
     Player(AppState* state);
     ~Player();
+    bool isReady() const { return ready; }
 
-    void load(const std::string& uri);
+    // Starts `start` seconds in when given (playlist-level seeks)
+    void load(const std::string& uri, double start = 0.0);
     void play();
     void pause();
     void stop();
@@ -20,24 +37,75 @@ public:
     GstState getState();
     
     void setVolume(double volume);
-    void seek(double seconds);
+    // Coalesced: at most one seek in flight, newer requests replace queued ones.
+    // Scrubbing seeks are KEY_UNIT and settle into one ACCURATE seek.
+    void seek(double seconds, bool scrubbing = false);
     double getPosition();
     double getDuration();
 
     void setEOSCallback(EOSCallback cb, void* data);
-    static gboolean busCallback(GstBus* bus, GstMessage* msg, gpointer data);
+    void setEventCallback(PlayerEventCallback cb, void* data);
+
+    // --- Gapless ---
+    void setTrackCallbacks(NextTrackCallback next, NextTrackCallback skip,
+                           TrackChangedCallback changed, void* data);
+    // Re-asks the playlist for the next track (call after order/repeat changes)
+    void refreshNext();
+
+    // --- Audio tap ---
+    void setPcmCallback(PcmCallback cb, void* data);
+
+    // --- Standby ---
+    // Prerolls path in a second pipeline; an empty path releases it
+    void prepare(const std::string& path);
 
 private:
     AppState* app;
-    GstElement* pipeline;
+    Engine* engine = nullptr;
+    bool ready = false;
+    bool heard = false;   // startup timeline: audio has played once
+    void send(EngineCommandType type, const std::string& path = "", double value = 0.0);
+    // Bumped by load/stop so events still in flight for the old track are dropped
+    unsigned generation = 0;
+    static void onEngineEvent(void* data, const EngineEvent& event);
     
     EOSCallback onEOS = nullptr;
     void* eosData = nullptr;
-    
-    void handleTags(GstTagList* tags);
-    
-    // Fix: Guard against spurious EOS signals on resume
-    guint64 last_play_time = 0; 
+
+    // Event-driven UI: cached duration and a clock-interpolated position
+    PlayerEventCallback onEvent = nullptr;
+    void* eventData = nullptr;
+    double duration = 0.0;
+    gint64 anchor_pos = 0;
+    GstClockTime anchor_running = GST_CLOCK_TIME_NONE;
+    GstClockTime anchor_base = 0;
+    GstClock* clock = nullptr;
+    void setAnchor(gint64 pos, GstClock* anchorClock, GstClockTime base, GstClockTime running);
+    void notify();
+
+    // Seek scheduler
+    bool seek_in_flight = false;
+    bool seek_queued = false;
+    double seek_target = 0.0;         // newest requested position
+    bool seek_accurate = false;       // of the queued request
+    gint64 seek_requested = 0;        // when the queued target was asked for
+    gint64 seek_audio_from = 0;       // request time of the in-flight seek, 0 if not timed
+    bool seek_audio_accurate = false;
+    guint settle_source = 0;
+    unsigned seek_requests = 0;       // stats: requests and dispatched seeks per burst
+    unsigned seek_dispatches = 0;
+    void dispatchSeek();
+    void resetSeeks();
+    static gboolean onSeekSettled(gpointer data);
+
+    // Next track into the page cache: the gapless one, else the skip target
+    Prefetcher prefetcher;
+
+    // Gapless: asked on the main thread, handed to the engine
+    NextTrackCallback onNextTrack = nullptr;
+    NextTrackCallback onSkipTarget = nullptr;
+    TrackChangedCallback onTrackChanged = nullptr;
+    void* trackData = nullptr;
 };
 
 #endif
@@ -3,36 +3,154 @@
 
 #include "common.h"
 #include "player.h"
+#include "playlist_model.h"
+#include "library.h"
+#include "scanner.h"
+#include "duration_index.h"
+#include "search_index.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Main thread: an import started, appended rows or ended
+typedef void (*ImportCallback)(void* data);
 
 class PlaylistManager {
 public:
-    PlaylistManager(AppState* state, Player* player, GtkWidget* listBox);
+    PlaylistManager(AppState* state, Player* player, GtkWidget* view);
+    ~PlaylistManager();
     
     // File Ops
     void addFiles();
+    // Files, directories (recursively) and playlists, appended in order by
+    // a background import; with play, the first row to arrive starts.
+    // Paths added while an import runs are imported after it.
+    void addPaths(const std::vector<std::string>& paths, bool play = false);
+    // Rows already appended stay
+    void cancelImport();
+    bool importing() const { return importActive; }
+    size_t importedCount() const { return importAdded; }
+    void setImportCallback(ImportCallback cb, void* data);
     void clear();
     void refreshUI();
+    // Rows of the view from `from` on were appended
+    void appendUI(size_t from);
+
+    // Shows only the rows whose file name or tags hold every word of the
+    // query, case-insensitively; a query of one letter or none shows all
+    void setFilter(const std::string& query);
+    bool filtering() const { return filtered; }
     
     // Controls
-    void onRowActivated(GtkListBox* box, GtkListBoxRow* row);
+    void onRowActivated(int index);
+    void activateSelected();
     void selectNext();
     void selectPrev();
     void deleteSelected();
+    // Moves a row, e.g. from a drop; unshuffled that reorders playback too
+    void moveRow(size_t from, size_t to);
+    // Queues the selected rows to play right after the current track
+    void playSelectedNext();
     void playNext();
     void playPrev();
     void autoAdvance();
 
+    // Whole playlist in play order: time before the current track plus its
+    // position, and the sum of the durations known so far. False when none
+    // are known yet.
+    bool playlistTime(double* elapsed, double* total);
+    // Plays from a time in the whole playlist: the track that holds it, at
+    // the offset into it
+    void seekPlaylist(double seconds);
+
     // NEW: State Toggles
     void toggleShuffle();
     void toggleRepeat();
 
+    // Gapless hooks (see Player::setTrackCallbacks)
+    bool peekNextPath(std::string* path);
+    // Where playNext would go, for the player's standby preroll
+    bool peekSkipPath(std::string* path);
+    void commitGaplessAdvance();
+
 private:
     void highlightCurrentTrack();
+    // Playlist index of the current track, SIZE_MAX when there is none
+    size_t currentEntry();
+    void playEntry(size_t entry);
+    // Rows of the view, which skips rows the filter hides
+    size_t viewSize() const { return filtered ? filterRows.size() : app->playlist.size(); }
+    size_t entryAt(size_t viewRow) const { return app->rows.at(filtered ? filterRows[viewRow] : viewRow); }
+    // -1 when the filter hides it
+    int rowOf(size_t entry) const;
+    void indexEntry(size_t entry);
+    // filterRows from filterEntries, after rows moved or went away
+    void placeFilter();
+    static void onRowMoved(void* data, size_t from, size_t to);
+    int nextOrderIndex();
+    int selectedIndex();
+    void selectIndex(int index, bool scroll);
+    // Tag reading: results are applied on the main thread
+    static void onTagsRead(void* data, std::vector<TagResult>& batch);
+    void applyTags(std::vector<TagResult>& batch);
+    // Durations in play order; rebuilt on the next query after the order
+    // changes, updated in place as durations arrive
+    void ensureDurations();
+    void invalidateDurations() { durationsStale = true; }
+
+    // Import: scanned on a worker, appended in time-boxed idle callbacks
+    struct ImportBatch {
+        unsigned generation = 0;
+        std::vector<std::string> paths;
+        std::vector<ScanInfo> info;
+        bool last = false;      // scan finished; stats are set
+        ScanStats stats;
+    };
+    void startImport(const std::vector<std::string>& paths);
+    static void importWorker(PlaylistManager* mgr, std::vector<std::string> paths, unsigned generation);
+    void postImport(ImportBatch&& batch);
+    static gboolean onImportIdle(gpointer data);
+    void applyImport(ImportBatch& batch);
+    void finishImport(const ScanStats& stats);
 
     AppState* app;
     Player* player;
-    GtkWidget* listBox; 
+    GtkWidget* view;
+    GtkTreeModel* model;
     GtkWidget* parentWindow;
+    TagPool* tagPool;
+    Library* library;     // tag cache across sessions
+
+    // Playlist index handed to the player for the gapless transition
+    size_t gapless_next = 0;
+
+    DurationIndex durations;
+    bool durationsStale = false;
+
+    SearchIndex search;                    // file name and tags per playlist entry
+    bool filtered = false;
+    std::string filterQuery;
+    std::vector<uint32_t> filterEntries;   // playlist indices matching, ascending
+    std::vector<uint32_t> filterRows;      // their row positions, ascending: the view
+    bool filterExact = true;               // filterEntries are all matches of filterQuery,
+                                           // so a longer query only looks among them
+
+    std::thread importThread;
+    std::mutex importMutex;
+    std::deque<ImportBatch> importQueue;   // under importMutex
+    Scanner* importScanner = nullptr;      // under importMutex, while scanning
+    guint importSource = 0;                // under importMutex
+    std::atomic<bool> importCancelled{false};
+    unsigned importGeneration = 0;         // batches from before a cancel are dropped
+    bool importActive = false;
+    bool importPlay = false;
+    size_t importAdded = 0;
+    size_t importKnown = 0;
+    gint64 importStart = 0;
+    std::deque<std::vector<std::string>> importWaiting;
+    ImportCallback onImport = nullptr;
+    void* importData = nullptr;
 };
 
 #endif
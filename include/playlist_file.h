@@ -0,0 +1,71 @@
+#ifndef PLAYLIST_FILE_H
+#define PLAYLIST_FILE_H
+
+#include "tags.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+
+// One entry of a playlist file. Views point into the mapped file, or into
+// the parser's own storage where text had to be decoded (XML entities,
+// percent-escapes), and stay valid until the PlaylistFile goes away.
+struct PlaylistEntry {
+    std::string_view location;   // path, or URL for streams
+    std::string_view title;
+    std::string_view artist;
+    std::string_view album;
+    double duration = 0.0;       // seconds, 0 if the playlist did not say
+    bool relative = false;       // location is relative to PlaylistFile::dir()
+
+    // Enough to show the row without reading the file's tags
+    bool hasInfo() const { return !title.empty() && duration > 0.0; }
+    TrackInfo toInfo() const;
+};
+
+// M3U/M3U8 (with #EXTINF), PLS and XSPF playlists. The file is mapped and
+// scanned in place with memchr as next() is called, so nothing is held per
+// entry (PLS, which may number entries in any order, is collected at
+// open()). Relative locations share one directory prefix until resolve()
+// builds the full path.
+class PlaylistFile {
+public:
+    enum Format { M3U, PLS, XSPF };
+
+    PlaylistFile() = default;
+    ~PlaylistFile();
+    PlaylistFile(const PlaylistFile&) = delete;
+    PlaylistFile& operator=(const PlaylistFile&) = delete;
+
+    // Format from the extension, else from the first bytes
+    bool open(const std::string& path);
+
+    // Next entry in playlist order, false at the end
+    bool next(PlaylistEntry* entry);
+
+    Format format() const { return fmt; }
+    // Directory of the playlist, with trailing slash ("" for the cwd)
+    const std::string& dir() const { return prefix; }
+    std::string resolve(const PlaylistEntry& entry) const;
+
+private:
+    bool nextM3u(PlaylistEntry* entry);
+    bool nextXspf(PlaylistEntry* entry);
+    void parsePls();
+    // Classifies location and strips file:// (percent-decoding URIs);
+    // false if there is nothing left to play
+    bool setLocation(PlaylistEntry* entry, std::string_view location, bool uri);
+    std::string_view keep(std::string text);
+
+    void* map = nullptr;
+    size_t mapSize = 0;
+    const char* cursor = nullptr;
+    const char* end = nullptr;
+    Format fmt = M3U;
+    std::string prefix;
+    std::vector<PlaylistEntry> pls;   // PLS entries, handed out by next()
+    size_t plsNext = 0;
+    std::deque<std::string> owned;   // deque: views stay put as it grows
+};
+
+#endif
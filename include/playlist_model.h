@@ -0,0 +1,35 @@
+#ifndef PLAYLIST_MODEL_H
+#define PLAYLIST_MODEL_H
+
+#include "common.h"
+
+// GtkTreeModel over AppState::playlist, in AppState::rows order. Nothing
+// is stored per row: the view asks only for the rows it is drawing and
+// labels are built on demand. Iterators carry the row number.
+enum { PLAYLIST_COL_LABEL, PLAYLIST_COL_TIME, PLAYLIST_N_COLUMNS };
+
+// A row was dropped so it ends up at `to`; the owner moves it and calls
+// playlist_model_row_moved
+typedef void (*PlaylistMoveCallback)(void* data, size_t from, size_t to);
+
+GtkTreeModel* playlist_model_new(AppState* app);
+// Accepts row drags from views of this model (gtk_tree_view_set_reorderable)
+void playlist_model_set_move_callback(GtkTreeModel* model, PlaylistMoveCallback cb, void* data);
+
+// The playlist changed wholesale: invalidates iterators. Views must be
+// detached (gtk_tree_view_set_model NULL) around it.
+void playlist_model_reset(GtkTreeModel* model);
+// Shows only these rows (ascending positions in AppState::rows, kept by
+// the caller), or every row with NULL. Row numbers below are then rows
+// of the view. Like a reset, with views detached; rows cannot be dragged.
+void playlist_model_set_filter(GtkTreeModel* model, const std::vector<uint32_t>* rows);
+// Rows [from, end of the view) were appended
+void playlist_model_rows_appended(GtkTreeModel* model, size_t from);
+// These rows (ascending) were removed from the playlist, which is already
+// compacted
+void playlist_model_rows_deleted(GtkTreeModel* model, const std::vector<size_t>& rows);
+// AppState::rows already has the row at `from` moved to `to`
+void playlist_model_row_moved(GtkTreeModel* model, size_t from, size_t to);
+void playlist_model_row_changed(GtkTreeModel* model, size_t row);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Pulls the track expected to play next into the page cache while the
+// current one plays, so its first reads at the boundary do not wait on
+// an SD card or a FUSE mount. Files up to WHOLE_FILE_BYTES are read
+// whole, larger ones up to HEAD_BYTES: posix_fadvise(WILLNEED) over the
+// range, then readahead() chunk by chunk (pread() where readahead is not
+// supported). A new prediction cancels the one in progress between
+// chunks. One worker thread; the calls are for the main thread.
+class Prefetcher {
+public:
+    static const size_t WHOLE_FILE_BYTES = 12 << 20;
+    static const size_t HEAD_BYTES = 2 << 20;
+    static const size_t CHUNK_BYTES = 256 << 10;
+
+    struct Stats {
+        unsigned loads = 0;      // tracks loaded
+        unsigned hits = 0;       // ...that were read ahead in full
+        unsigned partial = 0;    // ...whose read-ahead was still running
+        unsigned cancelled = 0;  // read-aheads dropped for a newer prediction
+        uint64_t bytes = 0;      // read ahead in total
+    };
+
+    Prefetcher();
+    ~Prefetcher();
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    // Replaces the prediction; the same path again changes nothing, an
+    // empty one only cancels
+    void predict(const std::string& path);
+    // A track started loading: scores the prediction
+    void loaded(const std::string& path);
+    // The read-ahead of `path` has finished
+    bool ready(const std::string& path);
+    Stats stats();
+
+private:
+    void run();
+    // 1 finished, 0 cancelled, -1 unreadable
+    int warm(const std::string& path, unsigned ticket, uint64_t* bytes);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::string target;     // guarded by mutex
+    std::string done;       // guarded by mutex: last read-ahead that finished
+    bool pending = false;   // guarded by mutex: target not started yet
+    bool working = false;   // guarded by mutex
+    bool quit = false;      // guarded by mutex
+    Stats counts;           // guarded by mutex
+    std::atomic<unsigned> ticket{0};  // bumped per prediction, checked between chunks
+    std::thread worker;
+};
+
+#endif
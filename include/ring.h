@@ -0,0 +1,63 @@
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// One thread may push, one (other) thread may pop; neither ever blocks.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (and drops the item) when full.
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+        buf[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side. Copies as many items as fit, returns how many.
+    size_t pushBulk(const T* items, size_t count) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t space = Capacity - (h - tail.load(std::memory_order_acquire));
+        if (count > space) count = space;
+        for (size_t i = 0; i < count; i++) buf[(h + i) & (Capacity - 1)] = items[i];
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = buf[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Copies up to max items, returns how many.
+    size_t popBulk(T* out, size_t max) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t avail = head.load(std::memory_order_acquire) - t;
+        if (max > avail) max = avail;
+        for (size_t i = 0; i < max; i++) out[i] = buf[(t + i) & (Capacity - 1)];
+        tail.store(t + max, std::memory_order_release);
+        return max;
+    }
+
+    // Approximate when called from a third thread
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head{0};   // written by the producer
+    alignas(64) std::atomic<size_t> tail{0};   // written by the consumer
+    T buf[Capacity];
+};
+
+#endif
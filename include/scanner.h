@@ -0,0 +1,57 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include "tags.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+// What a playlist file said about one of its entries (see PlaylistFile)
+struct ScanInfo {
+    size_t offset;      // into the batch
+    TrackInfo info;
+};
+
+// Receives expanded paths in playlist order, on the thread running scan(),
+// with metadata for the entries that came from playlists carrying it
+// (usually none). Both may be moved from.
+typedef void (*ScanBatchCallback)(void* user_data, std::vector<std::string>& batch,
+                                  std::vector<ScanInfo>& info);
+
+struct ScanStats {
+    size_t files = 0;
+    size_t dirs = 0;
+    double seconds = 0.0;
+};
+
+// Expands files, directories and playlists into audio file paths.
+// Directory trees are walked by a small thread pool; each directory is
+// listed with batched getdents64 (fstatat only where d_type is unknown or
+// a symlink). Output order is stable: arguments in order, each directory's
+// files sorted by name, then its subdirectories depth-first.
+class Scanner {
+public:
+    static const size_t BATCH = 512;
+
+    // 0 picks hardware concurrency, capped at MAX_THREADS
+    explicit Scanner(unsigned threads = 0);
+
+    // Blocks until done or cancelled
+    ScanStats scan(const std::vector<std::string>& roots, ScanBatchCallback sink, void* data);
+    // Any thread: scan() returns soon after, with what it delivered so far
+    void cancel();
+
+    // Case-insensitive extension checks against precomputed tables
+    static bool isAudioFile(const char* name, size_t len);
+    static bool isPlaylistFile(const char* name, size_t len);
+    static bool isAudioFile(const std::string& name) { return isAudioFile(name.c_str(), name.size()); }
+    static bool isPlaylistFile(const std::string& name) { return isPlaylistFile(name.c_str(), name.size()); }
+
+private:
+    static const unsigned MAX_THREADS = 8;
+    unsigned threads;
+    std::atomic<bool> cancelled{false};
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Substring search over many short entries (file name, title, artist,
+// album). Each entry's fields are kept case-folded in one record of a
+// shared arena, and every byte, bigram and trigram of a record lists the
+// record. Terms of up to three bytes are a gram each, and their lists are
+// their answer without a check; longer terms only check the records listed
+// under their rarest trigrams. ASCII letters match either case; other
+// bytes match exactly.
+//
+// Gram lists only grow: text an entry no longer has leaves its grams
+// behind. Such records are marked loose and always checked, which costs a
+// few extra candidates, never a wrong answer.
+class SearchIndex {
+public:
+    size_t size() const { return recordOf.size(); }
+
+    // Entry `id` now has these fields, replacing what it had. Entries are
+    // added in order (id == size()) and set again as their tags arrive.
+    void set(uint32_t id, std::initializer_list<std::string_view> fields);
+    // These ids (ascending, no duplicates) are dropped and the rest
+    // renumbered to stay dense, like OrderTree::erase. O(n): the gram
+    // lists keep record numbers, only the map to entries changes.
+    void erase(const std::vector<size_t>& ids);
+    void clear();
+
+    // Ids (ascending) of the entries holding every term, each inside one
+    // field. With `within`, only those ids (ascending) are tried: the
+    // results for a query this one extends.
+    void search(const std::vector<std::string>& terms, const std::vector<uint32_t>* within,
+                std::vector<uint32_t>* out);
+
+    // Folded words of a query, split on blanks
+    static std::vector<std::string> terms(std::string_view query);
+    // Where `term` first occurs in `text` from `from` on, both folded;
+    // npos when it does not
+    static size_t locate(std::string_view text, std::string_view term, size_t from = 0);
+    static bool contains(std::string_view text, std::string_view term) {
+        return locate(text, term) != std::string_view::npos;
+    }
+
+    size_t memoryBytes() const;
+
+private:
+    // Record numbers as varint gaps; a 0 gap is followed by an absolute
+    // number, for records that come in below the last one (tags read out
+    // of order)
+    struct Posting {
+        std::vector<uint8_t> bytes;
+        uint32_t last = 0;
+        uint32_t count = 0;
+        bool sorted = true;
+    };
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::string_view record(uint32_t r) const {
+        return std::string_view(text.data() + starts[r], lengths[r]);
+    }
+    uint32_t newRecord(uint32_t id, std::string_view folded);
+    bool matches(uint32_t r, const std::vector<std::string>& terms) const;
+    // One pass over the whole arena for the longest term to check; the
+    // records of the pool it hits are checked for the rest (for every term
+    // if loose). Needs the arena in record order.
+    void scan(const std::vector<std::string>& terms, const std::vector<std::string>& check,
+              const std::vector<uint32_t>& pool, std::vector<uint32_t>* out) const;
+    // Grams of a record, except those in `skip` (sorted)
+    void addGrams(uint32_t r, std::string_view folded, const std::vector<uint32_t>* skip);
+    // Rewrites the arena in record order, without the bytes nobody uses
+    void compact();
+    // Renumbers records as entries and lists them afresh, once erased
+    // records are half of them
+    void rebuild();
+    // Superset of the records holding every term, ascending, and the terms
+    // it does not settle. It settles a term of up to three bytes by merging
+    // its list, except in loose records.
+    void candidates(const std::vector<std::string>& terms, std::vector<uint32_t>* out,
+                    std::vector<std::string>* check);
+    Posting* lookup(uint32_t key);
+    Posting& insert(uint32_t key);
+    void grow();
+    static void append(Posting& posting, uint32_t r);
+    static void decode(const Posting& posting, std::vector<uint32_t>* out);
+    static void encode(Posting& posting, const std::vector<uint32_t>& records);
+    // Puts an out-of-order list back in order, once
+    void tidy(Posting& posting);
+
+    // Records are numbered as entries arrive. Erasing entries renumbers
+    // them but not the records, so both stay in the same order.
+    std::string text;                 // folded records, fields split and records ended by '\n'
+    std::vector<uint32_t> starts;     // per record, into text
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> entryOf;    // record -> entry id, EMPTY once erased
+    std::vector<uint32_t> recordOf;   // entry id -> record
+    std::vector<uint8_t> loose;       // per record, 1 once it lost text its grams still list
+    size_t garbage = 0;               // bytes of text no record uses
+    size_t dead = 0;                  // erased records
+    bool ordered = true;              // starts ascend with the record
+    std::string scratch;
+    std::vector<uint32_t> seen;
+
+    std::vector<uint32_t> keys;       // open addressing, EMPTY or a gram
+    std::vector<uint32_t> slots;      // keys[i] -> postings[slots[i]]
+    std::vector<Posting> postings;
+};
+
+#endif
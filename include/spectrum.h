@@ -0,0 +1,64 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "fft.h"
+#include "ring.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+#define SPECTRUM_BANDS 32
+
+struct SpectrumFrame {
+    float level[SPECTRUM_BANDS];   // 0..1, falls off smoothly
+    float peak[SPECTRUM_BANDS];    // 0..1, held for a moment then falls
+};
+
+// Called on the worker thread after a frame was published. Must not block.
+typedef void (*FrameCallback)(void* user_data);
+
+// Spectrum analyzer fed from the player's audio tap. PCM comes in through a
+// lock-free ring, a worker thread runs the FFT and log-frequency binning, and
+// finished frames go out through a second ring that the draw callback polls.
+class Spectrum {
+public:
+    // `cb` is fixed before the worker starts, so it reads it without a lock
+    explicit Spectrum(FrameCallback cb = nullptr, void* data = nullptr);
+    ~Spectrum();
+
+    // Producer (streaming thread): mono samples. Never blocks, drops on overflow.
+    void push(const float* samples, size_t count, int rate);
+
+    // Consumer (GTK main thread): newest frame, false if none arrived since last call
+    bool latest(SpectrumFrame* out);
+
+private:
+    static const size_t FFT_SIZE = 1024;
+    static const int FRAME_RATE = 30;
+
+    void run();
+    void analyze();
+
+    SpscRing<float, 16384> pcm;
+    SpscRing<SpectrumFrame, 8> frames;
+    std::atomic<int> rate{44100};
+
+    // Worker state
+    FFT fft;
+    std::vector<float> history;
+    std::vector<float> mags;
+    SpectrumFrame state = {};
+    int hold[SPECTRUM_BANDS] = {};
+
+    const FrameCallback onFrame;
+    void* const frameData;
+
+    std::atomic<bool> running{true};
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
+
+#endif
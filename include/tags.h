@@ -0,0 +1,141 @@
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct TrackInfo {
+    std::string title;
+    std::string artist;
+    std::string album;
+    double duration = 0.0;   // seconds, 0 when unknown
+};
+
+// What a file looked like when its tags were read. (mtime, size) decides
+// whether a cached entry is still good; hash covers the first 4 KiB.
+struct FileStamp {
+    int64_t mtime = 0;      // ns
+    uint64_t size = 0;
+    uint64_t hash = 0;
+
+    bool sameFile(const FileStamp& other) const { return mtime == other.mtime && size == other.size; }
+};
+
+// Views into the mapped header regions, or into the reader's own storage
+// for text that had to be re-encoded (Latin-1, UTF-16, unsynchronised ID3).
+// Valid until the next read() on the same reader.
+struct TagView {
+    std::string_view title;
+    std::string_view artist;
+    std::string_view album;
+    double duration = 0.0;
+    FileStamp stamp;
+
+    TrackInfo toInfo() const;
+};
+
+// Native metadata reader: ID3v1/v2 + MPEG Xing/VBRI/CBR duration, FLAC
+// STREAMINFO/VORBIS_COMMENT, Ogg Vorbis/Opus comments + last granule,
+// MP4 ilst + mvhd, WAV LIST/INFO + data size. Only the regions holding
+// headers are mapped, and only the pages actually parsed get read.
+class TagReader {
+public:
+    TagReader() = default;
+    ~TagReader();
+    TagReader(const TagReader&) = delete;
+    TagReader& operator=(const TagReader&) = delete;
+
+    // False when the file cannot be opened or its format is not recognised
+    bool read(const std::string& path, TagView* out);
+
+private:
+    struct Span {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    Span map(uint64_t offset, size_t length);
+    void ensure(Span& head, size_t end);
+    void release();
+    std::string_view keep(std::string text);
+    std::string_view latin1(const uint8_t* p, size_t n);
+    std::string_view text(const uint8_t* p, size_t n, int encoding);
+
+    size_t parseId3v2(Span& head, TagView* out);
+    void parseId3v1(TagView* out, bool* present);
+    void parseMpeg(Span& head, size_t offset, bool id3v1, TagView* out);
+    bool parseFlac(Span& head, size_t offset, TagView* out);
+    bool parseOgg(TagView* out);
+    bool parseMp4(TagView* out);
+    bool parseWav(Span& head, TagView* out);
+    void parseVorbisComments(const uint8_t* p, size_t n, TagView* out);
+
+    struct Mapping {
+        void* base;
+        size_t length;
+    };
+
+    int fd = -1;
+    uint64_t file_size = 0;
+    std::vector<Mapping> mappings;
+    std::deque<std::string> owned;   // deque: views stay put as it grows
+};
+
+struct TagJob {
+    size_t index;        // caller's key, e.g. the playlist index
+    std::string path;
+    FileStamp known;     // cached stamp; size 0 when there is none
+};
+
+struct TagResult {
+    size_t index;
+    std::string path;
+    TrackInfo info;
+    FileStamp stamp;
+    bool unchanged = false;   // matched `known`: not read, info is empty
+};
+
+// Called on a worker thread with finished results. Must not block for long.
+typedef void (*TagResultCallback)(void* user_data, std::vector<TagResult>& batch);
+
+// Reads tags for many files on a small pool of worker threads, each with
+// its own TagReader. Results come back in batches, in no particular order.
+class TagPool {
+public:
+    // 0 picks hardware concurrency, capped at MAX_THREADS
+    TagPool(TagResultCallback cb, void* data, unsigned threads = 0);
+    ~TagPool();
+
+    // Any thread
+    void submit(std::vector<TagJob>& jobs);
+    // Drops queued jobs; batches already being read still arrive
+    void cancel();
+    // Blocks until every submitted job was delivered or dropped
+    void wait();
+
+private:
+    static constexpr unsigned MAX_THREADS = 4;
+    static constexpr size_t BATCH = 64;
+
+    void run();
+
+    TagResultCallback onResults;
+    void* resultData;
+
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable idle;
+    std::deque<TagJob> queue;                           // guarded by mutex
+    unsigned active = 0;                                // guarded by mutex
+    bool stopping = false;                              // guarded by mutex
+    std::vector<std::thread> workers;
+};
+
+#endif
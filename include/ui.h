@@ -40,8 +40,20 @@ private:
     static gboolean onSeekPress(GtkWidget* widget, GdkEvent* event, gpointer data);
     static gboolean onSeekRelease(GtkWidget* widget, GdkEvent* event, gpointer data);
     static void onSeekChanged(GtkRange* range, gpointer data);
+    static gboolean onPlaylistSeekPress(GtkWidget* widget, GdkEvent* event, gpointer data);
+    static gboolean onPlaylistSeekRelease(GtkWidget* widget, GdkEvent* event, gpointer data);
+    static void onPlaylistSeekChanged(GtkRange* range, gpointer data);
     
     static gboolean onUpdateTick(gpointer data);
+    static void onPlayerEvent(void* data);
+    static void onImportProgress(void* data);
+    static void onImportCancelClicked(GtkButton* btn, gpointer data);
+    static void onSearchChanged(GtkEditable* editable, gpointer data);
+    static gboolean onWindowState(GtkWidget* widget, GdkEventWindowState* event, gpointer data);
+    static gboolean onFirstDraw(GtkWidget* widget, cairo_t* cr, gpointer data);
+    void refreshStatus();
+    void scheduleTick();
+    void reportStats();
     static gboolean onKeyPress(GtkWidget* widget, GdkEventKey* event, gpointer data);
 
     // --- Members ---
@@ -53,18 +65,44 @@ private:
     // Widgets
     GtkWidget* window;
     GtkWidget* drawingArea; 
-    GtkWidget* playlistBox; 
+    GtkWidget* playlistView; 
     GtkWidget* lblInfo;
     GtkWidget* seekScale;
+    GtkWidget* playlistBox;     // whole-playlist seek bar and time
+    GtkWidget* playlistScale;
+    GtkWidget* lblPlaylistTime;
     GtkWidget* volScale;
     GtkWidget* btnShuffle;
     GtkWidget* btnRepeat;
     GtkWidget* btnMiniMode;
+    GtkWidget* importBar;       // shown while an import runs
+    GtkWidget* importProgress;
+    GtkWidget* searchEntry;     // filters the playlist as you type
     
     GtkWidget* visualizerContainerBox;
 
+    std::vector<std::string> startupPaths;
+    // Transport buttons and seek bars, insensitive until the engine is ready
+    std::vector<GtkWidget*> engineControls;
+
     bool isSeeking = false;
+    bool isPlaylistSeeking = false;
     bool is_mini_mode = false;
+    bool minimized = false;
+
+    // Event-driven status: pending tick and what the widgets currently show
+    guint tickSource = 0;
+    std::string shownInfo;
+    double shownDuration = -1;
+    int shownPosition = -1;
+    double shownPlaylistTotal = -1;
+    int shownPlaylistElapsed = -1;
+
+    // TERMAMP_STATS: wakeups/CPU per playing or idle period
+    bool statsPlaying = false;
+    gint64 statsSince = 0;
+    double statsCpu = 0;
+    unsigned long long statsWakeups = 0;
 };
 
 #endif
@@ -17,6 +17,21 @@ public:
     
     // Helper to get an image widget for the About dialog
     static GtkWidget* createLogoImage(int size);
+
+    // True when TERMAMP_STATS is set: enables the runtime measurement logs
+    static bool statsEnabled();
+
+    // Main-loop wakeups the UI schedules itself (timers, redraw idles)
+    static void countWakeup();
+    static unsigned long long wakeups();
+
+    // CPU time (user + system) used by the process so far, in seconds
+    static double cpuSeconds();
+
+    // Startup timeline (TERMAMP_STATS): logs the milestone with the time
+    // since the process started and since the previous milestone. Main
+    // thread.
+    static void startupMark(const char* milestone, const std::string& detail = "");
 };
 
 #endif
@@ -2,6 +2,7 @@
 #define VISUALIZER_H
 
 #include "common.h"
+#include "spectrum.h"
 
 class Visualizer {
 public:
@@ -13,8 +14,24 @@ public:
     // Timer for updates
     static gboolean onTick(gpointer widget);
 
+    // Player audio tap (streaming thread)
+    static void onPcm(void* data, const float* samples, size_t count, int rate);
+
+    // Widget redrawn whenever the analyzer publishes a frame
+    void setWidget(GtkWidget* widget);
+    // Minimized: skip analysis and redraws entirely
+    void setActive(bool active);
+
 private:
+    static void onFrame(void* data);           // worker thread
+    static gboolean onFrameIdle(gpointer data); // main thread
+
     AppState* app;
+    Spectrum spectrum;
+    SpectrumFrame frame = {};
+    GtkWidget* widget = nullptr;
+    std::atomic<bool> active{true};
+    std::atomic<bool> redraw_pending{false};
 };
 
 #endif
@@ -0,0 +1,111 @@
+#include "decoder_cache.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+DecoderCache::DecoderCache(const std::string& file) : path(file) {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        // signature \t caps \t chain
+        size_t a = line.find('\t');
+        size_t b = a == std::string::npos ? a : line.find('\t', a + 1);
+        if (b == std::string::npos || b + 1 >= line.size()) continue;
+        Entry& entry = entries[line.substr(0, a)];
+        entry.caps = line.substr(a + 1, b - a - 1);
+        entry.chain = line.substr(b + 1);
+    }
+}
+
+std::string DecoderCache::signature(const std::string& file) {
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "";
+    unsigned char head[HEAD_BYTES];
+    ssize_t got = read(fd, head, sizeof(head));
+    close(fd);
+    if (got <= 0) return "";
+
+    std::string sig;
+    size_t slash = file.rfind('/');
+    size_t dot = file.rfind('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        // Kept to letters and digits: the signature is a field of a tab-separated line
+        for (size_t i = dot + 1; i < file.size(); i++) {
+            unsigned char c = file[i];
+            if (std::isalnum(c)) sig += (char)std::tolower(c);
+        }
+    }
+    size_t size = (size_t)got;
+    auto is = [&](size_t at, const char* tag) { return at + 4 <= size && memcmp(head + at, tag, 4) == 0; };
+    auto hex = [&](size_t at, size_t n) {
+        static const char HEX[] = "0123456789abcdef";
+        sig += ' ';
+        for (size_t i = at; i < at + n && i < size; i++) {
+            sig += HEX[head[i] >> 4];
+            sig += HEX[head[i] & 15];
+        }
+    };
+    if (is(4, "ftyp")) {
+        // MP4: box type and major brand ("M4A ", "mp42", "isom")
+        hex(4, 8);
+        return sig;
+    }
+    hex(0, MAGIC_BYTES);
+    if (is(0, "OggS") && size > 26) {
+        // The first packet, after the page header and its segment table:
+        // "\x01vorbis", "OpusHead", "\x7fFLAC", "Speex   "
+        hex(27 + head[26], 8);
+    } else if (is(0, "RIFF") && is(8, "WAVE") && is(12, "fmt ")) {
+        // PCM, float, A-law, MP3...
+        hex(20, 2);
+    }
+    return sig;
+}
+
+bool DecoderCache::lookup(const std::string& signature, std::string* chain) {
+    auto it = entries.find(signature);
+    if (it == entries.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    *chain = it->second.chain;
+    return true;
+}
+
+void DecoderCache::put(const std::string& signature, const std::string& caps, const std::string& chain) {
+    if (signature.empty() || chain.empty()) return;
+    Entry& entry = entries[signature];
+    if (entry.chain == chain && entry.caps == caps) return;
+    entry.caps = caps;
+    entry.chain = chain;
+    save();
+}
+
+void DecoderCache::forget(const std::string& signature) {
+    if (entries.erase(signature) == 0) return;
+    failures++;
+    save();
+}
+
+void DecoderCache::save() {
+    // A few dozen lines at most: rewrite beside, then rename over
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "w");
+    if (!f) {
+        std::cerr << "[DECODERS] Cannot write " << tmp << std::endl;
+        return;
+    }
+    for (const auto& kv : entries) {
+        std::fprintf(f, "%s\t%s\t%s\n", kv.first.c_str(), kv.second.caps.c_str(), kv.second.chain.c_str());
+    }
+    bool ok = std::fclose(f) == 0;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "[DECODERS] Cannot write " << path << std::endl;
+        std::remove(tmp.c_str());
+    }
+}
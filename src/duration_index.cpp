@@ -0,0 +1,73 @@
+#include "duration_index.h"
+
+// Nodes are 0-based here; the usual 1-based k is i + 1 and lowbit(k) its
+// lowest set bit
+
+void DurationIndex::build(const std::vector<int64_t>& durations) {
+    tree = durations;
+    sum = 0;
+    size_t n = tree.size();
+    for (size_t i = 0; i < n; i++) {
+        sum += durations[i];
+        size_t parent = i | (i + 1);
+        if (parent < n) tree[parent] += tree[i];
+    }
+}
+
+void DurationIndex::append(int64_t duration) {
+    // The new node covers itself and the nodes its range spans to the left
+    size_t k = tree.size() + 1;
+    size_t low = k & (~k + 1);
+    tree.push_back(duration + prefix(k - 1) - prefix(k - low));
+    sum += duration;
+}
+
+void DurationIndex::set(size_t position, int64_t duration) {
+    if (position >= tree.size()) return;
+    int64_t delta = duration - get(position);
+    if (delta == 0) return;
+    sum += delta;
+    for (size_t i = position; i < tree.size(); i |= i + 1) tree[i] += delta;
+}
+
+int64_t DurationIndex::prefix(size_t count) const {
+    if (count > tree.size()) count = tree.size();
+    int64_t total = 0;
+    for (size_t k = count; k > 0; k &= k - 1) total += tree[k - 1];
+    return total;
+}
+
+int64_t DurationIndex::get(size_t position) const {
+    return prefix(position + 1) - prefix(position);
+}
+
+// Binary lifting: take the largest steps that stay at or below t
+size_t DurationIndex::find(int64_t t, int64_t* offset) const {
+    size_t n = tree.size();
+    if (n == 0) {
+        *offset = 0;
+        return 0;
+    }
+    size_t step = 1;
+    while (step * 2 <= n) step *= 2;
+    size_t count = 0;
+    int64_t rest = t < 0 ? 0 : t;
+    for (; step; step /= 2) {
+        if (count + step <= n && tree[count + step - 1] <= rest) {
+            count += step;
+            rest -= tree[count - 1];
+        }
+    }
+    if (count >= n) {
+        // At or past the end: the last track, at its end
+        *offset = get(n - 1);
+        return n - 1;
+    }
+    *offset = rest;
+    return count;
+}
+
+void DurationIndex::clear() {
+    std::vector<int64_t>().swap(tree);
+    sum = 0;
+}
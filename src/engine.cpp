@@ -0,0 +1,775 @@
+#include "engine.h"
+#include "library.h"
+#include "utils.h"
+#include <iostream>
+#include <cstring>
+
+Engine::Engine(EngineEventCallback cb, void* data, PipelineBackend kind)
+    : onEvent(cb), eventData(data), backend(kind) {
+    gst_segment_init(&tap_segment, GST_FORMAT_TIME);
+    context = g_main_context_new();
+    loop = g_main_loop_new(context, FALSE);
+    thread = std::thread(&Engine::run, this);
+}
+
+Engine::~Engine() {
+    EngineCommand quit;
+    quit.type = CMD_QUIT;
+    post(quit);
+    if (thread.joinable()) thread.join();
+
+    g_main_loop_unref(loop);
+    g_main_context_unref(context);
+    if (Utils::statsEnabled()) reportLatency();
+}
+
+void Engine::run() {
+    // Bus watches attach to the thread-default context, so every bus
+    // message is handled here rather than on the GTK main loop
+    g_main_context_push_thread_default(context);
+
+    // The plugin registry is loaded (and on a first run, scanned) here,
+    // while the window paints; commands wait in the queue meanwhile
+    gint64 initStart = g_get_monotonic_time();
+    gst_init(NULL, NULL);
+    double initMs = (g_get_monotonic_time() - initStart) / 1000.0;
+    // playbin cannot be handed a chain
+    if (backend == BACKEND_LEAN) decoders = new DecoderCache(Library::defaultDir() + "/decoders");
+
+    GstElement* activeTap = nullptr;
+    pipeline = createPipeline("player", &activeTap);
+    tap = activeTap;
+    if (!pipeline) {
+        std::cerr << "CRITICAL: Failed to create GStreamer " << Pipeline::backendName(backend)
+                  << " pipeline." << std::endl;
+    } else if (Utils::statsEnabled()) {
+        std::cerr << "[ENGINE] Pipeline: " << Pipeline::backendName(backend) << std::endl;
+    }
+    EngineEvent ready;
+    ready.type = EV_READY;
+    ready.value = initMs;
+    emit(ready);
+
+    g_main_loop_run(loop);
+
+    clearStandby();
+    destroyPipeline(standby);
+    destroyPipeline(pipeline);
+    standby = pipeline = nullptr;
+    if (decoders && Utils::statsEnabled()) {
+        std::cerr << "[DECODERS] " << decoders->size() << " chains cached, " << decoders->hits << " hits, "
+                  << decoders->misses << " misses, " << decoders->failures << " failed" << std::endl;
+    }
+    delete decoders;
+    decoders = nullptr;
+    g_main_context_pop_thread_default(context);
+}
+
+void Engine::post(EngineCommand cmd) {
+    cmd.posted = g_get_monotonic_time();
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        wake = queue.empty();
+        queue.push_back(std::move(cmd));
+    }
+    if (!wake) return;
+
+    // Not g_main_context_invoke(): it would run the command right here if
+    // the engine loop does not own its context yet
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source, dispatch, this, NULL);
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+gboolean Engine::dispatch(gpointer data) {
+    Engine* engine = (Engine*)data;
+    for (;;) {
+        EngineCommand cmd;
+        {
+            std::lock_guard<std::mutex> lock(engine->queue_mutex);
+            if (engine->queue.empty()) break;
+            cmd = std::move(engine->queue.front());
+            engine->queue.pop_front();
+        }
+        engine->recordLatency(g_get_monotonic_time() - cmd.posted);
+        engine->execute(cmd);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+void Engine::execute(const EngineCommand& cmd) {
+    if (cmd.type == CMD_QUIT) {
+        g_main_loop_quit(loop);
+        return;
+    }
+    if (!pipeline) {
+        // The player holds further seeks until this one is answered
+        if (cmd.type == CMD_SEEK) {
+            EngineEvent done;
+            done.type = EV_SEEK_DONE;
+            emit(done);
+        }
+        return;
+    }
+
+    switch (cmd.type) {
+        case CMD_LOAD:
+            generation = cmd.generation;
+            load(cmd.path, cmd.posted, cmd.value);
+            break;
+        case CMD_PLAY:
+            // CRITICAL: Record time.
+            last_play_time = g_get_monotonic_time();
+            gst_element_set_state(pipeline, GST_STATE_PLAYING);
+            break;
+        case CMD_PAUSE:
+            gst_element_set_state(pipeline, GST_STATE_PAUSED);
+            postPosition();
+            break;
+        case CMD_STOP:
+            generation = cmd.generation;
+            stop();
+            break;
+        case CMD_SEEK: {
+            GstSeekFlags flags = (GstSeekFlags)(GST_SEEK_FLAG_FLUSH |
+                (cmd.accurate ? GST_SEEK_FLAG_ACCURATE : GST_SEEK_FLAG_KEY_UNIT));
+            seeking = gst_element_seek_simple(pipeline, GST_FORMAT_TIME, flags,
+                                              (gint64)(cmd.value * GST_SECOND));
+            if (!seeking) {
+                // No ASYNC_DONE will follow; let the scheduler move on
+                EngineEvent done;
+                done.type = EV_SEEK_DONE;
+                emit(done);
+            }
+            break;
+        }
+        case CMD_VOLUME:
+            volume = cmd.value;
+            Pipeline::setVolume(pipeline, volume);
+            if (standby) Pipeline::setVolume(standby, volume);
+            break;
+        case CMD_PREPARE:
+            prepare(cmd.path);
+            break;
+        default:
+            break;
+    }
+}
+
+void Engine::recordLatency(gint64 us) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (1LL << bucket) < us) bucket++;
+    latency[bucket]++;
+    latency_count++;
+}
+
+void Engine::reportLatency() {
+    if (latency_count == 0) return;
+    std::cerr << "[ENGINE] UI-to-dispatch latency over " << latency_count << " commands:" << std::endl;
+
+    unsigned seen = 0;
+    long long p50 = -1, p99 = -1;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (latency[b] == 0) continue;
+        seen += latency[b];
+        if (p50 < 0 && seen * 2 >= latency_count) p50 = 1LL << b;
+        if (p99 < 0 && seen * 100 >= latency_count * 99) p99 = 1LL << b;
+        std::cerr << "[ENGINE]   <= " << (1LL << b) << " us: " << latency[b] << std::endl;
+    }
+    std::cerr << "[ENGINE]   p50 <= " << p50 << " us, p99 <= " << p99 << " us" << std::endl;
+}
+
+GstElement* Engine::createPipeline(const char* name, GstElement** tapOut) {
+    GstElement* bin = Pipeline::create(backend, name, "autoaudiosink", tapOut);
+    if (!bin) return nullptr;
+
+    GstBus* bus = gst_element_get_bus(bin);
+    gst_bus_add_watch(bus, busCallback, this);
+    gst_object_unref(bus);
+
+    // Gapless: playbin asks for the next URI shortly before the current one drains
+    if (Pipeline::isPlaybin(bin)) g_signal_connect(bin, "about-to-finish", G_CALLBACK(onAboutToFinish), this);
+
+    // The tap feeds the visualizer and, with stats enabled, measures track
+    // boundaries
+    if (*tapOut) {
+        GstPad* pad = gst_element_get_static_pad(*tapOut, "src");
+        GstPadProbeType mask = (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM);
+        gst_pad_add_probe(pad, mask, pcmProbe, this, NULL);
+        if (Utils::statsEnabled()) {
+            gst_pad_add_probe(pad, mask, gapProbe, this, NULL);
+            gst_pad_add_probe(pad, mask, seekProbe, this, NULL);
+        }
+        gst_object_unref(pad);
+    }
+    Pipeline::setVolume(bin, volume);
+    return bin;
+}
+
+void Engine::destroyPipeline(GstElement* bin) {
+    if (!bin) return;
+    gst_element_set_state(bin, GST_STATE_NULL);
+    GstBus* bus = gst_element_get_bus(bin);
+    gst_bus_remove_watch(bus);
+    gst_object_unref(bus);
+    gst_object_unref(bin);
+}
+
+void Engine::setPcmCallback(PcmCallback cb, void* data) {
+    onPcm = cb;
+    pcmData = data;
+}
+
+std::string Engine::toUri(const std::string& path) {
+    std::string result;
+    GError *error = NULL;
+    gchar *uri = gst_filename_to_uri(path.c_str(), &error);
+
+    if (error) {
+        if (path.find("file://") == 0 || path.find("http://") == 0) {
+             result = path;
+        }
+        g_error_free(error);
+    } else {
+        result = uri;
+        g_free(uri);
+    }
+    return result;
+}
+
+void Engine::setNext(const std::string& path) {
+    std::string uri = path.empty() ? "" : toUri(path);
+    std::lock_guard<std::mutex> lock(next_mutex);
+    next_path = path;
+    next_uri = uri;
+}
+
+bool Engine::isQueued() {
+    std::lock_guard<std::mutex> lock(next_mutex);
+    return !queued_path.empty();
+}
+
+// --- STANDBY ---
+// Keeps a second pipeline prerolled in PAUSED on the track a manual skip
+// would go to, so loading that track is a pointer swap.
+void Engine::prepare(const std::string& path) {
+    if (path == standby_path) return;
+
+    if (path.empty()) {
+        if (standby) gst_element_set_state(standby, GST_STATE_NULL);
+        clearStandby();
+        standby_path.clear();
+        return;
+    }
+
+    if (!standby) {
+        standby = createPipeline("standby", &standby_tap);
+        if (!standby) return;
+    }
+
+    std::string uri = toUri(path);
+    if (uri.empty()) return;
+
+    gst_element_set_state(standby, GST_STATE_READY);
+    clearStandby();
+    // Not learned from: the standby bus only reports errors and tags
+    std::string signature;
+    setSource(standby, path, &signature);
+    Pipeline::setVolume(standby, volume);
+    gst_element_set_state(standby, GST_STATE_PAUSED);
+    standby_path = path;
+}
+
+// Drops the tags of the track the standby held, with whatever its bus
+// still has queued
+void Engine::clearStandby() {
+    if (standby) {
+        GstBus* bus = gst_element_get_bus(standby);
+        while (GstMessage* msg = gst_bus_pop(bus)) gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+    if (standby_tags) gst_tag_list_unref(standby_tags);
+    standby_tags = nullptr;
+}
+
+bool Engine::isActiveBus(GstBus* bus) {
+    if (!pipeline) return false;
+    GstBus* active = gst_element_get_bus(pipeline);
+    bool result = (bus == active);
+    gst_object_unref(active);
+    return result;
+}
+
+void Engine::load(const std::string& path, gint64 posted, double start) {
+    GstState state = GST_STATE_NULL;
+    gst_element_get_state(pipeline, &state, NULL, 0);
+    // Only down to READY: the new URI is taken there, and the sink stays open
+    stop(GST_STATE_READY);
+    load_time = posted;
+    start_at = start;
+
+    if (standby && !standby_path.empty() && path == standby_path) {
+        // Already prerolled: swap pipelines, the old one becomes the next standby
+        std::swap(pipeline, standby);
+        standby_tap = tap.exchange(standby_tap);
+        adoptTap();
+        GstTagList* tags = standby_tags;
+        standby_tags = nullptr;
+        clearStandby();
+        standby_path.clear();
+        load_from = "standby";
+        load_signature.clear();
+        load_direct = false;
+        // Its STREAM_START, tags and duration went by while it was on standby
+        EngineEvent started;
+        started.type = EV_STREAM_START;
+        emit(started);
+        if (tags) {
+            handleTags(tags);
+            gst_tag_list_unref(tags);
+        }
+        postDuration();
+        // Already PAUSED, so it can seek now
+        if (start_at > 0) {
+            gst_element_seek_simple(pipeline, GST_FORMAT_TIME,
+                                    (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+                                    (gint64)(start_at * GST_SECOND));
+            start_at = 0;
+        }
+        return;
+    }
+
+    load_from = state == GST_STATE_NULL ? "cold" : "ready";
+    load_path = path;
+    load_direct = setSource(pipeline, path, &load_signature);
+}
+
+// --- DECODER CACHE ---
+// The cached chain for the file's signature if there is one, else the URI
+// for autoplugging. True when the chain was used.
+bool Engine::setSource(GstElement* bin, const std::string& path, std::string* signature) {
+    signature->clear();
+    if (decoders) {
+        *signature = DecoderCache::signature(path);
+        std::string chain;
+        if (!signature->empty() && decoders->lookup(*signature, &chain) &&
+            Pipeline::setChain(bin, path.c_str(), chain)) {
+            return true;
+        }
+    }
+    std::string uri = toUri(path);
+    if (!uri.empty()) Pipeline::setUri(bin, uri.c_str());
+    return false;
+}
+
+// A cached chain failed before the first preroll (another codec behind the
+// same signature, a plugin gone): forget it and autoplug the same load
+bool Engine::retryAutoplug() {
+    if (!load_direct || load_signature.empty()) return false;
+    std::cerr << "[DECODERS] Cached chain failed for " << load_path << ", autoplugging" << std::endl;
+    decoders->forget(load_signature);
+    load_direct = false;
+
+    GstState target = GST_STATE_TARGET(pipeline);
+    gst_element_set_state(pipeline, GST_STATE_READY);
+    std::string uri = toUri(load_path);
+    Pipeline::setUri(pipeline, uri.c_str());
+    gst_element_set_state(pipeline, target == GST_STATE_PLAYING ? GST_STATE_PLAYING : GST_STATE_PAUSED);
+    return true;
+}
+
+void Engine::stop(GstState state) {
+    gst_element_set_state(pipeline, state);
+    seeking = false;
+    start_at = 0;
+
+    // Tearing down drops whatever about-to-finish had queued
+    std::lock_guard<std::mutex> lock(next_mutex);
+    queued_path.clear();
+    tap_last_end = GST_CLOCK_TIME_NONE;
+    tap_boundary = false;
+}
+
+// --- EVENTS ---
+// Marshalled to the GTK main loop; the engine never touches AppState.
+struct PostedEvent {
+    Engine* engine;
+    EngineEvent event;
+};
+
+void Engine::emit(EngineEvent event) {
+    event.generation = generation;
+    g_idle_add(deliver, new PostedEvent{this, std::move(event)});
+}
+
+gboolean Engine::deliver(gpointer data) {
+    PostedEvent* posted = (PostedEvent*)data;
+    Engine* engine = posted->engine;
+    if (engine->onEvent) engine->onEvent(engine->eventData, posted->event);
+    if (posted->event.clock) gst_object_unref(posted->event.clock);
+    delete posted;
+    return G_SOURCE_REMOVE;
+}
+
+void Engine::postDuration() {
+    EngineEvent event;
+    event.type = EV_DURATION;
+    gint64 dur = 0;
+    if (gst_element_query_duration(pipeline, GST_FORMAT_TIME, &dur) && dur > 0) {
+        event.value = (double)dur / GST_SECOND;
+    }
+    emit(event);
+}
+
+void Engine::postPosition() {
+    // The UI interpolates from this anchor with the pipeline clock until
+    // the next seek, pause or track change
+    EngineEvent event;
+    event.type = EV_POSITION;
+    gint64 pos = 0;
+    if (gst_element_query_position(pipeline, GST_FORMAT_TIME, &pos)) event.position = pos;
+
+    GstState state = GST_STATE_NULL;
+    gst_element_get_state(pipeline, &state, NULL, 0);
+    GstClock* clock = (state == GST_STATE_PLAYING) ? gst_element_get_clock(pipeline) : NULL;
+    if (clock) {
+        GstClockTime now = gst_clock_get_time(clock);
+        GstClockTime base = gst_element_get_base_time(pipeline);
+        if (now >= base) {
+            event.running = now - base;
+            event.base_time = base;
+            event.clock = clock;
+        } else {
+            gst_object_unref(clock);
+        }
+    }
+    emit(event);
+}
+
+void Engine::handleTags(GstTagList* tags) {
+    gchar *artist = NULL;
+    gchar *title = NULL;
+    gst_tag_list_get_string(tags, GST_TAG_ARTIST, &artist);
+    gst_tag_list_get_string(tags, GST_TAG_TITLE, &title);
+
+    if (title) {
+        EngineEvent event;
+        event.type = EV_TAGS;
+        if (artist) event.text = std::string(artist) + " - " + std::string(title);
+        else event.text = std::string(title);
+        emit(event);
+        g_free(title);
+        if (artist) g_free(artist);
+    }
+}
+
+void Engine::onAboutToFinish(GstElement* playbin, gpointer data) {
+    // Streaming thread: only touch what next_mutex guards
+    Engine* engine = (Engine*)data;
+    std::lock_guard<std::mutex> lock(engine->next_mutex);
+    if (engine->next_uri.empty()) return;
+
+    g_object_set(G_OBJECT(playbin), "uri", engine->next_uri.c_str(), NULL);
+    engine->queued_path = engine->next_path;
+    engine->next_uri.clear();
+    engine->next_path.clear();
+}
+
+bool Engine::isActiveTap(GstPad* pad) {
+    // The standby pipeline prerolls through its own tap
+    GstElement* owner = gst_pad_get_parent_element(pad);
+    bool active = (owner == tap.load());
+    if (owner) gst_object_unref(owner);
+    return active;
+}
+
+void Engine::adoptTap() {
+    // The new pipeline's streaming thread waits in preroll and the old one
+    // is in READY: no probe runs while these are written
+    GstElement* active = tap.load();
+    if (!active) return;
+    GstPad* pad = gst_element_get_static_pad(active, "src");
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (caps) {
+        const GstStructure* st = gst_caps_get_structure(caps, 0);
+        const gchar* format = gst_structure_get_string(st, "format");
+        pcm_format = format ? format : "";
+        gst_structure_get_int(st, "channels", &pcm_channels);
+        gst_structure_get_int(st, "rate", &pcm_rate);
+        tap_rate = pcm_rate;
+        gst_caps_unref(caps);
+    }
+    GstEvent* event = gst_pad_get_sticky_event(pad, GST_EVENT_SEGMENT, 0);
+    if (event) {
+        const GstSegment* segment = NULL;
+        gst_event_parse_segment(event, &segment);
+        gst_segment_copy_into(segment, &tap_segment);
+        gst_event_unref(event);
+    }
+    gst_object_unref(pad);
+}
+
+GstPadProbeReturn Engine::pcmProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    // Streaming thread: downmix whatever raw format playbin negotiated to mono float
+    Engine* engine = (Engine*)data;
+    if (!engine->onPcm || !engine->isActiveTap(pad)) return GST_PAD_PROBE_OK;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+            GstCaps* caps = NULL;
+            gst_event_parse_caps(event, &caps);
+            const GstStructure* st = gst_caps_get_structure(caps, 0);
+            const gchar* format = gst_structure_get_string(st, "format");
+            engine->pcm_format = format ? format : "";
+            gst_structure_get_int(st, "channels", &engine->pcm_channels);
+            gst_structure_get_int(st, "rate", &engine->pcm_rate);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    const std::string& fmt = engine->pcm_format;
+    int channels = engine->pcm_channels;
+    if (channels <= 0 || engine->pcm_rate <= 0) return GST_PAD_PROBE_OK;
+
+    size_t width;
+    if (fmt == "S16LE") width = 2;
+    else if (fmt == "S32LE" || fmt == "F32LE") width = 4;
+    else if (fmt == "F64LE") width = 8;
+    else return GST_PAD_PROBE_OK;
+
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) return GST_PAD_PROBE_OK;
+
+    size_t frames = map.size / (width * channels);
+    std::vector<float>& out = engine->pcm_scratch;
+    out.resize(frames);
+    const float scale = 1.0f / channels;
+
+    for (size_t i = 0; i < frames; i++) {
+        const guint8* frame = map.data + i * width * channels;
+        float sum = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            const guint8* p = frame + c * width;
+            if (width == 2) {
+                gint16 v; std::memcpy(&v, p, 2); sum += v / 32768.0f;
+            } else if (fmt[0] == 'S') {
+                gint32 v; std::memcpy(&v, p, 4); sum += v / 2147483648.0f;
+            } else if (width == 4) {
+                float v; std::memcpy(&v, p, 4); sum += v;
+            } else {
+                double v; std::memcpy(&v, p, 8); sum += (float)v;
+            }
+        }
+        out[i] = sum * scale;
+    }
+    gst_buffer_unmap(buffer, &map);
+
+    engine->onPcm(engine->pcmData, out.data(), frames, engine->pcm_rate);
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn Engine::gapProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    // Streaming thread. Compares the running time where the previous buffer
+    // ended with where the first buffer of the next stream starts.
+    Engine* engine = (Engine*)data;
+    if (!engine->isActiveTap(pad)) return GST_PAD_PROBE_OK;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+        switch (GST_EVENT_TYPE(event)) {
+            case GST_EVENT_STREAM_START:
+                engine->tap_boundary = engine->tap_last_end != GST_CLOCK_TIME_NONE;
+                break;
+            case GST_EVENT_SEGMENT: {
+                const GstSegment* segment = NULL;
+                gst_event_parse_segment(event, &segment);
+                gst_segment_copy_into(segment, &engine->tap_segment);
+                break;
+            }
+            case GST_EVENT_CAPS: {
+                GstCaps* caps = NULL;
+                gst_event_parse_caps(event, &caps);
+                gst_structure_get_int(gst_caps_get_structure(caps, 0), "rate", &engine->tap_rate);
+                break;
+            }
+            case GST_EVENT_FLUSH_STOP:
+                // Seeks are not track boundaries
+                engine->tap_last_end = GST_CLOCK_TIME_NONE;
+                engine->tap_boundary = false;
+                break;
+            default:
+                break;
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstClockTime pts = GST_BUFFER_PTS(buffer);
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) return GST_PAD_PROBE_OK;
+
+    GstClockTime start = gst_segment_to_running_time(&engine->tap_segment, GST_FORMAT_TIME, pts);
+    if (engine->tap_boundary && engine->tap_rate > 0 && GST_CLOCK_TIME_IS_VALID(start)) {
+        gint64 gap_ns = (gint64)start - (gint64)engine->tap_last_end;
+        gint64 samples = gap_ns * engine->tap_rate / (gint64)GST_SECOND;
+        std::cerr << "[GAPLESS] Boundary gap: " << samples << " samples ("
+                  << gap_ns / 1000 << " us @ " << engine->tap_rate << " Hz)" << std::endl;
+    }
+    engine->tap_boundary = false;
+
+    GstClockTime dur = GST_BUFFER_DURATION(buffer);
+    if (GST_CLOCK_TIME_IS_VALID(start) && GST_CLOCK_TIME_IS_VALID(dur)) {
+        engine->tap_last_end = start + dur;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn Engine::seekProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    // Streaming thread. A flushing seek ends with FLUSH_STOP; the buffer
+    // after it is the first audio from the new position.
+    Engine* engine = (Engine*)data;
+    if (!engine->isActiveTap(pad)) return GST_PAD_PROBE_OK;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_FLUSH_STOP) {
+            engine->seek_flushed = true;
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (engine->seek_flushed) {
+        engine->seek_flushed = false;
+        EngineEvent event;
+        event.type = EV_SEEK_AUDIO;
+        engine->emit(event);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+gboolean Engine::busCallback(GstBus* bus, GstMessage* msg, gpointer data) {
+    // Engine thread
+    Engine* engine = (Engine*)data;
+
+    if (!engine->isActiveBus(bus)) {
+        // Standby pipeline: errors just drop the preroll, tags are kept
+        // for the swap
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            engine->prepare("");
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_TAG && !engine->standby_path.empty()) {
+            GstTagList* tags = NULL;
+            gst_message_parse_tag(msg, &tags);
+            GstTagList* merged = gst_tag_list_merge(engine->standby_tags, tags, GST_TAG_MERGE_REPLACE);
+            if (engine->standby_tags) gst_tag_list_unref(engine->standby_tags);
+            engine->standby_tags = merged;
+            gst_tag_list_unref(tags);
+        }
+        return TRUE;
+    }
+
+    switch (GST_MESSAGE_TYPE(msg)) {
+        case GST_MESSAGE_EOS: {
+            // CRITICAL FIX: Ignore EOS if happened < 2000ms (2 sec) after play/resume command.
+            // Termux/Android sometimes sends a flush EOS on resume.
+            guint64 now = g_get_monotonic_time();
+            if (now < engine->last_play_time + 2000000) {
+                std::cerr << "[PLAYER] Spurious EOS ignored (Timestamp Guard)" << std::endl;
+                break;
+            }
+
+            EngineEvent event;
+            event.type = EV_EOS;
+            engine->emit(event);
+            break;
+        }
+        case GST_MESSAGE_ERROR: {
+            // Queued by a chain retryAutoplug() has already taken out
+            if (engine->decoders && !gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg), GST_OBJECT(engine->pipeline))) {
+                break;
+            }
+            if (engine->retryAutoplug()) break;
+            engine->stop();
+            EngineEvent event;
+            event.type = EV_ERROR;
+            engine->emit(event);
+            break;
+        }
+        case GST_MESSAGE_STREAM_START: {
+            EngineEvent event;
+            event.type = EV_STREAM_START;
+            {
+                std::lock_guard<std::mutex> lock(engine->next_mutex);
+                event.text.swap(engine->queued_path);
+            }
+            engine->emit(event);
+            engine->postDuration();
+            engine->postPosition();
+            break;
+        }
+        case GST_MESSAGE_ASYNC_DONE:
+            // Preroll or seek finished
+            if (!engine->load_signature.empty()) {
+                // First preroll: remember what autoplugging built
+                std::string chain, caps;
+                if (!engine->load_direct && Pipeline::autoplugged(engine->pipeline, &chain, &caps)) {
+                    engine->decoders->put(engine->load_signature, caps, chain);
+                }
+                engine->load_signature.clear();
+            }
+            if (engine->start_at > 0) {
+                // First preroll of a track loaded at an offset: the seek's
+                // own ASYNC_DONE posts the position
+                double start = engine->start_at;
+                engine->start_at = 0;
+                if (gst_element_seek_simple(engine->pipeline, GST_FORMAT_TIME,
+                                            (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+                                            (gint64)(start * GST_SECOND))) {
+                    break;
+                }
+            }
+            engine->postDuration();
+            engine->postPosition();
+            if (engine->seeking) {
+                engine->seeking = false;
+                EngineEvent done;
+                done.type = EV_SEEK_DONE;
+                engine->emit(done);
+            }
+            break;
+        case GST_MESSAGE_DURATION_CHANGED:
+            // The demuxer refined its estimate
+            engine->postDuration();
+            break;
+        case GST_MESSAGE_STATE_CHANGED: {
+            if (GST_MESSAGE_SRC(msg) != GST_OBJECT(engine->pipeline)) break;
+            GstState oldState, newState, pending;
+            gst_message_parse_state_changed(msg, &oldState, &newState, &pending);
+            if (newState != GST_STATE_PLAYING) break;
+
+            // Base time is redistributed on every transition to PLAYING
+            engine->postPosition();
+            if (engine->load_time != 0) {
+                if (Utils::statsEnabled()) {
+                    gint64 ms = (g_get_monotonic_time() - engine->load_time) / 1000;
+                    std::cerr << "[PLAYER] Time to first audio: " << ms << " ms ("
+                              << engine->load_from << (engine->load_direct ? ", cached chain" : "") << ")"
+                              << std::endl;
+                }
+                engine->load_time = 0;
+            }
+            break;
+        }
+        case GST_MESSAGE_TAG: {
+            GstTagList *tags = NULL;
+            gst_message_parse_tag(msg, &tags);
+            engine->handleTags(tags);
+            gst_tag_list_unref(tags);
+            break;
+        }
+        default:
+            break;
+    }
+    return TRUE;
+}
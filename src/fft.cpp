@@ -0,0 +1,74 @@
+#include "fft.h"
+#include <cmath>
+#include <utility>
+
+FFT::FFT(size_t size) : n(size), bitrev(size), tw_re(size > 1 ? size - 1 : 1), tw_im(size > 1 ? size - 1 : 1),
+                        window(size), work_re(size), work_im(size) {
+    unsigned bits = 0;
+    while ((1u << bits) < n) bits++;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; b++) {
+            if (i & (1u << b)) r |= 1u << (bits - 1 - b);
+        }
+        bitrev[i] = r;
+    }
+
+    for (size_t h = 1; h < n; h *= 2) {
+        for (size_t j = 0; j < h; j++) {
+            double angle = -M_PI * (double)j / (double)h;
+            tw_re[h - 1 + j] = (float)std::cos(angle);
+            tw_im[h - 1 + j] = (float)std::sin(angle);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * M_PI * (double)i / (double)(n - 1)));
+    }
+}
+
+void FFT::forward(float* re, float* im) const {
+    for (size_t i = 0; i < n; i++) {
+        size_t j = bitrev[i];
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    for (size_t h = 1; h < n; h *= 2) {
+        const float* __restrict wr = &tw_re[h - 1];
+        const float* __restrict wi = &tw_im[h - 1];
+        for (size_t k = 0; k < n; k += 2 * h) {
+            float* __restrict ar = re + k;
+            float* __restrict ai = im + k;
+            float* __restrict br = re + k + h;
+            float* __restrict bi = im + k + h;
+            for (size_t j = 0; j < h; j++) {
+                float tr = br[j] * wr[j] - bi[j] * wi[j];
+                float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+void FFT::magnitudes(const float* samples, float* out) {
+    float* __restrict re = work_re.data();
+    float* __restrict im = work_im.data();
+    const float* __restrict w = window.data();
+    for (size_t i = 0; i < n; i++) {
+        re[i] = samples[i] * w[i];
+        im[i] = 0.0f;
+    }
+
+    forward(re, im);
+
+    for (size_t k = 0; k < n / 2; k++) {
+        out[k] = std::sqrt(re[k] * re[k] + im[k] * im[k]);
+    }
+}
@@ -0,0 +1,486 @@
+#include "library.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char INDEX_MAGIC[8] = {'T', 'M', 'L', 'I', 'B', 'I', 'X', '1'};
+static const uint32_t INDEX_VERSION = 1;
+static const uint32_t JOURNAL_MAGIC = 0x524a4d54;   // "TMJR"
+// Journal records folded in at open beyond this many; at exit beyond the
+// smaller count (a short journal replays faster than a rewrite)
+static const size_t COMPACT_AT_OPEN = 4096;
+static const size_t COMPACT_AT_EXIT = 1024;
+// A row without a directory (path had no '/')
+static const uint32_t NO_DIR = 0xffffffff;
+
+// Every column starts 8-byte aligned; strings are [u32 length][bytes],
+// and ref 0 is the empty string.
+struct Library::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t buckets;       // power of two, at least 2 * count
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t dir;           // u32 string refs
+    uint64_t name;
+    uint64_t title;
+    uint64_t artist;
+    uint64_t album;
+    uint64_t duration;      // f64
+    uint64_t mtime;         // i64
+    uint64_t size;          // u64
+    uint64_t hash;          // u64 content hash
+    uint64_t pathHash;      // u64
+    uint64_t table;         // u32 row + 1, 0 empty
+    uint64_t strings;
+    uint64_t stringsSize;
+};
+
+// Same switch as Utils::statsEnabled, which lives on the GTK side
+static bool statsEnabled() {
+    const char* env = getenv("TERMAMP_STATS");
+    return env && *env && std::string(env) != "0";
+}
+
+// FNV-1a
+static uint64_t hashPath(std::string_view path) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : path) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+template <typename T> static const T* column(const void* base, uint64_t offset) {
+    return (const T*)((const char*)base + offset);
+}
+
+TrackInfo LibraryEntry::toInfo() const {
+    TrackInfo info;
+    info.title.assign(title);
+    info.artist.assign(artist);
+    info.album.assign(album);
+    info.duration = duration;
+    return info;
+}
+
+// --- OPEN / CLOSE ---
+static void makeDirs(const std::string& dir) {
+    for (size_t i = 1; i <= dir.size(); i++) {
+        if (i == dir.size() || dir[i] == '/') mkdir(dir.substr(0, i).c_str(), 0755);
+    }
+}
+
+std::string Library::defaultDir() {
+    const char* cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache) return std::string(cache) + "/termamp";
+    const char* home = getenv("HOME");
+    return std::string(home ? home : ".") + "/.cache/termamp";
+}
+
+Library::Library(const std::string& dir) {
+    makeDirs(dir);
+    indexPath = dir + "/library.idx";
+    journalPath = dir + "/library.journal";
+
+    mapIndex();
+    replayJournal();
+    journalFd = open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journalFd < 0) std::cerr << "[LIBRARY] Cannot write " << journalPath << std::endl;
+
+    if (overlay.size() > COMPACT_AT_OPEN) compact();
+}
+
+Library::~Library() {
+    flush();
+    if (overlay.size() >= COMPACT_AT_EXIT) compact();
+    if (journalFd >= 0) close(journalFd);
+    unmapIndex();
+}
+
+// Maps and validates the index; on any mismatch it is ignored and rebuilt
+// by the next compaction
+bool Library::mapIndex() {
+    int fd = open(indexPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    const Header* h = (const Header*)base;
+    uint64_t n = h->count;
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % 8 == 0 && offset <= (uint64_t)st.st_size && bytes <= (uint64_t)st.st_size - offset;
+    };
+    bool valid = std::memcmp(h->magic, INDEX_MAGIC, 8) == 0 && h->version == INDEX_VERSION &&
+                 h->fileSize == (uint64_t)st.st_size && h->buckets >= n && h->buckets > 0 &&
+                 (h->buckets & (h->buckets - 1)) == 0 &&
+                 fits(h->dir, n * 4) && fits(h->name, n * 4) && fits(h->title, n * 4) &&
+                 fits(h->artist, n * 4) && fits(h->album, n * 4) && fits(h->duration, n * 8) &&
+                 fits(h->mtime, n * 8) && fits(h->size, n * 8) && fits(h->hash, n * 8) &&
+                 fits(h->pathHash, n * 8) && fits(h->table, (uint64_t)h->buckets * 4) &&
+                 fits(h->strings, h->stringsSize) && h->stringsSize >= 4;
+    if (!valid) {
+        std::cerr << "[LIBRARY] Ignoring invalid index " << indexPath << std::endl;
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    map = base;
+    mapSize = st.st_size;
+    header = h;
+    return true;
+}
+
+void Library::unmapIndex() {
+    if (map) munmap(map, mapSize);
+    map = nullptr;
+    mapSize = 0;
+    header = nullptr;
+}
+
+// --- JOURNAL ---
+// Record: u32 magic, u32 payload length, then
+//   i64 mtime, u64 size, u64 hash, f64 duration,
+//   4 x (u32 length + bytes): path, title, artist, album
+static void putBytes(std::string& out, const void* p, size_t n) {
+    out.append((const char*)p, n);
+}
+
+static void putString(std::string& out, const std::string& s) {
+    uint32_t n = s.size();
+    putBytes(out, &n, 4);
+    out += s;
+}
+
+void Library::put(const std::string& path, const FileStamp& stamp, const TrackInfo& info) {
+    std::string payload;
+    putBytes(payload, &stamp.mtime, 8);
+    putBytes(payload, &stamp.size, 8);
+    putBytes(payload, &stamp.hash, 8);
+    putBytes(payload, &info.duration, 8);
+    putString(payload, path);
+    putString(payload, info.title);
+    putString(payload, info.artist);
+    putString(payload, info.album);
+
+    uint32_t len = payload.size();
+    putBytes(pending, &JOURNAL_MAGIC, 4);
+    putBytes(pending, &len, 4);
+    pending += payload;
+
+    Record& record = overlay[path];
+    record.stamp = stamp;
+    record.info = info;
+}
+
+void Library::flush() {
+    if (pending.empty() || journalFd < 0) return;
+    // One append; a torn tail is dropped by the next replay
+    if (write(journalFd, pending.data(), pending.size()) != (ssize_t)pending.size()) {
+        std::cerr << "[LIBRARY] Journal write failed" << std::endl;
+    }
+    pending.clear();
+}
+
+void Library::replayJournal() {
+    int fd = open(journalPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat st;
+    std::string data;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data.resize(st.st_size);
+        if (pread(fd, &data[0], data.size(), 0) != (ssize_t)data.size()) data.clear();
+    }
+    close(fd);
+
+    const char* p = data.data();
+    size_t pos = 0;
+    while (pos + 8 <= data.size()) {
+        uint32_t magic, len;
+        std::memcpy(&magic, p + pos, 4);
+        std::memcpy(&len, p + pos + 4, 4);
+        if (magic != JOURNAL_MAGIC || len > data.size() - pos - 8 || len < 32 + 16) break;
+        const char* r = p + pos + 8;
+        const char* end = r + len;
+
+        Record record;
+        std::memcpy(&record.stamp.mtime, r, 8);
+        std::memcpy(&record.stamp.size, r + 8, 8);
+        std::memcpy(&record.stamp.hash, r + 16, 8);
+        std::memcpy(&record.info.duration, r + 24, 8);
+        r += 32;
+
+        std::string fields[4];
+        bool ok = true;
+        for (std::string& field : fields) {
+            uint32_t n;
+            if (end - r < 4) { ok = false; break; }
+            std::memcpy(&n, r, 4);
+            r += 4;
+            if ((size_t)(end - r) < n) { ok = false; break; }
+            field.assign(r, n);
+            r += n;
+        }
+        if (!ok) break;
+        pos += 8 + len;
+        record.info.title = std::move(fields[1]);
+        record.info.artist = std::move(fields[2]);
+        record.info.album = std::move(fields[3]);
+        overlay[std::move(fields[0])] = std::move(record);
+    }
+    // Drop a torn tail so appends start on a record boundary
+    if (pos < data.size()) {
+        if (truncate(journalPath.c_str(), pos) != 0) std::cerr << "[LIBRARY] Cannot trim journal" << std::endl;
+    }
+}
+
+// --- LOOKUP ---
+std::string_view Library::pooled(uint32_t ref) const {
+    const char* strings = column<char>(map, header->strings);
+    if ((uint64_t)ref + 4 > header->stringsSize) return std::string_view();
+    uint32_t n;
+    std::memcpy(&n, strings + ref, 4);
+    if (n > header->stringsSize - ref - 4) return std::string_view();
+    return std::string_view(strings + ref + 4, n);
+}
+
+bool Library::findMapped(const std::string& path, uint32_t* row) const {
+    if (!header || header->count == 0) return false;
+    uint64_t h = hashPath(path);
+    const uint32_t* table = column<uint32_t>(map, header->table);
+    const uint64_t* hashes = column<uint64_t>(map, header->pathHash);
+    const uint32_t* dirs = column<uint32_t>(map, header->dir);
+    const uint32_t* names = column<uint32_t>(map, header->name);
+    uint32_t mask = header->buckets - 1;
+
+    for (uint32_t i = h & mask, probes = 0; probes < header->buckets; i = (i + 1) & mask, probes++) {
+        uint32_t slot = table[i];
+        if (slot == 0) return false;
+        uint32_t r = slot - 1;
+        if (r >= header->count || hashes[r] != h) continue;
+
+        // Compare dir + '/' + name against path without building it
+        std::string_view name = pooled(names[r]);
+        if (dirs[r] == NO_DIR) {
+            if (name == path) {
+                *row = r;
+                return true;
+            }
+            continue;
+        }
+        std::string_view dir = pooled(dirs[r]);
+        if (path.size() == dir.size() + 1 + name.size() && path.compare(0, dir.size(), dir) == 0 &&
+            path[dir.size()] == '/' && path.compare(dir.size() + 1, name.size(), name) == 0) {
+            *row = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Library::lookup(const std::string& path, LibraryEntry* out) const {
+    auto it = overlay.find(path);
+    if (it != overlay.end()) {
+        const Record& record = it->second;
+        out->title = record.info.title;
+        out->artist = record.info.artist;
+        out->album = record.info.album;
+        out->duration = record.info.duration;
+        out->stamp = record.stamp;
+        return true;
+    }
+
+    uint32_t r;
+    if (!findMapped(path, &r)) return false;
+    out->title = pooled(column<uint32_t>(map, header->title)[r]);
+    out->artist = pooled(column<uint32_t>(map, header->artist)[r]);
+    out->album = pooled(column<uint32_t>(map, header->album)[r]);
+    out->duration = column<double>(map, header->duration)[r];
+    out->stamp.mtime = column<int64_t>(map, header->mtime)[r];
+    out->stamp.size = column<uint64_t>(map, header->size)[r];
+    out->stamp.hash = column<uint64_t>(map, header->hash)[r];
+    return true;
+}
+
+size_t Library::size() const {
+    size_t n = header ? header->count : 0;
+    for (const auto& it : overlay) {
+        uint32_t r;
+        if (!findMapped(it.first, &r)) n++;
+    }
+    return n;
+}
+
+// --- COMPACTION ---
+namespace {
+
+// Keys view the strings being compacted (mapped index, overlay), which
+// stay put until the new index is written
+struct Pool {
+    std::string bytes;
+    std::unordered_map<std::string_view, uint32_t> refs;
+
+    Pool() { intern(std::string_view()); }
+
+    uint32_t intern(std::string_view s) {
+        auto it = refs.emplace(s, (uint32_t)bytes.size());
+        if (!it.second) return it.first->second;
+        uint32_t n = s.size();
+        bytes.append((const char*)&n, 4);
+        bytes.append(s.data(), s.size());
+        return it.first->second;
+    }
+};
+
+struct Columns {
+    std::vector<uint32_t> dir, name, title, artist, album;
+    std::vector<double> duration;
+    std::vector<int64_t> mtime;
+    std::vector<uint64_t> size, hash, pathHash;
+};
+
+} // namespace
+
+bool Library::compact() {
+    auto start = std::chrono::steady_clock::now();
+    flush();
+
+    Pool pool;
+    Columns cols;
+    pool.refs.reserve(4 * (overlay.size() + (header ? header->count : 0)));
+    auto add = [&](uint32_t dir, uint32_t name, uint64_t pathHash, std::string_view title,
+                   std::string_view artist, std::string_view album, double duration, const FileStamp& stamp) {
+        cols.dir.push_back(dir);
+        cols.name.push_back(name);
+        cols.title.push_back(pool.intern(title));
+        cols.artist.push_back(pool.intern(artist));
+        cols.album.push_back(pool.intern(album));
+        cols.duration.push_back(duration);
+        cols.mtime.push_back(stamp.mtime);
+        cols.size.push_back(stamp.size);
+        cols.hash.push_back(stamp.hash);
+        cols.pathHash.push_back(pathHash);
+    };
+
+    // Mapped rows the journal did not replace, then the journal
+    if (header) {
+        const uint32_t* dirs = column<uint32_t>(map, header->dir);
+        const uint32_t* names = column<uint32_t>(map, header->name);
+        std::string path;
+        for (uint32_t r = 0; r < header->count; r++) {
+            std::string_view name = pooled(names[r]);
+            path.clear();
+            if (dirs[r] != NO_DIR) {
+                path.append(pooled(dirs[r]));
+                path += '/';
+            }
+            path.append(name);
+            if (!overlay.empty() && overlay.count(path)) continue;
+
+            FileStamp stamp;
+            stamp.mtime = column<int64_t>(map, header->mtime)[r];
+            stamp.size = column<uint64_t>(map, header->size)[r];
+            stamp.hash = column<uint64_t>(map, header->hash)[r];
+            add(dirs[r] == NO_DIR ? NO_DIR : pool.intern(pooled(dirs[r])), pool.intern(name),
+                column<uint64_t>(map, header->pathHash)[r], pooled(column<uint32_t>(map, header->title)[r]),
+                pooled(column<uint32_t>(map, header->artist)[r]),
+                pooled(column<uint32_t>(map, header->album)[r]),
+                column<double>(map, header->duration)[r], stamp);
+        }
+    }
+    for (const auto& it : overlay) {
+        std::string_view path = it.first;
+        size_t slash = path.find_last_of('/');
+        uint32_t dir = NO_DIR, name;
+        if (slash == std::string_view::npos) {
+            name = pool.intern(path);
+        } else {
+            dir = pool.intern(path.substr(0, slash));
+            name = pool.intern(path.substr(slash + 1));
+        }
+        const Record& record = it.second;
+        add(dir, name, hashPath(path), record.info.title, record.info.artist, record.info.album,
+            record.info.duration, record.stamp);
+    }
+
+    uint32_t count = cols.name.size();
+    uint32_t buckets = 16;
+    while (buckets < 2 * (uint64_t)count) buckets *= 2;
+    std::vector<uint32_t> table(buckets, 0);
+    for (uint32_t r = 0; r < count; r++) {
+        uint32_t i = cols.pathHash[r] & (buckets - 1);
+        while (table[i] != 0) i = (i + 1) & (buckets - 1);
+        table[i] = r + 1;
+    }
+
+    // Lay out the columns
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, INDEX_MAGIC, 8);
+    h.version = INDEX_VERSION;
+    h.count = count;
+    h.buckets = buckets;
+
+    std::string out(sizeof(Header), '\0');
+    auto place = [&](const void* data, size_t bytes) {
+        out.resize((out.size() + 7) & ~(size_t)7, '\0');
+        uint64_t offset = out.size();
+        out.append((const char*)data, bytes);
+        return offset;
+    };
+    h.dir = place(cols.dir.data(), count * 4);
+    h.name = place(cols.name.data(), count * 4);
+    h.title = place(cols.title.data(), count * 4);
+    h.artist = place(cols.artist.data(), count * 4);
+    h.album = place(cols.album.data(), count * 4);
+    h.duration = place(cols.duration.data(), count * 8);
+    h.mtime = place(cols.mtime.data(), count * 8);
+    h.size = place(cols.size.data(), count * 8);
+    h.hash = place(cols.hash.data(), count * 8);
+    h.pathHash = place(cols.pathHash.data(), count * 8);
+    h.table = place(table.data(), (size_t)buckets * 4);
+    h.strings = place(pool.bytes.data(), pool.bytes.size());
+    h.stringsSize = pool.bytes.size();
+    h.fileSize = out.size();
+    std::memcpy(&out[0], &h, sizeof(h));
+
+    // Write beside, then rename over: readers never see a partial index
+    std::string tmp = indexPath + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = write(fd, out.data(), out.size()) == (ssize_t)out.size();
+    ok = (fsync(fd) == 0) && ok;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), indexPath.c_str()) != 0) {
+        unlink(tmp.c_str());
+        std::cerr << "[LIBRARY] Cannot write " << indexPath << std::endl;
+        return false;
+    }
+
+    unmapIndex();
+    mapIndex();
+    overlay.clear();
+    if (journalFd >= 0 && ftruncate(journalFd, 0) != 0) {
+        std::cerr << "[LIBRARY] Cannot reset journal" << std::endl;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (statsEnabled()) {
+        std::cerr << "[LIBRARY] Compacted " << count << " entries, " << out.size() / 1024 << " KiB, "
+                  << (int)ms << " ms" << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,229 @@
+#include "order_tree.h"
+#include <algorithm>
+#include <numeric>
+
+// Mixes the id so neighbours get unrelated priorities (lowbias32)
+uint32_t OrderTree::priority(uint32_t id) {
+    id ^= id >> 16;
+    id *= 0x7feb352dU;
+    id ^= id >> 15;
+    id *= 0x846ca68bU;
+    id ^= id >> 16;
+    return id;
+}
+
+uint32_t OrderTree::nodeAt(size_t position) const {
+    uint32_t node = root;
+    for (;;) {
+        size_t left = sizeOf(nodes[node].left);
+        if (position < left) {
+            node = nodes[node].left;
+        } else if (position == left) {
+            return node;
+        } else {
+            position -= left + 1;
+            node = nodes[node].right;
+        }
+    }
+}
+
+// Everything left of the node in its subtree, then, going up, the left
+// side of each ancestor it sits to the right of
+size_t OrderTree::positionOfNode(uint32_t id) const {
+    size_t position = sizeOf(nodes[id].left);
+    for (uint32_t node = id, parent = nodes[id].parent; parent != NIL; node = parent, parent = nodes[parent].parent) {
+        if (nodes[parent].right == node) position += sizeOf(nodes[parent].left) + 1;
+    }
+    return position;
+}
+
+void OrderTree::setLeft(uint32_t node, uint32_t child) {
+    nodes[node].left = child;
+    if (child != NIL) nodes[child].parent = node;
+}
+
+void OrderTree::setRight(uint32_t node, uint32_t child) {
+    nodes[node].right = child;
+    if (child != NIL) nodes[child].parent = node;
+}
+
+void OrderTree::setRoot(uint32_t node) {
+    root = node;
+    if (node != NIL) nodes[node].parent = NIL;
+}
+
+uint32_t OrderTree::merge(uint32_t a, uint32_t b) {
+    if (a == NIL) return b;
+    if (b == NIL) return a;
+    if (priority(a) > priority(b)) {
+        setRight(a, merge(nodes[a].right, b));
+        update(a);
+        return a;
+    }
+    setLeft(b, merge(a, nodes[b].left));
+    update(b);
+    return b;
+}
+
+// First k nodes into *a, the rest into *b
+void OrderTree::split(uint32_t node, size_t k, uint32_t* a, uint32_t* b) {
+    if (node == NIL) {
+        *a = *b = NIL;
+        return;
+    }
+    uint32_t rest;
+    size_t left = sizeOf(nodes[node].left);
+    if (left < k) {
+        split(nodes[node].right, k - left - 1, &rest, b);
+        setRight(node, rest);
+        *a = node;
+    } else {
+        split(nodes[node].left, k, a, &rest);
+        setLeft(node, rest);
+        *b = node;
+    }
+    update(node);
+}
+
+void OrderTree::reset(size_t n) {
+    std::vector<Node>().swap(nodes);
+    identity = true;
+    count = n;
+    root = NIL;
+}
+
+// Cartesian tree in one pass: a node pops every lighter node off the right
+// spine and takes the last one as its left child. A popped subtree gets no
+// more children, so its size is final right then.
+void OrderTree::assign(const std::vector<uint32_t>& sequence) {
+    identity = false;
+    count = sequence.size();
+    nodes.assign(count, Node{NIL, NIL, NIL, 1});
+    std::vector<uint32_t> spine;
+    for (uint32_t id : sequence) {
+        uint32_t last = NIL;
+        while (!spine.empty() && priority(spine.back()) < priority(id)) {
+            last = spine.back();
+            update(last);
+            spine.pop_back();
+        }
+        setLeft(id, last);
+        if (!spine.empty()) setRight(spine.back(), id);
+        spine.push_back(id);
+    }
+    // The bottom of the spine is the heaviest node: the root
+    uint32_t top = spine.empty() ? NIL : spine.front();
+    while (!spine.empty()) {
+        update(spine.back());
+        spine.pop_back();
+    }
+    setRoot(top);
+}
+
+void OrderTree::materialize() {
+    if (!identity) return;
+    std::vector<uint32_t> sequence(count);
+    std::iota(sequence.begin(), sequence.end(), 0);
+    assign(sequence);
+}
+
+// Room for n nodes. assign() sizes the vector exactly; growing it by
+// doubling from there would leave up to twice the nodes' bytes allocated,
+// so it grows by an eighth (still amortized O(1) per node).
+void OrderTree::reserveNodes(size_t n) {
+    if (nodes.capacity() >= n) return;
+    nodes.reserve(std::max(n, nodes.size() + nodes.size() / 8));
+}
+
+void OrderTree::extend(size_t n) {
+    if (n <= count) return;
+    if (identity) {
+        count = n;
+        return;
+    }
+    reserveNodes(n);
+    for (size_t id = count; id < n; id++) {
+        nodes.push_back(Node{NIL, NIL, NIL, 1});
+        setRoot(merge(root, id));
+    }
+    count = n;
+}
+
+void OrderTree::insert(size_t position) {
+    if (position > count) position = count;
+    if (identity && position == count) {
+        count++;
+        return;
+    }
+    materialize();
+    uint32_t id = count;
+    reserveNodes(count + 1);
+    nodes.push_back(Node{NIL, NIL, NIL, 1});
+    uint32_t a, b;
+    split(root, position, &a, &b);
+    setRoot(merge(merge(a, id), b));
+    count++;
+}
+
+void OrderTree::move(size_t from, size_t to) {
+    if (from >= count || to >= count || from == to) return;
+    materialize();
+    uint32_t a, rest, node, b;
+    split(root, from, &a, &rest);
+    split(rest, 1, &node, &b);
+    split(merge(a, b), to, &a, &b);
+    setRoot(merge(merge(a, node), b));
+}
+
+void OrderTree::erase(const std::vector<size_t>& ids) {
+    if (ids.empty()) return;
+    if (identity) {
+        // Dropping ids from 0..n-1 and renumbering leaves 0..n-k-1
+        count -= ids.size();
+        return;
+    }
+    std::vector<uint32_t> renumbered(count);
+    size_t removed = 0;
+    for (size_t id = 0; id < count; id++) {
+        if (removed < ids.size() && ids[removed] == id) {
+            renumbered[id] = NIL;
+            removed++;
+        } else {
+            renumbered[id] = id - removed;
+        }
+    }
+    std::vector<uint32_t> kept;
+    sequence(&kept);
+    size_t n = 0;
+    for (uint32_t id : kept) {
+        if (renumbered[id] != NIL) kept[n++] = renumbered[id];
+    }
+    kept.resize(n);
+    assign(kept);
+}
+
+void OrderTree::sequence(std::vector<uint32_t>* out) const {
+    out->resize(count);
+    if (identity) {
+        std::iota(out->begin(), out->end(), 0);
+        return;
+    }
+    // In-order walk with an explicit stack
+    std::vector<uint32_t> stack;
+    size_t n = 0;
+    uint32_t node = root;
+    while (node != NIL || !stack.empty()) {
+        while (node != NIL) {
+            stack.push_back(node);
+            node = nodes[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        (*out)[n++] = node;
+        node = nodes[node].right;
+    }
+}
+
+size_t OrderTree::memoryBytes() const {
+    return nodes.capacity() * sizeof(Node);
+}
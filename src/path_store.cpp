@@ -0,0 +1,125 @@
+#include "path_store.h"
+#include <cstring>
+
+static uint64_t hashComponent(uint32_t parent, std::string_view text) {
+    uint64_t h = 1469598103934665603ULL ^ parent;
+    for (char c : text) {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint32_t PathStore::store(std::string_view text) {
+    uint32_t at = arena.size();
+    arena.insert(arena.end(), text.begin(), text.end());
+    return at;
+}
+
+void PathStore::grow() {
+    std::vector<uint32_t> old;
+    old.swap(table);
+    table.assign(old.empty() ? 1024 : old.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (uint32_t slot : old) {
+        if (!slot) continue;
+        const Dir& d = dirs[slot - 1];
+        size_t i = hashComponent(d.parent, std::string_view(arena.data() + d.text, d.length)) & mask;
+        while (table[i]) i = (i + 1) & mask;
+        table[i] = slot;
+    }
+}
+
+uint32_t PathStore::child(uint32_t parent, std::string_view component) {
+    if ((dirs.size() + 1) * 2 > table.size()) grow();
+    size_t mask = table.size() - 1;
+    size_t i = hashComponent(parent, component) & mask;
+    for (; table[i]; i = (i + 1) & mask) {
+        const Dir& d = dirs[table[i] - 1];
+        if (d.parent == parent && d.length == component.size() &&
+            std::memcmp(arena.data() + d.text, component.data(), d.length) == 0) {
+            return table[i] - 1;
+        }
+    }
+    uint32_t id = dirs.size();
+    uint32_t length = component.size();
+    dirs.push_back(Dir{parent, store(component), length, dirs[parent].prefixLength + length});
+    table[i] = id + 1;
+    return id;
+}
+
+uint32_t PathStore::internDir(std::string_view dir) {
+    if (dirs.empty()) dirs.push_back(Dir{0, 0, 0, 0});
+    if (dir == lastDir) return lastDirId;
+
+    uint32_t node = 0;
+    for (size_t start = 0; start < dir.size();) {
+        size_t end = dir.find('/', start) + 1;   // dir ends with '/'
+        node = child(node, dir.substr(start, end - start));
+        start = end;
+    }
+    lastDir.assign(dir);
+    lastDirId = node;
+    return node;
+}
+
+PathHandle PathStore::add(std::string_view path) {
+    size_t slash = path.rfind('/');
+    size_t split = slash == std::string_view::npos ? 0 : slash + 1;
+    uint32_t dir = internDir(path.substr(0, split));
+    std::string_view name = path.substr(split);
+    entries.push_back(Entry{dir, store(name), (uint32_t)name.size()});
+    return entries.size() - 1;
+}
+
+// Filled from the end: the file name, then each directory up to the root
+void PathStore::pathInto(PathHandle handle, std::string* out) const {
+    const Entry& e = entries[handle];
+    size_t prefix = dirs[e.dir].prefixLength;
+    out->resize(prefix + e.length);
+    char* p = &(*out)[0];
+    std::memcpy(p + prefix, arena.data() + e.text, e.length);
+    for (uint32_t d = e.dir; d != 0; d = dirs[d].parent) {
+        const Dir& dir = dirs[d];
+        std::memcpy(p + dir.prefixLength - dir.length, arena.data() + dir.text, dir.length);
+    }
+}
+
+std::string PathStore::path(PathHandle handle) const {
+    std::string out;
+    pathInto(handle, &out);
+    return out;
+}
+
+std::string_view PathStore::name(PathHandle handle) const {
+    const Entry& e = entries[handle];
+    return std::string_view(arena.data() + e.text, e.length);
+}
+
+bool PathStore::equals(PathHandle handle, std::string_view path) const {
+    const Entry& e = entries[handle];
+    size_t prefix = dirs[e.dir].prefixLength;
+    if (path.size() != prefix + e.length) return false;
+    if (std::memcmp(path.data() + prefix, arena.data() + e.text, e.length) != 0) return false;
+    for (uint32_t d = e.dir; d != 0; d = dirs[d].parent) {
+        const Dir& dir = dirs[d];
+        if (std::memcmp(path.data() + dir.prefixLength - dir.length, arena.data() + dir.text, dir.length) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t PathStore::memoryBytes() const {
+    return arena.capacity() + dirs.capacity() * sizeof(Dir) + entries.capacity() * sizeof(Entry) +
+           table.capacity() * sizeof(uint32_t) + lastDir.capacity();
+}
+
+void PathStore::clear() {
+    std::vector<char>().swap(arena);
+    std::vector<Dir>().swap(dirs);
+    std::vector<Entry>().swap(entries);
+    std::vector<uint32_t>().swap(table);
+    lastDir.clear();
+    lastDirId = 0;
+}
@@ -0,0 +1,332 @@
+#include "pipeline.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+PipelineBackend Pipeline::backendFromEnv() {
+    const char* env = std::getenv("TERMAMP_BACKEND");
+    return env && std::strcmp(env, "lean") == 0 ? BACKEND_LEAN : BACKEND_PLAYBIN;
+}
+
+const char* Pipeline::backendName(PipelineBackend backend) {
+    return backend == BACKEND_LEAN ? "lean" : "playbin";
+}
+
+// playbin, or the lean pipeline's uridecodebin
+static bool hasUri(GstElement* element) {
+    return g_object_class_find_property(G_OBJECT_GET_CLASS(element), "uri") != NULL;
+}
+
+bool Pipeline::isPlaybin(GstElement* bin) {
+    return hasUri(bin);
+}
+
+// --- PLAYBIN ---
+static GstElement* createPlaybin(const char* name, const char* sinkName, GstElement** tap) {
+    GstElement* bin = gst_element_factory_make("playbin", name);
+    if (!bin) return nullptr;
+
+    // One sink for the pipeline's lifetime: playbin would otherwise plug a
+    // fresh one, and reopen the device, for every track
+    GstElement* sink = gst_element_factory_make(sinkName, NULL);
+    if (sink) g_object_set(G_OBJECT(bin), "audio-sink", sink, NULL);
+
+    // Pass-through tap in the audio path
+    *tap = gst_element_factory_make("identity", NULL);
+    if (*tap) g_object_set(G_OBJECT(bin), "audio-filter", *tap, NULL);
+    return bin;
+}
+
+// --- LEAN ---
+// Anything but audio is exposed as is, never decoded, and left unlinked
+static gboolean onAutoplugContinue(GstElement* decoder, GstPad* pad, GstCaps* caps, gpointer data) {
+    const gchar* media = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+    return !g_str_has_prefix(media, "video/") && !g_str_has_prefix(media, "image/") &&
+           !g_str_has_prefix(media, "text/") && !g_str_has_prefix(media, "subpicture/");
+}
+
+// The first raw audio pad feeds the chain; later ones (a second audio
+// stream) are ignored
+static void onDecoderPad(GstElement* decoder, GstPad* pad, gpointer data) {
+    GstElement* convert = (GstElement*)data;
+    GstPad* sinkPad = gst_element_get_static_pad(convert, "sink");
+    if (!gst_pad_is_linked(sinkPad)) {
+        GstCaps* caps = gst_pad_get_current_caps(pad);
+        if (!caps) caps = gst_pad_query_caps(pad, NULL);
+        const gchar* media = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+        if (g_str_has_prefix(media, "audio/x-raw")) gst_pad_link(pad, sinkPad);
+        gst_caps_unref(caps);
+    }
+    gst_object_unref(sinkPad);
+}
+
+// uridecodebin kept to audio, feeding `convert`
+static GstElement* createAutoplug(GstElement* convert) {
+    GstElement* decoder = gst_element_factory_make("uridecodebin", "decoder");
+    if (!decoder) return nullptr;
+    // Decoding stops at raw audio; other streams are not autoplugged
+    GstCaps* raw = gst_caps_from_string("audio/x-raw");
+    g_object_set(G_OBJECT(decoder), "caps", raw, NULL);
+    gst_caps_unref(raw);
+    g_signal_connect(decoder, "autoplug-continue", G_CALLBACK(onAutoplugContinue), NULL);
+    g_signal_connect(decoder, "pad-added", G_CALLBACK(onDecoderPad), convert);
+    return decoder;
+}
+
+static GstElement* createLean(const char* name, const char* sinkName, GstElement** tap) {
+    GstElement* convert = gst_element_factory_make("audioconvert", "convert");
+    GstElement* decoder = convert ? createAutoplug(convert) : nullptr;
+    GstElement* resample = gst_element_factory_make("audioresample", NULL);
+    GstElement* volume = gst_element_factory_make("volume", "volume");
+    GstElement* identity = gst_element_factory_make("identity", NULL);
+    GstElement* sink = gst_element_factory_make(sinkName, NULL);
+    if (!decoder || !convert || !resample || !volume || !identity || !sink) {
+        GstElement* made[] = {decoder, convert, resample, volume, identity, sink};
+        for (GstElement* element : made) {
+            if (element) gst_object_unref(gst_object_ref_sink(element));
+        }
+        return nullptr;
+    }
+
+    GstElement* bin = gst_pipeline_new(name);
+    gst_bin_add_many(GST_BIN(bin), decoder, convert, resample, volume, identity, sink, NULL);
+    if (!gst_element_link_many(convert, resample, volume, identity, sink, NULL)) {
+        gst_object_unref(bin);
+        return nullptr;
+    }
+    *tap = identity;
+    return bin;
+}
+
+// --- DECODER CHAINS (lean) ---
+static bool isCodec(GstElementFactory* factory) {
+    const gchar* klass = gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS);
+    return klass && (std::strstr(klass, "Demuxer") || std::strstr(klass, "Parser") || std::strstr(klass, "Decoder"));
+}
+
+// A demuxer's streams appear once it has read the headers: each goes to
+// the next element if that takes it (the audio stream), else stays unlinked
+static void onChainPad(GstElement* element, GstPad* pad, gpointer data) {
+    GstElement* next = (GstElement*)data;
+    GstPad* sinkPad = gst_element_get_static_pad(next, "sink");
+    if (sinkPad && !gst_pad_is_linked(sinkPad)) gst_pad_link(pad, sinkPad);
+    if (sinkPad) gst_object_unref(sinkPad);
+}
+
+// Same, when the demuxer ends the chain (WAV, AIFF): its raw audio pad
+// becomes the bin's output
+static void onChainEnd(GstElement* element, GstPad* pad, gpointer data) {
+    GstPad* ghost = (GstPad*)data;
+    GstPad* target = gst_ghost_pad_get_target(GST_GHOST_PAD(ghost));
+    if (target) {
+        gst_object_unref(target);
+        return;
+    }
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) caps = gst_pad_query_caps(pad, NULL);
+    const gchar* media = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+    if (g_str_has_prefix(media, "audio/x-raw")) gst_ghost_pad_set_target(GST_GHOST_PAD(ghost), pad);
+    gst_caps_unref(caps);
+}
+
+// filesrc ! <chain> in a bin named "decoder", with a ghost "src" pad on
+// the last element's output. NULL if an element is missing or is not a
+// demuxer, parser or decoder: the cache file is data, not a pipeline.
+static GstElement* createChain(const char* path, const std::string& chain) {
+    GstElement* front = gst_bin_new("decoder");
+    GstElement* prev = gst_element_factory_make("filesrc", NULL);
+    if (!prev) {
+        gst_object_unref(gst_object_ref_sink(front));
+        return nullptr;
+    }
+    g_object_set(G_OBJECT(prev), "location", path, NULL);
+    gst_bin_add(GST_BIN(front), prev);
+
+    size_t pos = 0;
+    while (pos < chain.size()) {
+        size_t end = chain.find(" ! ", pos);
+        if (end == std::string::npos) end = chain.size();
+        std::string name = chain.substr(pos, end - pos);
+        pos = end + 3;
+
+        GstElementFactory* factory = gst_element_factory_find(name.c_str());
+        GstElement* element = factory && isCodec(factory) ? gst_element_factory_create(factory, NULL) : nullptr;
+        if (factory) gst_object_unref(factory);
+        if (!element) {
+            gst_object_unref(gst_object_ref_sink(front));
+            return nullptr;
+        }
+        gst_bin_add(GST_BIN(front), element);
+        GstPad* src = gst_element_get_static_pad(prev, "src");
+        if (src) {
+            gst_object_unref(src);
+            if (!gst_element_link(prev, element)) {
+                gst_object_unref(gst_object_ref_sink(front));
+                return nullptr;
+            }
+        } else {
+            g_signal_connect(prev, "pad-added", G_CALLBACK(onChainPad), element);
+        }
+        prev = element;
+    }
+
+    GstPad* src = gst_element_get_static_pad(prev, "src");
+    GstPad* ghost;
+    if (src) {
+        ghost = gst_ghost_pad_new("src", src);
+        gst_object_unref(src);
+    } else {
+        ghost = gst_ghost_pad_new_no_target("src", GST_PAD_SRC);
+        g_signal_connect(prev, "pad-added", G_CALLBACK(onChainEnd), ghost);
+    }
+    gst_element_add_pad(front, ghost);
+    return front;
+}
+
+// Puts `front` in place of the "decoder" element; a chain's output is
+// linked now, uridecodebin links its own once it has decoded
+static void replaceFront(GstElement* bin, GstElement* front, GstElement* convert) {
+    GstElement* old = gst_bin_get_by_name(GST_BIN(bin), "decoder");
+    if (old) {
+        gst_element_set_state(old, GST_STATE_NULL);
+        gst_bin_remove(GST_BIN(bin), old);
+        gst_object_unref(old);
+    }
+    gst_bin_add(GST_BIN(bin), front);
+    GstPad* src = gst_element_get_static_pad(front, "src");
+    if (src) {
+        GstPad* sinkPad = gst_element_get_static_pad(convert, "sink");
+        gst_pad_link(src, sinkPad);
+        gst_object_unref(sinkPad);
+        gst_object_unref(src);
+    }
+    gst_element_sync_state_with_parent(front);
+}
+
+// The element pad at the other end of `pad`'s link, through the ghost pads
+// of any bins in between
+static GstPad* linkedPad(GstPad* pad) {
+    GstPad* peer = gst_pad_get_peer(pad);
+    while (peer && GST_IS_GHOST_PAD(peer)) {
+        GstPad* target = gst_ghost_pad_get_target(GST_GHOST_PAD(peer));
+        gst_object_unref(peer);
+        peer = target;
+    }
+    return peer;
+}
+
+// The sink pad whose data leaves through `src` (for a demuxer: its only one)
+static GstPad* feedingPad(GstPad* src) {
+    GstIterator* it = gst_pad_iterate_internal_links(src);
+    if (!it) return nullptr;
+    GstPad* sinkPad = nullptr;
+    GValue item = G_VALUE_INIT;
+    if (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+        sinkPad = GST_PAD(g_value_dup_object(&item));
+        g_value_unset(&item);
+    }
+    gst_iterator_free(it);
+    return sinkPad;
+}
+
+// --- Public API ---
+GstElement* Pipeline::create(PipelineBackend backend, const char* name, const char* sink, GstElement** tap) {
+    *tap = nullptr;
+    return backend == BACKEND_LEAN ? createLean(name, sink, tap) : createPlaybin(name, sink, tap);
+}
+
+void Pipeline::setUri(GstElement* bin, const char* uri) {
+    if (isPlaybin(bin)) {
+        g_object_set(G_OBJECT(bin), "uri", uri, NULL);
+        return;
+    }
+    GstElement* decoder = gst_bin_get_by_name(GST_BIN(bin), "decoder");
+    if (decoder && !hasUri(decoder)) {
+        // A chain from setChain(): back to autoplugging
+        gst_object_unref(decoder);
+        GstElement* convert = gst_bin_get_by_name(GST_BIN(bin), "convert");
+        decoder = createAutoplug(convert);
+        if (decoder) {
+            replaceFront(bin, decoder, convert);
+            gst_object_ref(decoder);
+        }
+        gst_object_unref(convert);
+    }
+    if (!decoder) return;
+    g_object_set(G_OBJECT(decoder), "uri", uri, NULL);
+    gst_object_unref(decoder);
+}
+
+bool Pipeline::setChain(GstElement* bin, const char* path, const std::string& chain) {
+    if (isPlaybin(bin)) return false;
+    GstElement* front = createChain(path, chain);
+    if (!front) return false;
+    GstElement* convert = gst_bin_get_by_name(GST_BIN(bin), "convert");
+    replaceFront(bin, front, convert);
+    gst_object_unref(convert);
+    return true;
+}
+
+bool Pipeline::autoplugged(GstElement* bin, std::string* chain, std::string* caps) {
+    chain->clear();
+    caps->clear();
+    if (isPlaybin(bin)) return false;
+    GstElement* decoder = gst_bin_get_by_name(GST_BIN(bin), "decoder");
+    bool autoplug = decoder && hasUri(decoder);
+    if (decoder) gst_object_unref(decoder);
+    if (!autoplug) return false;
+
+    // Upstream from audioconvert, element by element, until the pad inside
+    // decodebin's sink (no parent element): decoder, parser, demuxers,
+    // typefind, with queues in between
+    GstElement* convert = gst_bin_get_by_name(GST_BIN(bin), "convert");
+    GstPad* sinkPad = gst_element_get_static_pad(convert, "sink");
+    gst_object_unref(convert);
+    GstPad* src = linkedPad(sinkPad);
+    gst_object_unref(sinkPad);
+
+    std::vector<std::string> names;
+    while (src) {
+        GstElement* element = gst_pad_get_parent_element(src);
+        if (!element) {
+            gst_object_unref(src);
+            break;
+        }
+        GstElementFactory* factory = gst_element_get_factory(element);
+        if (factory && std::strcmp(GST_OBJECT_NAME(factory), "typefind") == 0) {
+            GstCaps* found = gst_pad_get_current_caps(src);
+            if (found) {
+                gchar* text = gst_caps_to_string(found);
+                *caps = text;
+                g_free(text);
+                gst_caps_unref(found);
+            }
+        } else if (factory && isCodec(factory)) {
+            names.push_back(GST_OBJECT_NAME(factory));
+        }
+        gst_object_unref(element);
+
+        sinkPad = feedingPad(src);
+        gst_object_unref(src);
+        src = sinkPad ? linkedPad(sinkPad) : nullptr;
+        if (sinkPad) gst_object_unref(sinkPad);
+    }
+
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        if (!chain->empty()) *chain += " ! ";
+        *chain += *it;
+    }
+    return !chain->empty();
+}
+
+void Pipeline::setVolume(GstElement* bin, double volume) {
+    if (isPlaybin(bin)) {
+        g_object_set(G_OBJECT(bin), "volume", volume, NULL);
+        return;
+    }
+    GstElement* element = gst_bin_get_by_name(GST_BIN(bin), "volume");
+    if (!element) return;
+    g_object_set(G_OBJECT(element), "volume", volume, NULL);
+    gst_object_unref(element);
+}
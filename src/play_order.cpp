@@ -0,0 +1,248 @@
+#include "play_order.h"
+#include <algorithm>
+#include <random>
+
+// --- KEYED PERMUTATION ---
+
+// splitmix64 finalizer: the round function and the key schedule
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t mask(int bits) {
+    return (1ULL << bits) - 1;
+}
+
+void KeyedPermutation::init(size_t count, unsigned seed) {
+    n = count;
+    int bits = 0;
+    while ((1ULL << bits) < n) bits++;
+    lowBits = (bits + 1) / 2;
+    highBits = bits / 2;
+    uint64_t state = seed;
+    for (int i = 0; i < ROUNDS; i++) {
+        state += 0x9e3779b97f4a7c15ULL;
+        keys[i] = mix(state);
+    }
+}
+
+uint64_t KeyedPermutation::round(int i, uint64_t half) const {
+    return mix(half ^ keys[i]);
+}
+
+// The halves alternate widths (high, low), (low, high), ... so the
+// network works on an odd bit count; an even number of rounds ends on
+// the starting layout
+uint64_t KeyedPermutation::encrypt(uint64_t x) const {
+    uint64_t a = x >> lowBits;
+    uint64_t b = x & mask(lowBits);
+    for (int i = 0; i < ROUNDS; i++) {
+        uint64_t c = (a ^ round(i, b)) & mask(i % 2 ? lowBits : highBits);
+        a = b;
+        b = c;
+    }
+    return (a << lowBits) | b;
+}
+
+uint64_t KeyedPermutation::decrypt(uint64_t y) const {
+    uint64_t a = y >> lowBits;
+    uint64_t b = y & mask(lowBits);
+    for (int i = ROUNDS - 1; i >= 0; i--) {
+        uint64_t c = (b ^ round(i, a)) & mask(i % 2 ? lowBits : highBits);
+        b = a;
+        a = c;
+    }
+    return (a << lowBits) | b;
+}
+
+// Cycle-walking: the cycle through x must come back into [0, n)
+size_t KeyedPermutation::forward(size_t x) const {
+    uint64_t y = encrypt(x);
+    while (y >= n) y = encrypt(y);
+    return y;
+}
+
+size_t KeyedPermutation::inverse(size_t y) const {
+    uint64_t x = decrypt(y);
+    while (x >= n) x = decrypt(x);
+    return x;
+}
+
+// --- PLAY ORDER ---
+
+void PlayOrder::reset(size_t n) {
+    tree.clear();
+    clearAdded();
+    mode = IDENTITY;
+    count = n;
+}
+
+void PlayOrder::clear() {
+    reset(0);
+}
+
+void PlayOrder::sequence(std::vector<uint32_t>* out) const {
+    if (mode == TREE) {
+        tree.sequence(out);
+    } else if (mode == IDENTITY && rows) {
+        rows->sequence(out);
+        // The rows may already hold entries this order is yet to be extended by
+        if (out->size() > count) {
+            out->erase(std::remove_if(out->begin(), out->end(), [this](uint32_t id) { return id >= count; }),
+                       out->end());
+        }
+    } else if (mode == KEYED && !added.empty()) {
+        // Each added entry goes in before the permuted entry its gap names
+        std::vector<uint32_t> ids;
+        added.sequence(&ids);
+        out->resize(count);
+        size_t p = 0, i = 0;
+        for (size_t k = 0; k <= keyedCount; k++) {
+            while (i < ids.size() && addedGap[ids[i]] <= k) (*out)[p++] = (uint32_t)(keyedCount + ids[i++]);
+            if (k < keyedCount) (*out)[p++] = (uint32_t)keyed.forward(k);
+        }
+    } else {
+        out->resize(count);
+        for (size_t p = 0; p < count; p++) (*out)[p] = (*this)[p];
+    }
+}
+
+void PlayOrder::materialize() {
+    if (mode == TREE) return;
+    std::vector<uint32_t> order;
+    sequence(&order);
+    tree.assign(order);
+    clearAdded();
+    mode = TREE;
+}
+
+size_t PlayOrder::memoryBytes() const {
+    return tree.memoryBytes() + added.memoryBytes() + addedGap.capacity() * sizeof(uint32_t);
+}
+
+// --- KEYED WITH ADDED ENTRIES ---
+// Added positions rise strictly with their order, so both directions are
+// binary searches over the small tree.
+
+// How many added entries play before `position`
+size_t PlayOrder::addedBefore(size_t position) const {
+    size_t lo = 0, hi = added.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (addedPosition(mid) < position) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t PlayOrder::mergedAt(size_t position) const {
+    size_t i = addedBefore(position);
+    if (i < added.size() && addedPosition(i) == position) return keyedCount + added.at(i);
+    return keyed.forward(position - i);
+}
+
+size_t PlayOrder::mergedPositionOf(size_t index) const {
+    if (index >= keyedCount) {
+        uint32_t id = (uint32_t)(index - keyedCount);
+        return addedGap[id] + added.indexOf(id);
+    }
+    // Permuted entry k plays after every added entry whose gap is <= k
+    size_t k = keyed.inverse(index);
+    size_t lo = 0, hi = added.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (addedGap[added.at(mid)] <= k) lo = mid + 1;
+        else hi = mid;
+    }
+    return k + lo;
+}
+
+// The next playlist index, count, goes in at `position`
+void PlayOrder::insertAdded(size_t position) {
+    size_t i = addedBefore(position);
+    addedGap.push_back((uint32_t)(position - i));
+    added.insert(i);
+    count++;
+}
+
+void PlayOrder::clearAdded() {
+    added.clear();
+    addedGap.clear();
+    addedGap.shrink_to_fit();
+}
+
+// Past this many added entries the merge costs more than the tree: the
+// rewrite is paid once per keyedCount adds, O(1) each
+bool PlayOrder::addedOutgrown() const {
+    return added.size() > keyedCount;
+}
+
+void PlayOrder::extend(size_t n) {
+    if (n <= count) return;
+    if (mode == IDENTITY) {
+        count = n;
+        return;
+    }
+    if (mode == KEYED) {
+        while (count < n) insertAdded(count);
+        if (addedOutgrown()) materialize();
+        return;
+    }
+    tree.extend(n);
+    count = n;
+}
+
+void PlayOrder::extendShuffled(size_t n, size_t from, unsigned seed) {
+    if (n <= count) return;
+    if (from == 0) {
+        // Nothing played yet: a fresh shuffle is just as good and free
+        count = n;
+        shuffle(seed);
+        return;
+    }
+    std::default_random_engine rng(seed);
+    for (size_t i = count; i < n; i++) {
+        // Entry i goes into a uniform slot of the unplayed tail
+        size_t slot = from >= i ? i : std::uniform_int_distribution<size_t>(from, i)(rng);
+        if (mode == KEYED) {
+            insertAdded(slot);
+        } else {
+            if (mode == IDENTITY) materialize();
+            tree.insert(slot);
+        }
+    }
+    count = n;
+    if (mode == KEYED && addedOutgrown()) materialize();
+}
+
+void PlayOrder::shuffle(unsigned seed) {
+    tree.clear();
+    clearAdded();
+    mode = KEYED;
+    keyedCount = count;
+    keyed.init(count, seed);
+}
+
+void PlayOrder::move(size_t from, size_t to) {
+    if (from >= count || to >= count || from == to) return;
+    materialize();
+    tree.move(from, to);
+}
+
+void PlayOrder::erase(size_t index) {
+    if (index >= count) return;
+    erase(std::vector<size_t>{index});
+}
+
+void PlayOrder::erase(const std::vector<size_t>& indices) {
+    if (indices.empty()) return;
+    if (mode == IDENTITY) {
+        count -= indices.size();
+        return;
+    }
+    materialize();
+    tree.erase(indices);
+    count = tree.size();
+}
@@ -1,26 +1,34 @@
 #include "player.h"
+#include "utils.h"
 #include <iostream>
 #include <filesystem>
 
-Player::Player(AppState* state) : app(state), last_play_time(0) {
-    gst_init(NULL, NULL);
-    pipeline = gst_element_factory_make("playbin", "player");
-    
-    if (!pipeline) {
-        std::cerr << "CRITICAL: Failed to create GStreamer playbin." << std::endl;
-        return;
-    }
-
-    GstBus* bus = gst_element_get_bus(pipeline);
-    gst_bus_add_watch(bus, busCallback, this);
-    gst_object_unref(bus);
+Player::Player(AppState* state) : app(state) {
+    engine = new Engine(onEngineEvent, this, Pipeline::backendFromEnv());
+    send(CMD_VOLUME, "", app->volume);
 }
 
 Player::~Player() {
-    if (pipeline) {
-        gst_element_set_state(pipeline, GST_STATE_NULL);
-        gst_object_unref(pipeline);
+    resetSeeks();
+    if (Utils::statsEnabled()) {
+        Prefetcher::Stats stats = prefetcher.stats();
+        std::cerr << "[PREFETCH] " << stats.loads << " loads: " << stats.hits << " read ahead ("
+                  << (stats.loads ? stats.hits * 100 / stats.loads : 0) << "%), " << stats.partial
+                  << " partly, " << stats.cancelled << " cancelled, " << stats.bytes / (1 << 20)
+                  << " MB read" << std::endl;
     }
+    // Joins the engine thread, which tears the pipelines down
+    delete engine;
+    if (clock) gst_object_unref(clock);
+}
+
+void Player::send(EngineCommandType type, const std::string& path, double value) {
+    EngineCommand cmd;
+    cmd.type = type;
+    cmd.path = path;
+    cmd.value = value;
+    if (type == CMD_LOAD || type == CMD_STOP) cmd.generation = ++generation;
+    engine->post(cmd);
 }
 
 void Player::setEOSCallback(EOSCallback cb, void* data) {
@@ -28,134 +36,262 @@ void Player::setEOSCallback(EOSCallback cb, void* data) {
     eosData = data;
 }
 
-GstState Player::getState() {
-    GstState state = GST_STATE_NULL;
-    if (pipeline) gst_element_get_state(pipeline, &state, NULL, 100);
-    return state;
-}
-
-void Player::load(const std::string& path) {
-    stop(); 
-    std::string filename = std::filesystem::path(path).filename().string();
-    app->current_track_name = filename; 
-    
-    GError *error = NULL;
-    gchar *uri = gst_filename_to_uri(path.c_str(), &error);
-    
-    if (error) {
-        if (path.find("file://") == 0 || path.find("http://") == 0) {
-             g_object_set(G_OBJECT(pipeline), "uri", path.c_str(), NULL);
-        }
-        g_error_free(error);
-    } else {
-        g_object_set(G_OBJECT(pipeline), "uri", uri, NULL);
-        g_free(uri);
+void Player::setTrackCallbacks(NextTrackCallback next, NextTrackCallback skip,
+                               TrackChangedCallback changed, void* data) {
+    onNextTrack = next;
+    onSkipTarget = skip;
+    onTrackChanged = changed;
+    trackData = data;
+}
+
+void Player::refreshNext() {
+    // Already handed to playbin: the playlist is asked again once it starts
+    bool queued = engine->isQueued();
+    std::string path;
+    if (!queued) {
+        bool have = app->gapless && onNextTrack && onNextTrack(trackData, &path);
+        if (!have) path.clear();
+        engine->setNext(path);
     }
+
+    std::string skip;
+    if (!onSkipTarget || !onSkipTarget(trackData, &skip)) skip.clear();
+    prepare(skip);
+    if (!queued) prefetcher.predict(path.empty() ? skip : path);
+}
+
+void Player::setEventCallback(PlayerEventCallback cb, void* data) {
+    onEvent = cb;
+    eventData = data;
+}
+
+void Player::notify() {
+    if (onEvent) onEvent(eventData);
+}
+
+void Player::setPcmCallback(PcmCallback cb, void* data) {
+    engine->setPcmCallback(cb, data);
+}
+
+void Player::prepare(const std::string& path) {
+    send(CMD_PREPARE, path);
+}
+
+// Mirrors what was last requested; the engine catches up asynchronously
+GstState Player::getState() {
+    if (app->playing) return GST_STATE_PLAYING;
+    if (app->paused) return GST_STATE_PAUSED;
+    return GST_STATE_NULL;
+}
+
+void Player::load(const std::string& path, double start) {
+    app->playing = false;
+    app->paused = false;
+    app->current_track_name = std::filesystem::path(path).filename().string();
+    duration = 0.0;
+    setAnchor((gint64)(start * GST_SECOND), NULL, 0, GST_CLOCK_TIME_NONE);
+    resetSeeks();
+    prefetcher.loaded(path);
+    send(CMD_LOAD, path, start);
+    notify();
 }
 
 void Player::play() {
-    if (!pipeline) return;
-    
-    // CRITICAL: Record time.
-    last_play_time = g_get_monotonic_time();
-    
-    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    send(CMD_PLAY);
     app->playing = true;
     app->paused = false;
+    notify();
 }
 
 void Player::pause() {
-    if (!pipeline) return;
-    gst_element_set_state(pipeline, GST_STATE_PAUSED);
+    send(CMD_PAUSE);
     app->playing = false;
     app->paused = true;
+    notify();
 }
 
 void Player::stop() {
-    if (!pipeline) return;
-    gst_element_set_state(pipeline, GST_STATE_NULL);
+    resetSeeks();
+    send(CMD_STOP);
     app->playing = false;
     app->paused = false;
-    app->current_track_name = "Ready"; 
+    app->current_track_name = "Ready";
+    duration = 0.0;
+    setAnchor(0, NULL, 0, GST_CLOCK_TIME_NONE);
+    notify();
 }
 
 void Player::setVolume(double volume) {
-    if (!pipeline) return;
-    g_object_set(G_OBJECT(pipeline), "volume", volume, NULL);
+    app->volume = volume;
+    send(CMD_VOLUME, "", volume);
 }
 
-void Player::seek(double seconds) {
-    if (!pipeline) return;
-    gst_element_seek_simple(pipeline, GST_FORMAT_TIME, 
-        (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), 
-        (gint64)(seconds * GST_SECOND));
+// --- SEEK SCHEDULER ---
+// Scrubbing and key repeat produce far more requests than the pipeline can
+// flush for. Only the newest target is kept; it goes out when the seek in
+// flight lands (EV_SEEK_DONE). Scrubbing uses KEY_UNIT seeks and, once the
+// requests stop for SEEK_SETTLE_MS, one ACCURATE seek to the final target.
+const guint SEEK_SETTLE_MS = 200;
+
+void Player::seek(double seconds, bool scrubbing) {
+    seek_target = seconds;
+    seek_accurate = !scrubbing;
+    seek_requested = g_get_monotonic_time();
+    seek_queued = true;
+    seek_requests++;
+
+    if (settle_source) {
+        g_source_remove(settle_source);
+        settle_source = 0;
+    }
+    if (scrubbing) settle_source = g_timeout_add(SEEK_SETTLE_MS, onSeekSettled, this);
+
+    // Show the target right away; the engine re-anchors once the seek lands
+    setAnchor((gint64)(seconds * GST_SECOND), NULL, 0, GST_CLOCK_TIME_NONE);
+    if (!seek_in_flight) dispatchSeek();
+}
+
+gboolean Player::onSeekSettled(gpointer data) {
+    Player* player = (Player*)data;
+    player->settle_source = 0;
+    player->seek_accurate = true;
+    player->seek_requested = g_get_monotonic_time();
+    player->seek_queued = true;
+    if (!player->seek_in_flight) player->dispatchSeek();
+    return G_SOURCE_REMOVE;
+}
+
+void Player::dispatchSeek() {
+    if (!seek_queued) return;
+    seek_queued = false;
+    seek_in_flight = true;
+    seek_dispatches++;
+
+    // Only a playing pipeline produces audio to time against
+    seek_audio_from = app->playing ? seek_requested : 0;
+    seek_audio_accurate = seek_accurate;
+
+    EngineCommand cmd;
+    cmd.type = CMD_SEEK;
+    cmd.value = seek_target;
+    cmd.accurate = seek_accurate;
+    engine->post(cmd);
+}
+
+void Player::resetSeeks() {
+    if (settle_source) {
+        g_source_remove(settle_source);
+        settle_source = 0;
+    }
+    seek_in_flight = false;
+    seek_queued = false;
+    seek_audio_from = 0;
+    seek_requests = 0;
+    seek_dispatches = 0;
+}
+
+void Player::setAnchor(gint64 pos, GstClock* anchorClock, GstClockTime base, GstClockTime running) {
+    if (anchorClock) gst_object_ref(anchorClock);
+    if (clock) gst_object_unref(clock);
+    clock = anchorClock;
+    anchor_pos = pos;
+    anchor_base = base;
+    anchor_running = running;
 }
 
 double Player::getPosition() {
-    if (!pipeline) return 0.0;
-    gint64 pos = 0;
-    if (gst_element_query_position(pipeline, GST_FORMAT_TIME, &pos)) {
-        return (double)pos / GST_SECOND;
+    // While playing, position advances with the pipeline clock from the
+    // last anchor the engine posted
+    double pos = (double)anchor_pos / GST_SECOND;
+    if (app->playing && clock && GST_CLOCK_TIME_IS_VALID(anchor_running)) {
+        GstClockTime now = gst_clock_get_time(clock);
+        GstClockTime at = anchor_base + anchor_running;
+        if (now > at) pos += (double)(now - at) / GST_SECOND;
     }
-    return 0.0;
+    if (duration > 0 && pos > duration) pos = duration;
+    return pos;
 }
 
 double Player::getDuration() {
-    if (!pipeline) return 0.0;
-    gint64 dur = 0;
-    if (gst_element_query_duration(pipeline, GST_FORMAT_TIME, &dur)) {
-        return (double)dur / GST_SECOND;
-    }
-    return 0.0;
-}
-
-void Player::handleTags(GstTagList* tags) {
-    gchar *artist = NULL;
-    gchar *title = NULL;
-    gst_tag_list_get_string(tags, GST_TAG_ARTIST, &artist);
-    gst_tag_list_get_string(tags, GST_TAG_TITLE, &title);
-
-    if (title) {
-        std::string meta;
-        if (artist) meta = std::string(artist) + " - " + std::string(title);
-        else meta = std::string(title);
-        app->current_track_name = meta;
-        g_free(title);
-        if (artist) g_free(artist);
-    }
+    return duration;
 }
 
-gboolean Player::busCallback(GstBus* bus, GstMessage* msg, gpointer data) {
+void Player::onEngineEvent(void* data, const EngineEvent& event) {
+    // Main thread
     Player* player = (Player*)data;
-    switch (GST_MESSAGE_TYPE(msg)) {
-        case GST_MESSAGE_EOS: {
-            // CRITICAL FIX: Ignore EOS if happened < 2000ms (2 sec) after play/resume command.
-            // Termux/Android sometimes sends a flush EOS on resume.
-            guint64 now = g_get_monotonic_time();
-            if (now < player->last_play_time + 2000000) {
-                std::cerr << "[PLAYER] Spurious EOS ignored (Timestamp Guard)" << std::endl;
-                break; 
-            }
+    AppState* app = player->app;
+    if (event.type == EV_READY) {
+        // Sent once, whatever load or stop came before it
+        player->ready = true;
+        Utils::startupMark("engine ready", "gst_init " + std::to_string((long long)event.value) + " ms");
+        player->notify();
+        return;
+    }
+    if (event.generation != player->generation) return;
 
+    switch (event.type) {
+        case EV_EOS:
             // Check if we actually intend to be playing
-            if (player->app->playing) {
+            if (app->playing) {
                 if (player->onEOS) player->onEOS(player->eosData);
                 else player->stop();
             }
+            return;
+        case EV_ERROR:
+            // The engine already tore the pipeline down
+            app->playing = false;
+            app->paused = false;
+            app->current_track_name = "Ready";
+            player->duration = 0.0;
+            player->setAnchor(0, NULL, 0, GST_CLOCK_TIME_NONE);
             break;
-        }
-        case GST_MESSAGE_ERROR:
-            player->stop();
+        case EV_STREAM_START:
+            // A gapless transition completed without leaving PLAYING
+            if (!event.text.empty()) {
+                player->prefetcher.loaded(event.text);
+                app->current_track_name = std::filesystem::path(event.text).filename().string();
+                if (player->onTrackChanged) player->onTrackChanged(player->trackData);
+            }
+            player->refreshNext();
+            break;
+        case EV_TAGS:
+            app->current_track_name = event.text;
             break;
-        case GST_MESSAGE_TAG: {
-            GstTagList *tags = NULL;
-            gst_message_parse_tag(msg, &tags);
-            player->handleTags(tags);
-            gst_tag_list_unref(tags);
+        case EV_DURATION:
+            player->duration = event.value;
             break;
-        }
-        default:
+        case EV_POSITION:
+            if (!player->heard && event.running != GST_CLOCK_TIME_NONE) {
+                player->heard = true;
+                Utils::startupMark("first audio");
+            }
+            // A queued seek would snap the bar back for a moment
+            if (player->seek_queued) return;
+            player->setAnchor(event.position, event.clock, event.base_time, event.running);
             break;
+        case EV_SEEK_DONE:
+            player->seek_in_flight = false;
+            if (player->seek_queued) {
+                player->dispatchSeek();
+                return;
+            }
+            if (!player->settle_source && Utils::statsEnabled() && player->seek_requests > 0) {
+                std::cerr << "[PLAYER] Seek burst: " << player->seek_requests << " requests, "
+                          << player->seek_dispatches << " seeks" << std::endl;
+                player->seek_requests = 0;
+                player->seek_dispatches = 0;
+            }
+            return;
+        case EV_SEEK_AUDIO:
+            if (player->seek_audio_from != 0) {
+                gint64 ms = (g_get_monotonic_time() - player->seek_audio_from) / 1000;
+                std::cerr << "[PLAYER] Seek to audio: " << ms << " ms ("
+                          << (player->seek_audio_accurate ? "accurate" : "key-unit") << ")" << std::endl;
+                player->seek_audio_from = 0;
+            }
+            return;
+        case EV_READY:
+            return;
     }
-    return TRUE;
+    player->notify();
 }
@@ -1,25 +1,83 @@
 #include "playlist.h"
+#include "scanner.h"
+#include "utils.h"
 #include <iostream>
-#include <fstream>
-#include <numeric>
+#include <cstring>
 #include <algorithm>
-#include <random>
 #include <chrono>
+#include <cstdint>
 
 // --- CONSTRUCTOR ---
-PlaylistManager::PlaylistManager(AppState* state, Player* pl, GtkWidget* list) 
-    : app(state), player(pl), listBox(list) {
-    parentWindow = gtk_widget_get_toplevel(listBox);
+PlaylistManager::PlaylistManager(AppState* state, Player* pl, GtkWidget* treeView) 
+    : app(state), player(pl), view(treeView) {
+    parentWindow = gtk_widget_get_toplevel(view);
+
+    // Virtualized list: fixed row height lets the view skip measuring rows
+    // it does not draw, so cost follows the window size, not the playlist
+    model = playlist_model_new(app);
+    GtkCellRenderer* cell = gtk_cell_renderer_text_new();
+    g_object_set(G_OBJECT(cell), "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+    GtkTreeViewColumn* column = gtk_tree_view_column_new_with_attributes("Track", cell, "text", PLAYLIST_COL_LABEL, NULL);
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_expand(column, TRUE);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(view), column);
+
+    // Durations, right-aligned, filled in as tags arrive
+    GtkCellRenderer* timeCell = gtk_cell_renderer_text_new();
+    g_object_set(G_OBJECT(timeCell), "xalign", 1.0, NULL);
+    GtkTreeViewColumn* timeColumn = gtk_tree_view_column_new_with_attributes("Time", timeCell, "text", PLAYLIST_COL_TIME, NULL);
+    gtk_tree_view_column_set_sizing(timeColumn, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(timeColumn, 52);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(view), timeColumn);
+    gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(view), FALSE);
+    gtk_tree_view_set_enable_search(GTK_TREE_VIEW(view), FALSE);
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(view), TRUE);
+    // Ctrl/Shift-click to pick several rows for Delete
+    gtk_tree_selection_set_mode(gtk_tree_view_get_selection(GTK_TREE_VIEW(view)), GTK_SELECTION_MULTIPLE);
+    // Rows are dragged within the view; the model hands the move back here
+    playlist_model_set_move_callback(model, onRowMoved, this);
+    gtk_tree_view_set_reorderable(GTK_TREE_VIEW(view), TRUE);
+    app->play_order.setRows(&app->rows);
+    gtk_tree_view_set_model(GTK_TREE_VIEW(view), model);
+
+    library = new Library(Library::defaultDir());
+    tagPool = new TagPool(onTagsRead, this);
+}
+
+PlaylistManager::~PlaylistManager() {
+    cancelImport();
+    if (importThread.joinable()) importThread.join();
+    if (importSource) g_source_remove(importSource);
+    delete tagPool;
+    delete library;
+    g_object_unref(model);
 }
 
 // --- HELPER: Highlight ---
 void PlaylistManager::highlightCurrentTrack() {
     if (app->current_track_idx < 0 || app->current_track_idx >= (int)app->play_order.size()) return;
-    int actual_playlist_index = app->play_order[app->current_track_idx];
-    GtkListBoxRow* row = gtk_list_box_get_row_at_index(GTK_LIST_BOX(listBox), actual_playlist_index);
-    if (row) {
-        gtk_list_box_select_row(GTK_LIST_BOX(listBox), row);
-    }
+    size_t actual_playlist_index = app->play_order[app->current_track_idx];
+    selectIndex(rowOf(actual_playlist_index), false);
+}
+
+// --- HELPER: Selection ---
+// The cursor row: with several rows selected it is the one last clicked
+int PlaylistManager::selectedIndex() {
+    GtkTreePath* path = NULL;
+    gtk_tree_view_get_cursor(GTK_TREE_VIEW(view), &path, NULL);
+    if (!path) return -1;
+    int index = gtk_tree_path_get_indices(path)[0];
+    gtk_tree_path_free(path);
+    return index;
+}
+
+// Moves the cursor there and makes it the only selected row
+void PlaylistManager::selectIndex(int index, bool scroll) {
+    if (index < 0 || index >= (int)viewSize()) return;
+    GtkTreePath* path = gtk_tree_path_new_from_indices(index, -1);
+    gtk_tree_view_set_cursor(GTK_TREE_VIEW(view), path, NULL, FALSE);
+    if (scroll) gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(view), path, NULL, FALSE, 0, 0);
+    gtk_tree_path_free(path);
 }
 
 // --- FILE CHOOSER ---
@@ -28,159 +86,355 @@ void PlaylistManager::addFiles() {
                                          GTK_WINDOW(parentWindow),
                                          GTK_FILE_CHOOSER_ACTION_OPEN,
                                          "_Cancel", GTK_RESPONSE_CANCEL,
+                                         "Add _Folder", GTK_RESPONSE_APPLY,
                                          "_Open", GTK_RESPONSE_ACCEPT,
                                          NULL);
     
     gtk_file_chooser_set_select_multiple(GTK_FILE_CHOOSER(dialog), TRUE);
 
-    // Create Filter
+    // Audio files and playlists, matched case-insensitively by the scanner's
+    // extension table instead of one glob per spelling
     GtkFileFilter* filter = gtk_file_filter_new();
     gtk_file_filter_set_name(filter, "Supported Audio");
-
-    // Tier 1
-    gtk_file_filter_add_pattern(filter, "*.mp3"); gtk_file_filter_add_pattern(filter, "*.MP3");
-    gtk_file_filter_add_pattern(filter, "*.wav"); gtk_file_filter_add_pattern(filter, "*.WAV");
-    gtk_file_filter_add_pattern(filter, "*.ogg"); gtk_file_filter_add_pattern(filter, "*.OGG");
-    gtk_file_filter_add_pattern(filter, "*.flac"); gtk_file_filter_add_pattern(filter, "*.FLAC");
-    gtk_file_filter_add_pattern(filter, "*.m4a"); gtk_file_filter_add_pattern(filter, "*.M4A");
-    gtk_file_filter_add_pattern(filter, "*.aac"); gtk_file_filter_add_pattern(filter, "*.AAC");
-    gtk_file_filter_add_pattern(filter, "*.opus"); gtk_file_filter_add_pattern(filter, "*.OPUS");
-
-    // Tier 2
-    gtk_file_filter_add_pattern(filter, "*.wma"); gtk_file_filter_add_pattern(filter, "*.WMA");
-    gtk_file_filter_add_pattern(filter, "*.ape"); gtk_file_filter_add_pattern(filter, "*.APE");
-    gtk_file_filter_add_pattern(filter, "*.alac"); gtk_file_filter_add_pattern(filter, "*.ALAC");
-    gtk_file_filter_add_pattern(filter, "*.mka"); gtk_file_filter_add_pattern(filter, "*.MKA");
-
-    // Tier 3
-    gtk_file_filter_add_pattern(filter, "*.mod"); 
-    gtk_file_filter_add_pattern(filter, "*.xm");  
-    gtk_file_filter_add_pattern(filter, "*.it");  
-    gtk_file_filter_add_pattern(filter, "*.s3m"); 
-    gtk_file_filter_add_pattern(filter, "*.mid"); 
-    gtk_file_filter_add_pattern(filter, "*.midi");
-    gtk_file_filter_add_pattern(filter, "*.dsd"); 
-    gtk_file_filter_add_pattern(filter, "*.dsf");
-
-    // Playlists
-    gtk_file_filter_add_pattern(filter, "*.m3u");
-    gtk_file_filter_add_pattern(filter, "*.M3U");
-
+    gtk_file_filter_add_custom(filter, GTK_FILE_FILTER_DISPLAY_NAME,
+        [](const GtkFileFilterInfo* info, gpointer data) -> gboolean {
+            const char* name = info->display_name;
+            if (!name) return FALSE;
+            size_t len = strlen(name);
+            return Scanner::isAudioFile(name, len) || Scanner::isPlaylistFile(name, len);
+        }, NULL, NULL);
     gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), filter);
 
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+    std::vector<std::string> paths;
+    gint response = gtk_dialog_run(GTK_DIALOG(dialog));
+    if (response == GTK_RESPONSE_ACCEPT) {
         GSList *filenames = gtk_file_chooser_get_filenames(GTK_FILE_CHOOSER(dialog));
-        GSList *iter;
-        
-        size_t oldSize = app->playlist.size();
-        
-        for (iter = filenames; iter; iter = iter->next) {
-            char *cpath = (char *)iter->data;
-            std::string path(cpath);
-            
-            bool isM3u = false;
-            if (path.length() > 4) {
-                std::string ext = path.substr(path.length() - 4);
-                if (ext == ".m3u" || ext == ".M3U") isM3u = true;
-            }
+        for (GSList *iter = filenames; iter; iter = iter->next) {
+            paths.push_back((char *)iter->data);
+            g_free(iter->data);
+        }
+        g_slist_free(filenames);
+    } else if (response == GTK_RESPONSE_APPLY) {
+        // "Add Folder": the folder being browsed, scanned recursively
+        gchar* folder = gtk_file_chooser_get_current_folder(GTK_FILE_CHOOSER(dialog));
+        if (folder) {
+            paths.push_back(folder);
+            g_free(folder);
+        }
+    }
+    gtk_widget_destroy(dialog);
+
+    if (!paths.empty()) addPaths(paths);
+}
 
-            if (isM3u) {
-                std::string m3uDir = "";
-                size_t lastSlash = path.find_last_of("/");
-                if (lastSlash != std::string::npos) {
-                    m3uDir = path.substr(0, lastSlash + 1);
-                }
-
-                std::ifstream file(path);
-                std::string line;
-                while (std::getline(file, line)) {
-                    line.erase(0, line.find_first_not_of(" \t\r\n"));
-                    line.erase(line.find_last_not_of(" \t\r\n") + 1);
-                    if (line.empty() || line[0] == '#') continue;
-                    
-                    if (line.length() > 0 && line[0] == '/') {
-                        app->playlist.push_back(line);
-                    } else {
-                        app->playlist.push_back(m3uDir + line);
-                    }
-                }
-            } else {
-                app->playlist.push_back(path);
+// Durations in whole milliseconds for the DurationIndex; unknown is 0
+static int64_t toMs(double seconds) {
+    return seconds > 0 ? (int64_t)(seconds * 1000.0 + 0.5) : 0;
+}
+
+// --- IMPORT ---
+// Main-loop time spent appending per idle callback: the view repaints and
+// input is handled between slices however large the import
+static const gint64 IMPORT_SLICE_US = 5000;
+
+void PlaylistManager::setImportCallback(ImportCallback cb, void* data) {
+    onImport = cb;
+    importData = data;
+}
+
+void PlaylistManager::addPaths(const std::vector<std::string>& paths, bool play) {
+    if (paths.empty()) return;
+    if (importActive) {
+        importWaiting.push_back(paths);
+        return;
+    }
+    importPlay = play;
+    startImport(paths);
+}
+
+void PlaylistManager::startImport(const std::vector<std::string>& paths) {
+    importActive = true;
+    importCancelled = false;
+    importAdded = 0;
+    importKnown = 0;
+    importStart = g_get_monotonic_time();
+    importThread = std::thread(importWorker, this, paths, importGeneration);
+    if (onImport) onImport(importData);
+}
+
+void PlaylistManager::cancelImport() {
+    if (!importActive) return;
+    importGeneration++;
+    importWaiting.clear();
+    importPlay = false;
+    importCancelled = true;
+    std::lock_guard<std::mutex> lock(importMutex);
+    if (importScanner) importScanner->cancel();
+}
+
+// Worker thread
+void PlaylistManager::importWorker(PlaylistManager* mgr, std::vector<std::string> paths, unsigned generation) {
+    struct Sink {
+        PlaylistManager* mgr;
+        Scanner* scanner;
+        unsigned generation;
+    };
+    Scanner scanner;
+    Sink sink{mgr, &scanner, generation};
+    {
+        std::lock_guard<std::mutex> lock(mgr->importMutex);
+        mgr->importScanner = &scanner;
+    }
+
+    ScanStats stats = scanner.scan(paths, [](void* data, std::vector<std::string>& found,
+                                             std::vector<ScanInfo>& info) {
+        Sink* sink = (Sink*)data;
+        // A cancel that landed before scan() started
+        if (sink->mgr->importCancelled) sink->scanner->cancel();
+        ImportBatch batch;
+        batch.generation = sink->generation;
+        batch.paths = std::move(found);
+        batch.info = std::move(info);
+        sink->mgr->postImport(std::move(batch));
+    }, &sink);
+
+    {
+        std::lock_guard<std::mutex> lock(mgr->importMutex);
+        mgr->importScanner = nullptr;
+    }
+    ImportBatch done;
+    done.generation = generation;
+    done.last = true;
+    done.stats = stats;
+    mgr->postImport(std::move(done));
+}
+
+// Any thread
+void PlaylistManager::postImport(ImportBatch&& batch) {
+    std::lock_guard<std::mutex> lock(importMutex);
+    importQueue.push_back(std::move(batch));
+    if (!importSource) importSource = g_idle_add(onImportIdle, this);
+}
+
+gboolean PlaylistManager::onImportIdle(gpointer data) {
+    PlaylistManager* mgr = (PlaylistManager*)data;
+    gint64 deadline = g_get_monotonic_time() + IMPORT_SLICE_US;
+    size_t added = mgr->importAdded;
+    bool more = true;
+    while (more && g_get_monotonic_time() < deadline) {
+        ImportBatch batch;
+        {
+            std::lock_guard<std::mutex> lock(mgr->importMutex);
+            if (mgr->importQueue.empty()) {
+                mgr->importSource = 0;
+                more = false;
+                break;
             }
-            g_free(cpath);
+            batch = std::move(mgr->importQueue.front());
+            mgr->importQueue.pop_front();
         }
-        g_slist_free(filenames);
-        
-        size_t newSize = app->playlist.size();
-        app->play_order.resize(newSize);
-        for(size_t i = oldSize; i < newSize; i++) {
-            app->play_order[i] = i;
+        if (batch.last) mgr->finishImport(batch.stats);
+        else if (batch.generation == mgr->importGeneration) mgr->applyImport(batch);
+    }
+
+    if (mgr->importAdded != added) mgr->player->refreshNext();
+    if (mgr->onImport) mgr->onImport(mgr->importData);
+    return more ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+void PlaylistManager::applyImport(ImportBatch& batch) {
+    size_t oldSize = app->playlist.size();
+    for (const std::string& path : batch.paths) app->playlist.push_back(app->paths.add(path));
+    size_t newSize = app->playlist.size();
+    if (newSize == oldSize) return;
+
+    // #EXTINF and friends: shown as is, no need to read the files
+    app->tracks.resize(newSize);
+    for (ScanInfo& entry : batch.info) app->tracks[oldSize + entry.offset] = std::move(entry.info);
+
+    app->rows.extend(newSize);
+    if (app->shuffle) {
+        // New entries are shuffled into what has not played yet; the
+        // current track and everything before it keep their places
+        unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+        app->play_order.extendShuffled(newSize, app->current_track_idx + 1, seed);
+        invalidateDurations();
+    } else {
+        app->play_order.extend(newSize);
+    }
+    importAdded += newSize - oldSize;
+
+    // Rows the library knows show their tags at once; workers only stat
+    // those, and read tags for new or changed files. Entries whose playlist
+    // gave a title and duration are not read at all.
+    std::vector<TagJob> jobs;
+    jobs.reserve(newSize - oldSize);
+    LibraryEntry entry;
+    for (size_t i = oldSize; i < newSize; i++) {
+        TagJob job{i, std::move(batch.paths[i - oldSize]), FileStamp()};
+        if (library->lookup(job.path, &entry)) {
+            app->tracks[i] = entry.toInfo();
+            job.known = entry.stamp;
+            importKnown++;
+        } else if (!app->tracks[i].title.empty() && app->tracks[i].duration > 0) {
+            continue;
         }
-        
-        // If shuffling was already on, we might want to re-shuffle or just append
-        // For now, we just append linearly to keep it simple.
-        
-        refreshUI();
+        jobs.push_back(std::move(job));
+    }
+    tagPool->submit(jobs);
+    for (size_t i = oldSize; i < newSize; i++) indexEntry(i);
+    size_t oldView = viewSize();
+    if (filtered) {
+        // New entries are the last rows, so their row is their index
+        std::vector<uint32_t> added, found;
+        for (size_t i = oldSize; i < newSize; i++) added.push_back(i);
+        search.search(SearchIndex::terms(filterQuery), &added, &found);
+        filterEntries.insert(filterEntries.end(), found.begin(), found.end());
+        filterRows.insert(filterRows.end(), found.begin(), found.end());
+    }
+    appendUI(oldView);
+    // Unshuffled, new entries are the last positions of the order
+    if (!durationsStale) {
+        for (size_t i = oldSize; i < newSize; i++) durations.append(toMs(app->tracks[i].duration));
     }
 
-    gtk_widget_destroy(dialog);
+    if (importPlay) {
+        importPlay = false;
+        playEntry(oldSize);
+    }
+}
+
+void PlaylistManager::finishImport(const ScanStats& stats) {
+    if (importThread.joinable()) importThread.join();
+    importActive = false;
+    importPlay = false;
+
+    if (Utils::statsEnabled()) {
+        std::cerr << "[SCANNER] " << stats.files << " files in " << stats.dirs << " directories, "
+                  << (int)(stats.seconds * 1000) << " ms; " << importAdded << " rows in "
+                  << (g_get_monotonic_time() - importStart) / 1000 << " ms" << std::endl;
+        std::cerr << "[LIBRARY] " << importKnown << " of " << importAdded << " entries cached" << std::endl;
+    }
+
+    if (!importWaiting.empty()) {
+        std::vector<std::string> paths = std::move(importWaiting.front());
+        importWaiting.pop_front();
+        startImport(paths);
+    }
+}
+
+// --- TAGS ---
+struct TagDelivery {
+    PlaylistManager* mgr;
+    std::vector<TagResult> batch;
+};
+
+// Worker thread: hand the batch to the main loop
+void PlaylistManager::onTagsRead(void* data, std::vector<TagResult>& batch) {
+    TagDelivery* delivery = new TagDelivery{(PlaylistManager*)data, std::move(batch)};
+    g_idle_add([](gpointer d) -> gboolean {
+        TagDelivery* delivery = (TagDelivery*)d;
+        delivery->mgr->applyTags(delivery->batch);
+        delete delivery;
+        return G_SOURCE_REMOVE;
+    }, delivery);
+}
+
+void PlaylistManager::applyTags(std::vector<TagResult>& batch) {
+    // Rows off screen are read fresh when scrolled to; only redraw visible ones
+    GtkTreePath* first = NULL;
+    GtkTreePath* last = NULL;
+    int from = 0, to = -1;
+    if (gtk_tree_view_get_visible_range(GTK_TREE_VIEW(view), &first, &last)) {
+        from = gtk_tree_path_get_indices(first)[0];
+        to = gtk_tree_path_get_indices(last)[0];
+        gtk_tree_path_free(first);
+        gtk_tree_path_free(last);
+    }
+
+    for (TagResult& result : batch) {
+        // The playlist may have been cleared or edited while this was read
+        size_t i = result.index;
+        if (i >= app->playlist.size() || !app->paths.equals(app->playlist[i], result.path)) continue;
+        if (result.unchanged) continue;
+        if (result.stamp.size > 0) library->put(result.path, result.stamp, result.info);
+        app->tracks[i] = std::move(result.info);
+        if (!durationsStale) durations.set(app->play_order.positionOf(i), toMs(app->tracks[i].duration));
+        // Shown rows stay put until the query changes; the new tags may
+        // match where the old did not, so the next key searches afresh
+        indexEntry(i);
+        filterExact = false;
+        if (to < from) continue;
+        int row = rowOf(i);
+        if (row >= from && row <= to) playlist_model_row_changed(model, row);
+    }
+    library->flush();
 }
 
 // --- CLEAR ---
 void PlaylistManager::clear() {
+    cancelImport();
     player->stop();
+    tagPool->cancel();
     app->playlist.clear();
+    app->paths.clear();
+    app->tracks.clear();
+    app->rows.clear();
     app->play_order.clear();
+    durations.clear();
+    durationsStale = false;
+    // The query stays for what is added next
+    search.clear();
+    filterEntries.clear();
+    filterRows.clear();
+    filterExact = true;
     app->current_track_idx = -1;
     app->playing = false;
     app->paused = false;
     refreshUI();
+    player->refreshNext();
 }
 
 // --- REFRESH UI ---
+// Rows are not widgets any more: re-attaching the model makes the view
+// re-read the row count; labels are produced only for visible rows.
 void PlaylistManager::refreshUI() {
-    GList *children = gtk_container_get_children(GTK_CONTAINER(listBox));
-    for (GList *iter = children; iter != NULL; iter = g_list_next(iter)) {
-        gtk_widget_destroy(GTK_WIDGET(iter->data));
-    }
-    g_list_free(children);
+    gtk_tree_view_set_model(GTK_TREE_VIEW(view), NULL);
+    playlist_model_reset(model);
+    playlist_model_set_filter(model, filtered ? &filterRows : nullptr);
+    gtk_tree_view_set_model(GTK_TREE_VIEW(view), model);
+    highlightCurrentTrack();
+}
 
-    for (size_t i = 0; i < app->playlist.size(); i++) {
-        std::string path = app->playlist[i];
-        size_t lastSlash = path.find_last_of("/");
-        std::string name = (lastSlash != std::string::npos) ? path.substr(lastSlash + 1) : path;
-        
-        std::string labelStr = std::to_string(i + 1) + ". " + name;
-        
-        GtkWidget* label = gtk_label_new(labelStr.c_str());
-        gtk_label_set_xalign(GTK_LABEL(label), 0.0);
-        
-        gtk_container_add(GTK_CONTAINER(listBox), label);
-        gtk_widget_show(label);
+void PlaylistManager::appendUI(size_t from) {
+    if (viewSize() == from) return;
+    // One row-inserted per row is cheap for a handful, a reset wins for imports
+    if (from == 0 || viewSize() - from > 1000) {
+        refreshUI();
+        return;
     }
+    playlist_model_rows_appended(model, from);
 }
 
 // --- ROW CLICK ---
-void PlaylistManager::onRowActivated(GtkListBox* box, GtkListBoxRow* row) {
-    int visual_index = gtk_list_box_row_get_index(row);
-    if (visual_index < 0 || visual_index >= (int)app->playlist.size()) return;
+void PlaylistManager::onRowActivated(int visual_index) {
+    if (visual_index < 0 || visual_index >= (int)viewSize()) return;
+    playEntry(entryAt(visual_index));
+}
 
-    if (!app->shuffle) {
-        app->current_track_idx = visual_index;
-    } else {
-        for(size_t i=0; i<app->play_order.size(); i++) {
-            if((int)app->play_order[i] == visual_index) {
-                app->current_track_idx = i;
-                break;
-            }
-        }
-    }
+void PlaylistManager::playEntry(size_t entry) {
+    app->current_track_idx = app->play_order.positionOf(entry);
 
     size_t real_file_index = app->play_order[app->current_track_idx];
-    player->load(app->playlist[real_file_index]);
+    player->load(app->paths.path(app->playlist[real_file_index]));
     player->play();
 }
 
+void PlaylistManager::activateSelected() {
+    int index = selectedIndex();
+    if (index >= 0) onRowActivated(index);
+}
+
 // --- AUTO ADVANCE ---
 void PlaylistManager::autoAdvance() {
     if (app->playlist.empty()) {
@@ -190,7 +444,7 @@ void PlaylistManager::autoAdvance() {
     if (app->repeatMode == REP_ONE) {
         if (app->current_track_idx >= 0) {
             size_t real_idx = app->play_order[app->current_track_idx];
-            player->load(app->playlist[real_idx]);
+            player->load(app->paths.path(app->playlist[real_idx]));
             player->play();
         }
         return;
@@ -208,11 +462,47 @@ void PlaylistManager::autoAdvance() {
     }
     app->current_track_idx = next;
     size_t real_idx = app->play_order[app->current_track_idx];
-    player->load(app->playlist[real_idx]);
+    player->load(app->paths.path(app->playlist[real_idx]));
     player->play();
     highlightCurrentTrack();
 }
 
+// --- GAPLESS ---
+// Order index that follows the current one, or -1 when playback should end
+int PlaylistManager::nextOrderIndex() {
+    if (app->play_order.empty() || app->current_track_idx < 0) return -1;
+    if (app->repeatMode == REP_ONE) return app->current_track_idx;
+    int next = app->current_track_idx + 1;
+    if (next >= (int)app->play_order.size()) {
+        return (app->repeatMode == REP_ALL) ? 0 : -1;
+    }
+    return next;
+}
+
+bool PlaylistManager::peekNextPath(std::string* path) {
+    int next = nextOrderIndex();
+    if (next < 0) return false;
+    gapless_next = app->play_order[next];
+    app->paths.pathInto(app->playlist[gapless_next], path);
+    return true;
+}
+
+bool PlaylistManager::peekSkipPath(std::string* path) {
+    if (app->play_order.empty()) return false;
+    int next = app->current_track_idx + 1;
+    if (next >= (int)app->play_order.size()) next = 0; 
+    app->paths.pathInto(app->playlist[app->play_order[next]], path);
+    return true;
+}
+
+void PlaylistManager::commitGaplessAdvance() {
+    // Shuffle may have been toggled since the track was queued, so map
+    // the queued playlist entry back to its current order position.
+    if (gapless_next >= app->play_order.size()) return;
+    app->current_track_idx = app->play_order.positionOf(gapless_next);
+    highlightCurrentTrack();
+}
+
 // --- CONTROLS ---
 void PlaylistManager::playNext() {
     if (app->playlist.empty()) return;
@@ -220,7 +510,7 @@ void PlaylistManager::playNext() {
     if (next >= (int)app->play_order.size()) next = 0; 
     app->current_track_idx = next;
     size_t real_idx = app->play_order[app->current_track_idx];
-    player->load(app->playlist[real_idx]);
+    player->load(app->paths.path(app->playlist[real_idx]));
     player->play();
     highlightCurrentTrack();
 }
@@ -229,7 +519,7 @@ void PlaylistManager::playPrev() {
     if (app->playlist.empty()) return;
     if (player->getPosition() > 2.0) {
         if(app->current_track_idx >= 0) {
-            player->load(app->playlist[app->play_order[app->current_track_idx]]); 
+            player->load(app->paths.path(app->playlist[app->play_order[app->current_track_idx]])); 
             player->play();
         }
         return;
@@ -238,7 +528,7 @@ void PlaylistManager::playPrev() {
     if (prev < 0) prev = app->play_order.size() - 1; 
     app->current_track_idx = prev;
     size_t real_idx = app->play_order[app->current_track_idx];
-    player->load(app->playlist[real_idx]);
+    player->load(app->paths.path(app->playlist[real_idx]));
     player->play();
     highlightCurrentTrack();
 }
@@ -246,6 +536,7 @@ void PlaylistManager::playPrev() {
 // --- FIXED: STATE TOGGLES (CRASH FIX) ---
 void PlaylistManager::toggleShuffle() {
     app->shuffle = !app->shuffle;
+    invalidateDurations();
     
     // GUARD CLAUSE: If playlist is empty, stop here. 
     // We toggled the bool so the UI button will turn green (which is fine),
@@ -260,16 +551,11 @@ void PlaylistManager::toggleShuffle() {
         }
 
         unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-        std::shuffle(app->play_order.begin(), app->play_order.end(), std::default_random_engine(seed));
+        app->play_order.shuffle(seed);
 
         // Map current song to new index
         if (app->current_track_idx != -1) {
-            for(size_t i=0; i<app->play_order.size(); i++) {
-                if(app->play_order[i] == current_real_idx) {
-                    app->current_track_idx = i;
-                    break;
-                }
-            }
+            app->current_track_idx = app->play_order.positionOf(current_real_idx);
         }
     } else {
         // Turning OFF Shuffle
@@ -280,57 +566,311 @@ void PlaylistManager::toggleShuffle() {
             size_t current_real_idx = app->play_order[app->current_track_idx];
             
             // Reset order
-            std::iota(app->play_order.begin(), app->play_order.end(), 0);
+            app->play_order.reset(app->playlist.size());
             
-            // Set index to Real ID (since order is now 0,1,2...)
-            app->current_track_idx = current_real_idx;
+            // Unshuffled the order is the row order
+            app->current_track_idx = app->play_order.positionOf(current_real_idx);
         } else {
             // Nothing playing, just reset order
-            std::iota(app->play_order.begin(), app->play_order.end(), 0);
+            app->play_order.reset(app->playlist.size());
             // current_track_idx remains -1
         }
     }
+    player->refreshNext();
 }
 
 void PlaylistManager::toggleRepeat() {
     if (app->repeatMode == REP_OFF) app->repeatMode = REP_ALL;
     else if (app->repeatMode == REP_ALL) app->repeatMode = REP_ONE;
     else app->repeatMode = REP_OFF;
+    player->refreshNext();
 }
 
 // --- KEYBOARD HELPERS ---
 void PlaylistManager::selectNext() {
-    GtkListBoxRow* row = gtk_list_box_get_selected_row(GTK_LIST_BOX(listBox));
-    if (row) {
-        int idx = gtk_list_box_row_get_index(row);
-        if (idx < (int)app->playlist.size() - 1) {
-            GtkListBoxRow* next = gtk_list_box_get_row_at_index(GTK_LIST_BOX(listBox), idx + 1);
-            gtk_list_box_select_row(GTK_LIST_BOX(listBox), next);
-        }
+    int idx = selectedIndex();
+    if (idx >= 0 && idx < (int)viewSize() - 1) {
+        selectIndex(idx + 1, true);
     }
 }
 
 void PlaylistManager::selectPrev() {
-    GtkListBoxRow* row = gtk_list_box_get_selected_row(GTK_LIST_BOX(listBox));
-    if (row) {
-        int idx = gtk_list_box_row_get_index(row);
-        if (idx > 0) {
-            GtkListBoxRow* prev = gtk_list_box_get_row_at_index(GTK_LIST_BOX(listBox), idx - 1);
-            gtk_list_box_select_row(GTK_LIST_BOX(listBox), prev);
-        }
+    int idx = selectedIndex();
+    if (idx > 0) {
+        selectIndex(idx - 1, true);
     }
 }
 
 void PlaylistManager::deleteSelected() {
-     GtkListBoxRow* row = gtk_list_box_get_selected_row(GTK_LIST_BOX(listBox));
-     if(row) {
-         int idx = gtk_list_box_row_get_index(row);
-         app->playlist.erase(app->playlist.begin() + idx);
-         app->play_order.clear();
-         app->play_order.resize(app->playlist.size());
-         std::iota(app->play_order.begin(), app->play_order.end(), 0);
-         app->current_track_idx = -1; 
-         player->stop();
-         refreshUI();
-     }
+    std::vector<size_t> rows;
+    gtk_tree_selection_selected_foreach(gtk_tree_view_get_selection(GTK_TREE_VIEW(view)),
+        [](GtkTreeModel*, GtkTreePath* path, GtkTreeIter*, gpointer data) {
+            ((std::vector<size_t>*)data)->push_back(gtk_tree_path_get_indices(path)[0]);
+        }, &rows);
+    if (rows.empty()) return;
+    std::sort(rows.begin(), rows.end());
+    int cursor = selectedIndex();
+    // Rows to playlist indices, which is what gets compacted
+    std::vector<size_t> doomed(rows.size());
+    for (size_t k = 0; k < rows.size(); k++) doomed[k] = entryAt(rows[k]);
+    std::sort(doomed.begin(), doomed.end());
+
+    // The playing entry, if it survives, keeps playing; its playlist index
+    // is remapped below like everything else
+    size_t current = SIZE_MAX;
+    if (app->current_track_idx >= 0 && app->current_track_idx < (int)app->play_order.size()) {
+        current = app->play_order[app->current_track_idx];
+    }
+    size_t newCurrent = SIZE_MAX;
+    size_t newGapless = SIZE_MAX;
+
+    // One pass from the first removed entry: survivors slide down over the gaps
+    size_t n = app->playlist.size();
+    size_t kept = doomed[0];
+    size_t removed = 0;
+    for (size_t i = doomed[0]; i < n; i++) {
+        if (removed < doomed.size() && doomed[removed] == i) {
+            removed++;
+            continue;
+        }
+        if (i == current) newCurrent = kept;
+        if (i == gapless_next) newGapless = kept;
+        app->playlist[kept] = app->playlist[i];
+        app->tracks[kept] = std::move(app->tracks[i]);
+        kept++;
+    }
+    if (current < doomed[0]) newCurrent = current;
+    if (gapless_next < doomed[0]) newGapless = gapless_next;
+    app->playlist.resize(kept);
+    app->tracks.resize(kept);
+    // Shuffled or not, the rest keep their relative order
+    app->rows.erase(doomed);
+    app->play_order.erase(doomed);
+    search.erase(doomed);
+    invalidateDurations();
+    if (filtered) {
+        // Shown entries lose the doomed ones, which were all shown, and
+        // close up over them
+        size_t shown = 0, gone = 0;
+        for (uint32_t entry : filterEntries) {
+            if (gone < doomed.size() && doomed[gone] == entry) {
+                gone++;
+                continue;
+            }
+            filterEntries[shown++] = entry - gone;
+        }
+        filterEntries.resize(shown);
+        placeFilter();
+    }
+    // A queued gapless entry that was removed still plays; it is just not
+    // found in the playlist afterwards
+    gapless_next = newGapless;
+
+    if (newCurrent != SIZE_MAX) {
+        app->current_track_idx = app->play_order.positionOf(newCurrent);
+    } else if (current != SIZE_MAX) {
+        player->stop();
+        app->current_track_idx = -1;
+        app->playing = false;
+        app->paused = false;
+    }
+
+    // Row by row keeps the scroll position; past half the list a reset is
+    // cheaper than that many signals
+    size_t left = viewSize();
+    if (rows.size() > left) {
+        refreshUI();
+    } else {
+        playlist_model_rows_deleted(model, rows);
+    }
+    // The cursor stays on the row that slid into its place
+    if (cursor >= 0 && left > 0) {
+        size_t before = std::lower_bound(rows.begin(), rows.end(), (size_t)cursor) - rows.begin();
+        selectIndex(std::min((size_t)cursor - before, left - 1), false);
+    }
+    player->refreshNext();
+}
+
+// --- REORDER ---
+void PlaylistManager::onRowMoved(void* data, size_t from, size_t to) {
+    ((PlaylistManager*)data)->moveRow(from, to);
+}
+
+size_t PlaylistManager::currentEntry() {
+    if (app->current_track_idx < 0 || app->current_track_idx >= (int)app->play_order.size()) return SIZE_MAX;
+    return app->play_order[app->current_track_idx];
+}
+
+void PlaylistManager::moveRow(size_t from, size_t to) {
+    size_t playing = currentEntry();
+    app->rows.move(from, to);
+    playlist_model_row_moved(model, from, to);
+    if (!app->shuffle) invalidateDurations();
+    // Unshuffled, the order is the rows: the current track may have moved
+    if (playing != SIZE_MAX) app->current_track_idx = app->play_order.positionOf(playing);
+    selectIndex(to, false);
+    player->refreshNext();
+}
+
+// Selected rows, in row order, go right after the current track. Shuffled,
+// that is a move in the play order only; unshuffled the play order is the
+// row order, so the rows themselves move up under the playing one.
+void PlaylistManager::playSelectedNext() {
+    std::vector<size_t> entries;
+    gtk_tree_selection_selected_foreach(gtk_tree_view_get_selection(GTK_TREE_VIEW(view)),
+        [](GtkTreeModel*, GtkTreePath* path, GtkTreeIter*, gpointer data) {
+            ((std::vector<size_t>*)data)->push_back(gtk_tree_path_get_indices(path)[0]);
+        }, &entries);
+    if (entries.empty()) return;
+    std::sort(entries.begin(), entries.end());
+    for (size_t& row : entries) row = entryAt(row);
+
+    size_t playing = currentEntry();
+    size_t after = playing;
+    for (size_t entry : entries) {
+        if (entry == playing) continue;
+        size_t from = app->play_order.positionOf(entry);
+        size_t to = 0;
+        if (after != SIZE_MAX) {
+            size_t anchor = app->play_order.positionOf(after);
+            to = from < anchor ? anchor : anchor + 1;
+        }
+        if (app->shuffle) {
+            app->play_order.move(from, to);
+        } else {
+            app->rows.move(from, to);
+            // Filtered, the shown rows are placed again once at the end
+            if (!filtered) playlist_model_row_moved(model, from, to);
+        }
+        after = entry;
+    }
+    if (playing != SIZE_MAX) app->current_track_idx = app->play_order.positionOf(playing);
+    invalidateDurations();
+
+    if (!app->shuffle) {
+        if (filtered) {
+            placeFilter();
+            refreshUI();
+        }
+        // Moved rows lost their selection on the way
+        GtkTreeSelection* selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(view));
+        gtk_tree_selection_unselect_all(selection);
+        for (size_t entry : entries) {
+            int row = rowOf(entry);
+            if (row < 0) continue;
+            GtkTreePath* path = gtk_tree_path_new_from_indices(row, -1);
+            gtk_tree_selection_select_path(selection, path);
+            gtk_tree_path_free(path);
+        }
+    }
+    player->refreshNext();
+}
+
+// --- FILTER ---
+// One letter matches most of the playlist: filtering starts at two
+static const size_t FILTER_MIN_CHARS = 2;
+
+void PlaylistManager::indexEntry(size_t entry) {
+    const TrackInfo& info = app->tracks[entry];
+    search.set(entry, {app->paths.name(app->playlist[entry]), info.title, info.artist, info.album});
+}
+
+int PlaylistManager::rowOf(size_t entry) const {
+    size_t row = app->rows.indexOf(entry);
+    if (!filtered) return (int)row;
+    auto it = std::lower_bound(filterRows.begin(), filterRows.end(), (uint32_t)row);
+    if (it == filterRows.end() || *it != row) return -1;
+    return (int)(it - filterRows.begin());
+}
+
+void PlaylistManager::placeFilter() {
+    filterRows.clear();
+    size_t n = app->rows.size();
+    if (filterEntries.size() > n / 16) {
+        // Many matches: one walk over the rows beats a lookup each
+        std::vector<uint8_t> shown(n, 0);
+        for (uint32_t entry : filterEntries) shown[entry] = 1;
+        std::vector<uint32_t> order;
+        app->rows.sequence(&order);
+        for (size_t row = 0; row < n; row++) {
+            if (shown[order[row]]) filterRows.push_back(row);
+        }
+        return;
+    }
+    for (uint32_t entry : filterEntries) filterRows.push_back(app->rows.indexOf(entry));
+    std::sort(filterRows.begin(), filterRows.end());
+}
+
+void PlaylistManager::setFilter(const std::string& query) {
+    std::vector<std::string> terms = SearchIndex::terms(query);
+    size_t chars = 0;
+    for (const std::string& term : terms) chars += term.size();
+    if (chars < FILTER_MIN_CHARS) {
+        filterQuery = query;
+        if (!filtered) return;
+        filtered = false;
+        std::vector<uint32_t>().swap(filterEntries);
+        std::vector<uint32_t>().swap(filterRows);
+        refreshUI();
+        return;
+    }
+
+    // A query that extends the last one only narrows its matches
+    bool narrow = filtered && filterExact && query.compare(0, filterQuery.size(), filterQuery) == 0;
+    gint64 start = g_get_monotonic_time();
+    std::vector<uint32_t> found;
+    search.search(terms, narrow ? &filterEntries : nullptr, &found);
+    gint64 searched = g_get_monotonic_time() - start;
+    filterEntries.swap(found);
+    filterQuery = query;
+    filterExact = true;
+    filtered = true;
+    placeFilter();
+    refreshUI();
+
+    if (Utils::statsEnabled()) {
+        std::cerr << "[SEARCH] \"" << query << "\": " << filterEntries.size() << " of " << search.size()
+                  << " entries in " << searched << " us, shown in "
+                  << (g_get_monotonic_time() - start - searched) << " us" << std::endl;
+    }
+}
+
+// --- PLAYLIST TIME ---
+void PlaylistManager::ensureDurations() {
+    if (!durationsStale && durations.size() == app->play_order.size()) return;
+    std::vector<uint32_t> order;
+    app->play_order.sequence(&order);
+    std::vector<int64_t> ms(order.size());
+    for (size_t p = 0; p < order.size(); p++) ms[p] = toMs(app->tracks[order[p]].duration);
+    durations.build(ms);
+    durationsStale = false;
+}
+
+bool PlaylistManager::playlistTime(double* elapsed, double* total) {
+    ensureDurations();
+    *total = durations.total() / 1000.0;
+    *elapsed = 0.0;
+    int current = app->current_track_idx;
+    if (current >= 0 && current < (int)durations.size()) {
+        int64_t length = durations.get(current);
+        int64_t position = (app->playing || app->paused) ? toMs(player->getPosition()) : 0;
+        *elapsed = (durations.prefix(current) + std::min(position, length)) / 1000.0;
+    }
+    return durations.total() > 0;
+}
+
+void PlaylistManager::seekPlaylist(double seconds) {
+    if (app->playlist.empty()) return;
+    ensureDurations();
+    if (durations.total() <= 0) return;
+    int64_t offset = 0;
+    size_t position = durations.find(toMs(seconds), &offset);
+    if ((int)position == app->current_track_idx && (app->playing || app->paused)) {
+        player->seek(offset / 1000.0);
+        return;
+    }
+    app->current_track_idx = position;
+    player->load(app->paths.path(app->playlist[app->play_order[position]]), offset / 1000.0);
+    player->play();
+    highlightCurrentTrack();
 }
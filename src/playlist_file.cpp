@@ -0,0 +1,461 @@
+#include "playlist_file.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TrackInfo PlaylistEntry::toInfo() const {
+    TrackInfo info;
+    info.title.assign(title);
+    info.artist.assign(artist);
+    info.album.assign(album);
+    info.duration = duration;
+    return info;
+}
+
+// --- TEXT HELPERS ---
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+static bool startsWithNoCase(std::string_view s, const char* prefix) {
+    size_t len = std::strlen(prefix);
+    if (s.size() < len) return false;
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != prefix[i]) return false;
+    }
+    return true;
+}
+
+// Next line of [p, end), trimmed; memchr does the scanning (vectorized in libc)
+static bool nextLine(const char*& p, const char* end, std::string_view* line) {
+    if (p >= end) return false;
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    const char* stop = nl ? nl : end;
+    *line = trim(std::string_view(p, stop - p));
+    p = nl ? nl + 1 : end;
+    return true;
+}
+
+// Seconds as written in playlists ("245", "245.3", "-1"); 0 if unknown
+static double parseSeconds(std::string_view s) {
+    s = trim(s);
+    double value = 0.0, scale = 0.0;
+    bool digits = false;
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            digits = true;
+            if (scale == 0.0) {
+                value = value * 10 + (c - '0');
+            } else {
+                value += (c - '0') * scale;
+                scale /= 10;
+            }
+        } else if (c == '.' && scale == 0.0) {
+            scale = 0.1;
+        } else {
+            return 0.0;   // sign, exponent or junk: treat as unknown
+        }
+    }
+    return digits ? value : 0.0;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void appendUtf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xc0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += (char)(0xe0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x110000) {
+        out += (char)(0xf0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3f));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+}
+
+static std::string percentDecode(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        int hi, lo;
+        if (s[i] == '%' && i + 2 < s.size() && (hi = hexValue(s[i + 1])) >= 0 &&
+            (lo = hexValue(s[i + 2])) >= 0) {
+            out += (char)(hi * 16 + lo);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+// The five predefined XML entities and character references
+static std::string entityDecode(std::string_view s) {
+    static const struct { const char* name; char c; } NAMED[] = {
+        {"amp;", '&'}, {"lt;", '<'}, {"gt;", '>'}, {"quot;", '"'}, {"apos;", '\''},
+    };
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] != '&') {
+            out += s[i];
+            continue;
+        }
+        std::string_view rest = s.substr(i + 1);
+        size_t semi = rest.find(';');
+        bool done = false;
+        if (semi != std::string_view::npos && !rest.empty() && rest[0] == '#') {
+            bool hex = rest.size() > 1 && (rest[1] == 'x' || rest[1] == 'X');
+            unsigned cp = 0;
+            bool ok = semi > (hex ? 2u : 1u);
+            for (size_t k = hex ? 2 : 1; ok && k < semi; k++) {
+                int v = hex ? hexValue(rest[k]) : (rest[k] >= '0' && rest[k] <= '9' ? rest[k] - '0' : -1);
+                if (v < 0 || cp > 0x10ffff) ok = false;
+                else cp = cp * (hex ? 16 : 10) + v;
+            }
+            if (ok) {
+                appendUtf8(out, cp);
+                i += semi + 1;
+                done = true;
+            }
+        } else {
+            for (const auto& e : NAMED) {
+                if (rest.compare(0, std::strlen(e.name), e.name) == 0) {
+                    out += e.c;
+                    i += std::strlen(e.name);
+                    done = true;
+                    break;
+                }
+            }
+        }
+        if (!done) out += '&';
+    }
+    return out;
+}
+
+// --- PLAYLIST FILE ---
+PlaylistFile::~PlaylistFile() {
+    if (map) munmap(map, mapSize);
+}
+
+std::string_view PlaylistFile::keep(std::string text) {
+    owned.push_back(std::move(text));
+    return owned.back();
+}
+
+std::string PlaylistFile::resolve(const PlaylistEntry& entry) const {
+    if (!entry.relative) return std::string(entry.location);
+    std::string path;
+    path.reserve(prefix.size() + entry.location.size());
+    path += prefix;
+    path += entry.location;
+    return path;
+}
+
+bool PlaylistFile::setLocation(PlaylistEntry* entry, std::string_view location, bool uri) {
+    if (startsWithNoCase(location, "file://")) {
+        // file:///path or file://host/path
+        location.remove_prefix(7);
+        size_t slash = location.find('/');
+        if (slash == std::string_view::npos) return false;
+        location.remove_prefix(slash);
+        uri = true;
+    } else if (location.find("://") != std::string_view::npos) {
+        entry->location = location;   // stream, handed to GStreamer as is
+        return true;
+    }
+    if (location.empty()) return false;
+    if (uri && location.find('%') != std::string_view::npos) location = keep(percentDecode(location));
+    entry->location = location;
+    entry->relative = location[0] != '/';
+    return true;
+}
+
+bool PlaylistFile::open(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    prefix = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[PLAYLIST] Cannot open " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    mapSize = st.st_size;
+    if (mapSize > 0) {
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;   // read through once anyway: fault it in one go
+#endif
+        map = mmap(NULL, mapSize, PROT_READ, flags, fd, 0);
+        if (map == MAP_FAILED) {
+            map = nullptr;
+            close(fd);
+            std::cerr << "[PLAYLIST] Cannot map " << path << std::endl;
+            return false;
+        }
+        madvise(map, mapSize, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    if (!map) return true;
+
+    cursor = (const char*)map;
+    end = cursor + mapSize;
+    if (mapSize >= 3 && std::memcmp(cursor, "\xef\xbb\xbf", 3) == 0) cursor += 3;   // UTF-8 BOM
+
+    std::string_view name(path);
+    if (slash != std::string::npos) name.remove_prefix(slash + 1);
+    size_t dot = name.rfind('.');
+    std::string_view ext = dot == std::string_view::npos ? std::string_view() : name.substr(dot + 1);
+    std::string_view head = trim(std::string_view(cursor, std::min<size_t>(end - cursor, 64)));
+    if (startsWithNoCase(ext, "pls") && ext.size() == 3) fmt = PLS;
+    else if (startsWithNoCase(ext, "xspf") && ext.size() == 4) fmt = XSPF;
+    else if (startsWithNoCase(ext, "m3u")) fmt = M3U;
+    else if (startsWithNoCase(head, "[playlist]")) fmt = PLS;
+    else if (!head.empty() && head[0] == '<') fmt = XSPF;
+    else fmt = M3U;
+
+    if (fmt == PLS) parsePls();
+    return true;
+}
+
+bool PlaylistFile::next(PlaylistEntry* entry) {
+    switch (fmt) {
+    case M3U: return nextM3u(entry);
+    case XSPF: return nextXspf(entry);
+    case PLS:
+        if (plsNext >= pls.size()) return false;
+        *entry = pls[plsNext++];
+        return true;
+    }
+    return false;
+}
+
+// --- M3U / M3U8 ---
+// #EXTINF:<seconds>[ key="value"...],<Artist - Title> applies to the next
+// location line; other directives and comments are skipped
+bool PlaylistFile::nextM3u(PlaylistEntry* entry) {
+    *entry = PlaylistEntry();
+    std::string_view line;
+    while (nextLine(cursor, end, &line)) {
+        if (line.empty()) continue;
+        if (line[0] != '#') {
+            if (setLocation(entry, line, false)) return true;
+            *entry = PlaylistEntry();
+            continue;
+        }
+        if (!startsWithNoCase(line, "#extinf:")) continue;
+
+        std::string_view info = line.substr(8);
+        // The first comma outside quoted attribute values ends the header
+        size_t comma = std::string_view::npos;
+        bool quoted = false;
+        for (size_t i = 0; i < info.size(); i++) {
+            if (info[i] == '"') quoted = !quoted;
+            else if (info[i] == ',' && !quoted) {
+                comma = i;
+                break;
+            }
+        }
+        std::string_view header = info.substr(0, comma);
+        size_t space = header.find_first_of(" \t");
+        entry->duration = parseSeconds(header.substr(0, space));
+        entry->title = entry->artist = std::string_view();
+        if (comma == std::string_view::npos) continue;
+
+        std::string_view name = trim(info.substr(comma + 1));
+        size_t dash = name.find(" - ");
+        if (dash != std::string_view::npos) {
+            entry->artist = trim(name.substr(0, dash));
+            entry->title = trim(name.substr(dash + 3));
+        } else {
+            entry->title = name;
+        }
+    }
+    return false;
+}
+
+// --- PLS ---
+// FileN=, TitleN=, LengthN= in any order; entries come out sorted by N
+void PlaylistFile::parsePls() {
+    std::vector<std::string_view> files;
+    size_t bound = end - cursor;   // N cannot sensibly exceed the file size
+    std::string_view line;
+    while (nextLine(cursor, end, &line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos) continue;
+        std::string_view key = trim(line.substr(0, eq));
+        std::string_view value = trim(line.substr(eq + 1));
+
+        int field;
+        size_t skip;
+        if (startsWithNoCase(key, "file")) field = 0, skip = 4;
+        else if (startsWithNoCase(key, "title")) field = 1, skip = 5;
+        else if (startsWithNoCase(key, "length")) field = 2, skip = 6;
+        else continue;
+
+        size_t n = 0;
+        if (key.size() == skip) continue;
+        for (size_t i = skip; i < key.size() && n <= bound; i++) {
+            if (key[i] < '0' || key[i] > '9') {
+                n = 0;
+                break;
+            }
+            n = n * 10 + (key[i] - '0');
+        }
+        if (n == 0 || n > bound) continue;
+        if (n > pls.size()) {
+            pls.resize(n);
+            files.resize(n);
+        }
+
+        PlaylistEntry& slot = pls[n - 1];
+        if (field == 0) {
+            files[n - 1] = value;
+        } else if (field == 1) {
+            size_t dash = value.find(" - ");
+            if (dash != std::string_view::npos) {
+                slot.artist = trim(value.substr(0, dash));
+                slot.title = trim(value.substr(dash + 3));
+            } else {
+                slot.title = value;
+            }
+        } else {
+            slot.duration = parseSeconds(value);
+        }
+    }
+
+    // Drop numbers without a usable File line
+    size_t kept = 0;
+    for (size_t i = 0; i < pls.size(); i++) {
+        if (setLocation(&pls[i], files[i], false)) pls[kept++] = pls[i];
+    }
+    pls.resize(kept);
+}
+
+// --- XSPF ---
+// <track> elements of the trackList: location (a URI), title, creator,
+// album, duration (ms). Other elements, attributes and extensions are ignored.
+static const char* findText(const char* p, const char* end, const char* needle) {
+    size_t len = std::strlen(needle);
+    while (p < end) {
+        const char* lt = (const char*)std::memchr(p, needle[0], end - p);
+        if (!lt || (size_t)(end - lt) < len) return nullptr;
+        if (std::memcmp(lt, needle, len) == 0) return lt;
+        p = lt + 1;
+    }
+    return nullptr;
+}
+
+// Text of the element starting at `open` (its '<'), up to the matching
+// close tag within [open, end); entities still encoded. `name` is the tag.
+static bool elementText(const char* open, const char* end, std::string_view name,
+                        std::string_view* text, const char** next) {
+    const char* gt = (const char*)std::memchr(open, '>', end - open);
+    if (!gt) return false;
+    *next = gt + 1;
+    if (gt[-1] == '/') {
+        *text = std::string_view();
+        return true;
+    }
+    for (const char* p = gt + 1; p < end;) {
+        const char* lt = (const char*)std::memchr(p, '<', end - p);
+        if (!lt) return false;
+        p = lt + 1;
+        if (end - p < (ptrdiff_t)name.size() + 2 || *p != '/' ||
+            std::memcmp(p + 1, name.data(), name.size()) != 0 || p[1 + name.size()] != '>') {
+            continue;
+        }
+        std::string_view raw(gt + 1, lt - gt - 1);
+        if (raw.size() >= 12 && raw.substr(0, 9) == "<![CDATA[" && raw.substr(raw.size() - 3) == "]]>") {
+            raw = raw.substr(9, raw.size() - 12);
+        }
+        *text = trim(raw);
+        *next = p + name.size() + 2;
+        return true;
+    }
+    return false;
+}
+
+bool PlaylistFile::nextXspf(PlaylistEntry* entry) {
+    auto text = [this](std::string_view raw) -> std::string_view {
+        if (raw.find('&') == std::string_view::npos) return raw;
+        return keep(entityDecode(raw));
+    };
+
+    while (cursor < end) {
+        const char* track = findText(cursor, end, "<track");
+        if (!track) break;
+        const char* after = track + 6;
+        if (after >= end || (*after != '>' && !isSpace(*after))) {
+            cursor = after;   // <trackList>
+            continue;
+        }
+        const char* close = findText(after, end, "</track>");
+        const char* stop = close ? close : end;
+        cursor = close ? close + 8 : end;
+
+        // One pass over the children
+        *entry = PlaylistEntry();
+        std::string_view location;
+        for (const char* p = (const char*)std::memchr(after, '>', stop - after); p && p < stop;) {
+            const char* lt = (const char*)std::memchr(p, '<', stop - p);
+            if (!lt) break;
+            const char* q = lt + 1;
+            while (q < stop && *q != '>' && *q != '/' && !isSpace(*q)) q++;
+            std::string_view name(lt + 1, q - lt - 1);
+            std::string_view value;
+            const char* next = q;
+            if (name == "location" || name == "title" || name == "creator" ||
+                name == "album" || name == "duration") {
+                if (!elementText(lt, stop, name, &value, &next)) break;
+                if (name == "location") {
+                    if (location.empty()) location = value;
+                } else if (name == "title") {
+                    entry->title = text(value);
+                } else if (name == "creator") {
+                    entry->artist = text(value);
+                } else if (name == "album") {
+                    entry->album = text(value);
+                } else {
+                    entry->duration = parseSeconds(value) / 1000.0;
+                }
+            } else if (!name.empty() && name[0] != '!' && name[0] != '?') {
+                // Skipped whole, so <extension> children do not count
+                if (!elementText(lt, stop, name, &value, &next)) break;
+            }
+            p = next;
+        }
+        if (location.empty() || !setLocation(entry, text(location), true)) continue;
+        return true;
+    }
+    cursor = end;
+    return false;
+}
@@ -0,0 +1,286 @@
+#include "playlist_model.h"
+#include <algorithm>
+#include <cstdio>
+
+struct PlaylistModel {
+    GObject parent;
+    AppState* app;
+    gint stamp;
+    PlaylistMoveCallback onMove;
+    void* moveData;
+    const std::vector<uint32_t>* filter;   // shown rows, or all when NULL
+};
+
+struct PlaylistModelClass {
+    GObjectClass parent_class;
+};
+
+static void playlist_model_tree_model_init(GtkTreeModelIface* iface);
+static void playlist_model_drag_source_init(GtkTreeDragSourceIface* iface);
+static void playlist_model_drag_dest_init(GtkTreeDragDestIface* iface);
+
+G_DEFINE_TYPE_WITH_CODE(PlaylistModel, playlist_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, playlist_model_tree_model_init)
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_DRAG_SOURCE, playlist_model_drag_source_init)
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_DRAG_DEST, playlist_model_drag_dest_init))
+
+#define PLAYLIST_MODEL(obj) ((PlaylistModel*)(obj))
+
+static void playlist_model_init(PlaylistModel* model) {
+    model->app = nullptr;
+    model->stamp = g_random_int();
+    model->onMove = nullptr;
+    model->moveData = nullptr;
+    model->filter = nullptr;
+}
+
+static void playlist_model_class_init(PlaylistModelClass* klass) {
+}
+
+// --- Iterators: user_data is the row number in the view ---
+static size_t iter_index(GtkTreeIter* iter) {
+    return GPOINTER_TO_SIZE(iter->user_data);
+}
+
+static size_t view_size(PlaylistModel* model) {
+    return model->filter ? model->filter->size() : model->app->playlist.size();
+}
+
+static gboolean set_iter(PlaylistModel* model, GtkTreeIter* iter, size_t index) {
+    if (index >= view_size(model)) {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    iter->stamp = model->stamp;
+    iter->user_data = GSIZE_TO_POINTER(index);
+    return TRUE;
+}
+
+static GtkTreeModelFlags get_flags(GtkTreeModel* tree) {
+    return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint get_n_columns(GtkTreeModel* tree) {
+    return PLAYLIST_N_COLUMNS;
+}
+
+static GType get_column_type(GtkTreeModel* tree, gint column) {
+    return G_TYPE_STRING;
+}
+
+static gboolean get_iter(GtkTreeModel* tree, GtkTreeIter* iter, GtkTreePath* path) {
+    if (gtk_tree_path_get_depth(path) != 1) return FALSE;
+    gint index = gtk_tree_path_get_indices(path)[0];
+    if (index < 0) return FALSE;
+    return set_iter(PLAYLIST_MODEL(tree), iter, index);
+}
+
+static GtkTreePath* get_path(GtkTreeModel* tree, GtkTreeIter* iter) {
+    return gtk_tree_path_new_from_indices((gint)iter_index(iter), -1);
+}
+
+static void get_value(GtkTreeModel* tree, GtkTreeIter* iter, gint column, GValue* value) {
+    PlaylistModel* model = PLAYLIST_MODEL(tree);
+    const AppState* app = model->app;
+    size_t row = iter_index(iter);
+    g_value_init(value, G_TYPE_STRING);
+    if (row >= view_size(model)) return;
+    // Filtered rows keep the number they have in the whole playlist
+    if (model->filter) row = (*model->filter)[row];
+    size_t index = app->rows.at(row);
+
+    // Only called for rows being drawn, so nothing is cached
+    const TrackInfo* info = index < app->tracks.size() ? &app->tracks[index] : nullptr;
+    if (column == PLAYLIST_COL_TIME) {
+        if (!info || info->duration <= 0) return;
+        int seconds = (int)info->duration;
+        g_value_take_string(value, g_strdup_printf("%d:%02d", seconds / 60, seconds % 60));
+        return;
+    }
+
+    if (info && !info->title.empty()) {
+        if (info->artist.empty()) {
+            g_value_take_string(value, g_strdup_printf("%zu. %s", row + 1, info->title.c_str()));
+        } else {
+            g_value_take_string(value, g_strdup_printf("%zu. %s - %s", row + 1,
+                                                       info->artist.c_str(), info->title.c_str()));
+        }
+        return;
+    }
+    std::string_view name = app->paths.name(app->playlist[index]);
+    g_value_take_string(value, g_strdup_printf("%zu. %.*s", row + 1, (int)name.size(), name.data()));
+}
+
+static gboolean iter_next(GtkTreeModel* tree, GtkTreeIter* iter) {
+    return set_iter(PLAYLIST_MODEL(tree), iter, iter_index(iter) + 1);
+}
+
+static gboolean iter_previous(GtkTreeModel* tree, GtkTreeIter* iter) {
+    size_t index = iter_index(iter);
+    if (index == 0) {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    return set_iter(PLAYLIST_MODEL(tree), iter, index - 1);
+}
+
+static gboolean iter_children(GtkTreeModel* tree, GtkTreeIter* iter, GtkTreeIter* parent) {
+    if (parent) return FALSE;
+    return set_iter(PLAYLIST_MODEL(tree), iter, 0);
+}
+
+static gboolean iter_has_child(GtkTreeModel* tree, GtkTreeIter* iter) {
+    return FALSE;
+}
+
+static gint iter_n_children(GtkTreeModel* tree, GtkTreeIter* iter) {
+    if (iter) return 0;
+    return (gint)view_size(PLAYLIST_MODEL(tree));
+}
+
+static gboolean iter_nth_child(GtkTreeModel* tree, GtkTreeIter* iter, GtkTreeIter* parent, gint n) {
+    if (parent || n < 0) return FALSE;
+    return set_iter(PLAYLIST_MODEL(tree), iter, n);
+}
+
+static gboolean iter_parent(GtkTreeModel* tree, GtkTreeIter* iter, GtkTreeIter* child) {
+    return FALSE;
+}
+
+static void playlist_model_tree_model_init(GtkTreeModelIface* iface) {
+    iface->get_flags = get_flags;
+    iface->get_n_columns = get_n_columns;
+    iface->get_column_type = get_column_type;
+    iface->get_iter = get_iter;
+    iface->get_path = get_path;
+    iface->get_value = get_value;
+    iface->iter_next = iter_next;
+    iface->iter_previous = iter_previous;
+    iface->iter_children = iter_children;
+    iface->iter_has_child = iter_has_child;
+    iface->iter_n_children = iter_n_children;
+    iface->iter_nth_child = iter_nth_child;
+    iface->iter_parent = iter_parent;
+}
+
+// --- Drag and drop: rows move within the view, nothing crosses models ---
+static gboolean dragged_row(PlaylistModel* model, GtkSelectionData* data, size_t* row) {
+    GtkTreeModel* source = NULL;
+    GtkTreePath* path = NULL;
+    if (!gtk_tree_get_row_drag_data(data, &source, &path)) return FALSE;
+    gboolean ok = source == GTK_TREE_MODEL(model) && gtk_tree_path_get_depth(path) == 1;
+    if (ok) *row = gtk_tree_path_get_indices(path)[0];
+    gtk_tree_path_free(path);
+    return ok;
+}
+
+// Not while filtered: a drop between shown rows has no place in the rest
+static gboolean row_draggable(GtkTreeDragSource* source, GtkTreePath* path) {
+    return PLAYLIST_MODEL(source)->onMove != nullptr && !PLAYLIST_MODEL(source)->filter;
+}
+
+static gboolean drag_data_get(GtkTreeDragSource* source, GtkTreePath* path, GtkSelectionData* data) {
+    return gtk_tree_set_row_drag_data(data, GTK_TREE_MODEL(source), path);
+}
+
+// The drop already moved the row
+static gboolean drag_data_delete(GtkTreeDragSource* source, GtkTreePath* path) {
+    return TRUE;
+}
+
+static gboolean row_drop_possible(GtkTreeDragDest* dest, GtkTreePath* path, GtkSelectionData* data) {
+    size_t row;
+    return gtk_tree_path_get_depth(path) == 1 && !PLAYLIST_MODEL(dest)->filter &&
+           dragged_row(PLAYLIST_MODEL(dest), data, &row);
+}
+
+// `path` is where the row would be inserted with the original still in
+// place, so a drop below it lands one row higher
+static gboolean drag_data_received(GtkTreeDragDest* dest, GtkTreePath* path, GtkSelectionData* data) {
+    PlaylistModel* model = PLAYLIST_MODEL(dest);
+    size_t from;
+    if (!model->onMove || model->filter || gtk_tree_path_get_depth(path) != 1 ||
+        !dragged_row(model, data, &from)) return FALSE;
+    size_t n = model->app->playlist.size();
+    size_t before = std::min((size_t)std::max(gtk_tree_path_get_indices(path)[0], 0), n);
+    size_t to = before > from ? before - 1 : before;
+    if (from >= n || to == from) return TRUE;
+    model->onMove(model->moveData, from, to);
+    return TRUE;
+}
+
+static void playlist_model_drag_source_init(GtkTreeDragSourceIface* iface) {
+    iface->row_draggable = row_draggable;
+    iface->drag_data_get = drag_data_get;
+    iface->drag_data_delete = drag_data_delete;
+}
+
+static void playlist_model_drag_dest_init(GtkTreeDragDestIface* iface) {
+    iface->drag_data_received = drag_data_received;
+    iface->row_drop_possible = row_drop_possible;
+}
+
+// --- Public API ---
+GtkTreeModel* playlist_model_new(AppState* app) {
+    PlaylistModel* model = PLAYLIST_MODEL(g_object_new(playlist_model_get_type(), NULL));
+    model->app = app;
+    return GTK_TREE_MODEL(model);
+}
+
+void playlist_model_set_move_callback(GtkTreeModel* tree, PlaylistMoveCallback cb, void* data) {
+    PlaylistModel* model = PLAYLIST_MODEL(tree);
+    model->onMove = cb;
+    model->moveData = data;
+}
+
+void playlist_model_reset(GtkTreeModel* tree) {
+    PLAYLIST_MODEL(tree)->stamp++;
+}
+
+void playlist_model_set_filter(GtkTreeModel* tree, const std::vector<uint32_t>* rows) {
+    PlaylistModel* model = PLAYLIST_MODEL(tree);
+    model->filter = rows;
+    model->stamp++;
+}
+
+void playlist_model_rows_appended(GtkTreeModel* tree, size_t from) {
+    PlaylistModel* model = PLAYLIST_MODEL(tree);
+    GtkTreeIter iter;
+    for (size_t i = from; i < view_size(model); i++) {
+        set_iter(model, &iter, i);
+        GtkTreePath* path = gtk_tree_path_new_from_indices((gint)i, -1);
+        gtk_tree_model_row_inserted(tree, path, &iter);
+        gtk_tree_path_free(path);
+    }
+}
+
+void playlist_model_rows_deleted(GtkTreeModel* tree, const std::vector<size_t>& rows) {
+    // Highest first, so each path still names the row as the view knows it
+    for (size_t i = rows.size(); i-- > 0;) {
+        GtkTreePath* path = gtk_tree_path_new_from_indices((gint)rows[i], -1);
+        gtk_tree_model_row_deleted(tree, path);
+        gtk_tree_path_free(path);
+    }
+}
+
+// A delete and an insert: the view updates O(log n) of its row tree,
+// where rows-reordered would hand it a whole new order. Rows in between
+// only change their number, which is drawn fresh anyway.
+void playlist_model_row_moved(GtkTreeModel* tree, size_t from, size_t to) {
+    GtkTreePath* path = gtk_tree_path_new_from_indices((gint)from, -1);
+    gtk_tree_model_row_deleted(tree, path);
+    gtk_tree_path_free(path);
+    GtkTreeIter iter;
+    if (!set_iter(PLAYLIST_MODEL(tree), &iter, to)) return;
+    path = gtk_tree_path_new_from_indices((gint)to, -1);
+    gtk_tree_model_row_inserted(tree, path, &iter);
+    gtk_tree_path_free(path);
+}
+
+void playlist_model_row_changed(GtkTreeModel* tree, size_t row) {
+    GtkTreeIter iter;
+    if (!set_iter(PLAYLIST_MODEL(tree), &iter, row)) return;
+    GtkTreePath* path = gtk_tree_path_new_from_indices((gint)row, -1);
+    gtk_tree_model_row_changed(tree, path, &iter);
+    gtk_tree_path_free(path);
+}
@@ -0,0 +1,105 @@
+#include "prefetch.h"
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Prefetcher::Prefetcher() {
+    worker = std::thread(&Prefetcher::run, this);
+}
+
+Prefetcher::~Prefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    ticket++;   // stops a read-ahead in progress
+    wake.notify_one();
+    worker.join();
+}
+
+void Prefetcher::predict(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (path == target) return;
+        target = path;
+        pending = !path.empty() && path != done;
+        ticket++;
+    }
+    wake.notify_one();
+}
+
+void Prefetcher::loaded(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    counts.loads++;
+    if (path == done) counts.hits++;
+    else if (path == target && (working || pending)) counts.partial++;
+}
+
+bool Prefetcher::ready(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path == done;
+}
+
+Prefetcher::Stats Prefetcher::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counts;
+}
+
+void Prefetcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return quit || pending; });
+        if (quit) break;
+        std::string path = target;
+        unsigned mine = ticket;
+        pending = false;
+        working = true;
+        lock.unlock();
+
+        uint64_t bytes = 0;
+        int result = warm(path, mine, &bytes);
+
+        lock.lock();
+        working = false;
+        counts.bytes += bytes;
+        if (result > 0) done = path;
+        else if (result == 0) counts.cancelled++;
+    }
+}
+
+int Prefetcher::warm(const std::string& path, unsigned mine, uint64_t* bytes) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    off_t want = st.st_size <= (off_t)WHOLE_FILE_BYTES ? st.st_size : (off_t)HEAD_BYTES;
+    // Asynchronous hint for the whole range; the loop below makes sure
+    posix_fadvise(fd, 0, want, POSIX_FADV_WILLNEED);
+
+    std::vector<char> scratch;
+    bool read = false;   // readahead() not supported here (some FUSE mounts)
+    int result = 1;
+    for (off_t offset = 0; offset < want;) {
+        if (ticket != mine) {
+            result = 0;
+            break;
+        }
+        size_t chunk = (size_t)std::min<off_t>(CHUNK_BYTES, want - offset);
+        if (!read && readahead(fd, offset, chunk) != 0) read = true;
+        if (read) {
+            scratch.resize(CHUNK_BYTES);
+            ssize_t got = pread(fd, scratch.data(), chunk, offset);
+            if (got <= 0) break;
+            chunk = (size_t)got;
+        }
+        offset += chunk;
+        *bytes += chunk;
+    }
+    close(fd);
+    return result;
+}
@@ -0,0 +1,353 @@
+#include "scanner.h"
+#include "playlist_file.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// --- EXTENSION LOOKUP ---
+// Extensions are packed, lowercased, into one integer and binary-searched
+// in a table sorted once at startup. No allocation, no per-pattern loop.
+static constexpr uint64_t packExt(const char* s) {
+    uint64_t key = 0;
+    for (int i = 0; s[i]; i++) key = (key << 8) | (unsigned char)s[i];
+    return key;
+}
+
+static const uint64_t AUDIO_EXTS[] = {
+    // Tier 1
+    packExt("mp3"), packExt("wav"), packExt("ogg"), packExt("flac"),
+    packExt("m4a"), packExt("aac"), packExt("opus"),
+    // Tier 2
+    packExt("wma"), packExt("ape"), packExt("alac"), packExt("mka"),
+    // Tier 3
+    packExt("mod"), packExt("xm"), packExt("it"), packExt("s3m"),
+    packExt("mid"), packExt("midi"), packExt("dsd"), packExt("dsf"),
+};
+
+static const uint64_t PLAYLIST_EXTS[] = {
+    packExt("m3u"), packExt("m3u8"), packExt("pls"), packExt("xspf"),
+};
+
+struct ExtTable {
+    std::vector<uint64_t> keys;
+    template <size_t N> explicit ExtTable(const uint64_t (&exts)[N]) : keys(exts, exts + N) {
+        std::sort(keys.begin(), keys.end());
+    }
+    bool contains(uint64_t key) const {
+        return key != 0 && std::binary_search(keys.begin(), keys.end(), key);
+    }
+};
+
+static const ExtTable AUDIO_TABLE(AUDIO_EXTS);
+static const ExtTable PLAYLIST_TABLE(PLAYLIST_EXTS);
+
+// Packed lowercase extension of name, 0 if none or longer than 8 bytes
+static uint64_t extKey(const char* name, size_t len) {
+    size_t dot = len;
+    for (size_t i = len; i > 0 && len - i <= 8; i--) {
+        if (name[i - 1] == '.') {
+            dot = i - 1;
+            break;
+        }
+    }
+    if (dot == len || dot + 1 == len) return 0;
+
+    uint64_t key = 0;
+    for (size_t i = dot + 1; i < len; i++) {
+        unsigned char c = name[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        key = (key << 8) | c;
+    }
+    return key;
+}
+
+bool Scanner::isAudioFile(const char* name, size_t len) {
+    return AUDIO_TABLE.contains(extKey(name, len));
+}
+
+bool Scanner::isPlaylistFile(const char* name, size_t len) {
+    return PLAYLIST_TABLE.contains(extKey(name, len));
+}
+
+// --- WALK ---
+namespace {
+
+// One directory (or command-line argument). `files` are handed out once the
+// node is listed; `dirs` are visited after them, in order.
+struct Node {
+    std::string path;
+    std::vector<std::string> files;
+    std::vector<ScanInfo> info;     // playlist metadata, offsets into files
+    std::vector<Node*> dirs;
+    bool listed = false;
+};
+
+struct Walk {
+    std::mutex mutex;
+    std::condition_variable work;      // workers: directories queued, or stop
+    std::condition_variable progress;  // scan(): a directory was listed
+    std::deque<Node*> queue;
+    bool stop = false;
+    std::set<std::pair<dev_t, ino_t>> seen;   // symlink loops
+    size_t dirs = 0;
+};
+
+#ifdef __linux__
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+// Entries of an M3U/M3U8, PLS or XSPF playlist, relative ones resolved
+// against its directory
+void readPlaylist(const std::string& path, Node* node) {
+    PlaylistFile playlist;
+    if (!playlist.open(path)) return;
+    PlaylistEntry entry;
+    while (playlist.next(&entry)) {
+        if (entry.hasInfo()) node->info.push_back({node->files.size(), entry.toInfo()});
+        node->files.push_back(playlist.resolve(entry));
+    }
+}
+
+void freeTree(Node* node) {
+    if (!node) return;
+    for (Node* child : node->dirs) freeTree(child);
+    delete node;
+}
+
+// Lists one directory: sorted audio files into node->files, sorted
+// subdirectory names into subdirs. Runs without the walk lock.
+void listDirectory(Walk* walk, Node* node, std::vector<std::string>& subdirs,
+                   std::vector<char>& buf, const std::atomic<bool>& cancelled) {
+    int fd = open(node->path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        std::lock_guard<std::mutex> lock(walk->mutex);
+        if (!walk->seen.insert({st.st_dev, st.st_ino}).second) {
+            close(fd);
+            return;
+        }
+    }
+
+    std::string prefix = node->path;
+    if (prefix.empty() || prefix.back() != '/') prefix += '/';
+
+    auto entry = [&](const char* name, unsigned char type) {
+        if (name[0] == '.') return;   // ".", ".." and hidden folders/files
+        size_t len = std::strlen(name);
+
+        bool isDir = (type == DT_DIR);
+        bool isReg = (type == DT_REG);
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            // Only where the directory entry does not say; follows symlinks
+            struct stat est;
+            if (fstatat(fd, name, &est, 0) != 0) return;
+            isDir = S_ISDIR(est.st_mode);
+            isReg = S_ISREG(est.st_mode);
+        }
+
+        if (isDir) subdirs.emplace_back(name, len);
+        else if (isReg && Scanner::isAudioFile(name, len)) node->files.emplace_back(prefix + name);
+    };
+
+#ifdef __linux__
+    for (;;) {
+        if (cancelled) break;
+        long n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+        if (n <= 0) break;
+        for (long off = 0; off < n;) {
+            linux_dirent64* d = (linux_dirent64*)(buf.data() + off);
+            off += d->d_reclen;
+            entry(d->d_name, d->d_type);
+        }
+    }
+    close(fd);
+#else
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+    while (struct dirent* d = readdir(dir)) {
+        if (cancelled) break;
+        entry(d->d_name, d->d_type);
+    }
+    closedir(dir);
+#endif
+
+    std::sort(node->files.begin(), node->files.end());
+    std::sort(subdirs.begin(), subdirs.end());
+}
+
+void worker(Walk* walk, const std::atomic<bool>* cancelled) {
+    std::vector<char> buf(64 * 1024);
+    std::vector<std::string> subdirs;
+
+    std::unique_lock<std::mutex> lock(walk->mutex);
+    for (;;) {
+        walk->work.wait(lock, [walk] { return walk->stop || !walk->queue.empty(); });
+        if (walk->stop) return;
+        Node* node = walk->queue.front();
+        walk->queue.pop_front();
+        lock.unlock();
+
+        subdirs.clear();
+        listDirectory(walk, node, subdirs, buf, *cancelled);
+
+        std::string prefix = node->path;
+        if (prefix.back() != '/') prefix += '/';
+        std::vector<Node*> children;
+        children.reserve(subdirs.size());
+        for (const std::string& name : subdirs) {
+            Node* child = new Node;
+            child->path = prefix + name;
+            children.push_back(child);
+        }
+
+        lock.lock();
+        node->dirs = children;
+        node->listed = true;
+        walk->dirs++;
+        for (Node* child : children) walk->queue.push_back(child);
+        if (!children.empty()) walk->work.notify_all();
+        walk->progress.notify_one();
+    }
+}
+
+} // namespace
+
+Scanner::Scanner(unsigned count) : threads(count) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min(threads, MAX_THREADS));
+}
+
+void Scanner::cancel() {
+    cancelled = true;
+}
+
+ScanStats Scanner::scan(const std::vector<std::string>& roots, ScanBatchCallback sink, void* data) {
+    auto start = std::chrono::steady_clock::now();
+    ScanStats stats;
+    cancelled = false;
+
+    // Arguments become the children of a virtual root, in the order given
+    Walk walk;
+    Node* root = new Node;
+    root->listed = true;
+    bool anyDir = false;
+
+    for (const std::string& path : roots) {
+        Node* node = new Node;
+        node->path = path;
+        node->listed = true;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            if (path.find("://") != std::string::npos) node->files.push_back(path);
+            else std::cerr << "[SCANNER] Skipping missing path: " << path << std::endl;
+        } else if (S_ISDIR(st.st_mode)) {
+            node->listed = false;
+            walk.queue.push_back(node);
+            anyDir = true;
+        } else if (isPlaylistFile(path)) {
+            readPlaylist(path, node);
+        } else {
+            // Named explicitly: let GStreamer decide whether it plays
+            node->files.push_back(path);
+        }
+        root->dirs.push_back(node);
+    }
+
+    std::vector<std::thread> pool;
+    if (anyDir) {
+        for (unsigned i = 0; i < threads; i++) pool.emplace_back(worker, &walk, &cancelled);
+    }
+
+    // Depth-first over the tree as it is being listed: hand out everything
+    // up to the first directory that is not listed yet, then wait for it.
+    std::vector<std::pair<Node*, size_t>> stack;
+    stack.push_back({root, 0});
+    std::vector<std::string> batch;
+    std::vector<ScanInfo> info;
+    batch.reserve(BATCH);
+
+    auto flush = [&](std::unique_lock<std::mutex>& lock) {
+        stats.files += batch.size();
+        lock.unlock();
+        sink(data, batch, info);
+        batch.clear();
+        info.clear();
+        lock.lock();
+    };
+
+    std::unique_lock<std::mutex> lock(walk.mutex);
+    while (!stack.empty() && !cancelled) {
+        Node* node = stack.back().first;
+        if (!node->listed) {
+            if (!batch.empty()) {
+                flush(lock);
+                continue;
+            }
+            walk.progress.wait_for(lock, std::chrono::milliseconds(100),
+                                   [&] { return node->listed || cancelled; });
+            continue;
+        }
+
+        size_t& next = stack.back().second;
+        if (next == 0 && !node->files.empty()) {
+            for (ScanInfo& entry : node->info) {
+                entry.offset += batch.size();
+                info.push_back(std::move(entry));
+            }
+            node->info.clear();
+            for (std::string& file : node->files) batch.push_back(std::move(file));
+            node->files.clear();
+            node->files.shrink_to_fit();
+        }
+
+        if (next < node->dirs.size()) {
+            Node* child = node->dirs[next++];
+            stack.push_back({child, 0});
+        } else {
+            stack.pop_back();
+            if (!stack.empty()) stack.back().first->dirs[stack.back().second - 1] = nullptr;
+            delete node;
+        }
+
+        if (batch.size() >= BATCH) flush(lock);
+    }
+    if (!batch.empty() && !cancelled) flush(lock);
+
+    walk.stop = true;
+    stats.dirs = walk.dirs;
+    lock.unlock();
+    walk.work.notify_all();
+    for (std::thread& t : pool) t.join();
+
+    // Cancelled: whatever was not handed out yet
+    if (!stack.empty()) freeTree(root);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,586 @@
+#include "search_index.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+static inline uint8_t fold(uint8_t c) {
+    return (uint8_t)(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+// Terms never hold these, so neither do the grams worth keeping
+static inline bool blank(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// --- Text ---
+std::vector<std::string> SearchIndex::terms(std::string_view query) {
+    std::vector<std::string> out;
+    size_t i = 0;
+    while (i < query.size()) {
+        while (i < query.size() && blank(query[i])) i++;
+        size_t start = i;
+        while (i < query.size() && !blank(query[i])) i++;
+        if (i == start) break;
+        std::string term(query.substr(start, i - start));
+        for (char& c : term) c = fold(c);
+        out.push_back(std::move(term));
+    }
+    return out;
+}
+
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define VECTOR_SEARCH 1
+// 16 bytes as one SSE2/NEON register, through the compiler's generic vectors
+typedef uint8_t Block __attribute__((vector_size(16)));
+
+static inline Block loadBlock(const char* p) {
+    Block b;
+    memcpy(&b, p, sizeof(b));
+    return b;
+}
+
+// Start positions [i, i + 16) where both the first and the last byte of the
+// term match: only there is the middle compared
+static inline Block hitsAt(const char* p, size_t i, Block first, Block last, size_t m) {
+    return (Block)(loadBlock(p + i) == first) & (Block)(loadBlock(p + i + m - 1) == last);
+}
+
+static inline bool none(Block hits) {
+    uint64_t half[2];
+    memcpy(half, &hits, sizeof(half));
+    return !(half[0] | half[1]);
+}
+
+// Hits are 0xff bytes: the lowest set bit of each half is the next one
+static inline int firstMatch(Block hits, const char* p, size_t i, const char* term, size_t m) {
+    uint64_t half[2];
+    memcpy(half, &hits, sizeof(half));
+    for (int h = 0; h < 2; h++) {
+        for (uint64_t bits = half[h]; bits;) {
+            int byte = __builtin_ctzll(bits) / 8;
+            int j = h * 8 + byte;
+            if (m <= 2 || memcmp(p + i + j + 1, term + 1, m - 2) == 0) return j;
+            bits &= ~(0xffULL << (byte * 8));
+        }
+    }
+    return -1;
+}
+#endif
+
+static inline void prefetch(const void* p) {
+#ifdef __GNUC__
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+static inline int lowestBit(uint64_t word) {
+#ifdef __GNUC__
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    for (; !(word & 1); word >>= 1) bit++;
+    return bit;
+#endif
+}
+
+// A term with what the block compares hoisted out of the loops
+struct Needle {
+    const char* term;
+    size_t m;
+#ifdef VECTOR_SEARCH
+    Block first, last;
+#endif
+
+    explicit Needle(std::string_view t) : term(t.data()), m(t.size()) {
+#ifdef VECTOR_SEARCH
+        first = (Block){} + (uint8_t)t[0];
+        last = (Block){} + (uint8_t)t[m - 1];
+#endif
+    }
+};
+
+// Where the (non-empty) term first starts in p[from, size)
+static inline size_t findIn(const char* p, size_t size, size_t from, const Needle& n) {
+    size_t m = n.m;
+    if (from + m > size) return std::string_view::npos;
+    size_t starts = size - m + 1;
+    size_t i = from;
+#ifdef VECTOR_SEARCH
+    if (starts - from >= 16) {
+        // The first block alone: short records are often decided there
+        int j = firstMatch(hitsAt(p, i, n.first, n.last, m), p, i, n.term, m);
+        if (j >= 0) return i + j;
+        // Then four blocks per test while nothing is near
+        for (i += 16; i + 64 <= starts; i += 64) {
+            Block h0 = hitsAt(p, i, n.first, n.last, m);
+            Block h1 = hitsAt(p, i + 16, n.first, n.last, m);
+            Block h2 = hitsAt(p, i + 32, n.first, n.last, m);
+            Block h3 = hitsAt(p, i + 48, n.first, n.last, m);
+            if (none(h0 | h1 | h2 | h3)) continue;
+            if ((j = firstMatch(h0, p, i, n.term, m)) >= 0) return i + j;
+            if ((j = firstMatch(h1, p, i + 16, n.term, m)) >= 0) return i + 16 + j;
+            if ((j = firstMatch(h2, p, i + 32, n.term, m)) >= 0) return i + 32 + j;
+            if ((j = firstMatch(h3, p, i + 48, n.term, m)) >= 0) return i + 48 + j;
+        }
+        for (; i + 16 <= starts; i += 16) {
+            if ((j = firstMatch(hitsAt(p, i, n.first, n.last, m), p, i, n.term, m)) >= 0) return i + j;
+        }
+        // The rest as one block overlapping the last: what it repeats did
+        // not match the first time
+        if (i < starts && (j = firstMatch(hitsAt(p, starts - 16, n.first, n.last, m), p, starts - 16, n.term, m)) >= 0) {
+            return starts - 16 + j;
+        }
+        return std::string_view::npos;
+    }
+#endif
+    for (; i < starts; i++) {
+        if (p[i] == n.term[0] && p[i + m - 1] == n.term[m - 1] && memcmp(p + i + 1, n.term + 1, m < 2 ? 0 : m - 2) == 0) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+size_t SearchIndex::locate(std::string_view text, std::string_view term, size_t from) {
+    if (term.empty()) return from <= text.size() ? from : std::string_view::npos;
+    return findIn(text.data(), text.size(), from, Needle(term));
+}
+
+// --- Records ---
+// Trigrams are 24-bit keys; bytes and bigrams have a tag above their bits
+static const uint32_t UNIGRAM = 2u << 24;
+static const uint32_t BIGRAM = 1u << 24;
+
+static inline uint32_t unigram(uint8_t a) {
+    return UNIGRAM | a;
+}
+
+static inline uint32_t bigram(uint8_t a, uint8_t b) {
+    return BIGRAM | (a << 8) | b;
+}
+
+static inline uint32_t trigram(uint8_t a, uint8_t b, uint8_t c) {
+    return (a << 16) | (b << 8) | c;
+}
+
+// Each byte, bigram and trigram of a folded record that holds no blank
+template <class F>
+static void forEachGram(std::string_view folded, F f) {
+    for (size_t i = 0; i < folded.size(); i++) {
+        uint8_t c = folded[i];
+        if (blank(c)) continue;
+        f(unigram(c));
+        if (i < 1 || blank(folded[i - 1])) continue;
+        f(bigram(folded[i - 1], c));
+        if (i >= 2 && !blank(folded[i - 2])) f(trigram(folded[i - 2], folded[i - 1], c));
+    }
+}
+
+// The list of a term of up to GRAM_BYTES holds exactly its records
+static const size_t GRAM_BYTES = 3;
+
+static inline uint32_t gramOf(const char* p, size_t n) {
+    if (n == 1) return unigram(p[0]);
+    if (n == 2) return bigram(p[0], p[1]);
+    return trigram(p[0], p[1], p[2]);
+}
+
+uint32_t SearchIndex::newRecord(uint32_t id, std::string_view folded) {
+    uint32_t r = entryOf.size();
+    starts.push_back(text.size());
+    lengths.push_back(folded.size());
+    text.append(folded);
+    text += '\n';
+    entryOf.push_back(id);
+    recordOf.push_back(r);
+    loose.push_back(0);
+    return r;
+}
+
+void SearchIndex::set(uint32_t id, std::initializer_list<std::string_view> fields) {
+    scratch.clear();
+    for (std::string_view field : fields) {
+        if (field.empty()) continue;
+        if (!scratch.empty()) scratch += '\n';
+        size_t at = scratch.size();
+        scratch.append(field);
+        for (size_t i = at; i < scratch.size(); i++) scratch[i] = fold(scratch[i]);
+    }
+    // Entries skipped over stay empty
+    while (size() < id) newRecord(size(), std::string_view());
+    if (id == size()) {
+        addGrams(newRecord(id, scratch), scratch, nullptr);
+        return;
+    }
+
+    uint32_t r = recordOf[id];
+    if (record(r) == scratch) return;
+    // Tags mostly repeat the file name: only grams the record did not
+    // have are listed, which also keeps the lists in order
+    seen.clear();
+    forEachGram(record(r), [this](uint32_t key) { seen.push_back(key); });
+    // Text that still starts with the old keeps every gram listed
+    if (scratch.compare(0, lengths[r], record(r)) != 0) loose[r] = 1;
+    std::sort(seen.begin(), seen.end());
+    // Shorter text is written over the old; longer goes at the end
+    if (scratch.size() <= lengths[r]) {
+        garbage += lengths[r] - scratch.size();
+        text.replace(starts[r], scratch.size(), scratch);
+        text[starts[r] + scratch.size()] = '\n';
+    } else {
+        garbage += lengths[r] + 1;
+        starts[r] = text.size();
+        text += scratch;
+        text += '\n';
+        if (r + 1 < entryOf.size()) ordered = false;
+    }
+    lengths[r] = scratch.size();
+    addGrams(r, scratch, &seen);
+    if (garbage > 65536 && garbage * 2 > text.size()) compact();
+}
+
+void SearchIndex::compact() {
+    std::string packed;
+    packed.reserve(text.size() - garbage);
+    for (size_t r = 0; r < entryOf.size(); r++) {
+        uint32_t at = packed.size();
+        if (entryOf[r] != EMPTY) {
+            packed.append(record(r));
+            packed += '\n';
+        }
+        starts[r] = at;
+    }
+    text.swap(packed);
+    garbage = 0;
+    ordered = true;
+}
+
+bool SearchIndex::matches(uint32_t r, const std::vector<std::string>& terms) const {
+    std::string_view fields = record(r);
+    for (const std::string& term : terms) {
+        if (!contains(fields, term)) return false;
+    }
+    return true;
+}
+
+// --- Gram table ---
+static inline uint32_t bucket(uint32_t key, size_t mask) {
+    return (key * 0x9E3779B1U >> 8) & mask;
+}
+
+SearchIndex::Posting* SearchIndex::lookup(uint32_t key) {
+    if (keys.empty()) return nullptr;
+    size_t mask = keys.size() - 1;
+    for (size_t i = bucket(key, mask);; i = (i + 1) & mask) {
+        if (keys[i] == key) return &postings[slots[i]];
+        if (keys[i] == EMPTY) return nullptr;
+    }
+}
+
+SearchIndex::Posting& SearchIndex::insert(uint32_t key) {
+    // Kept at most half full
+    if ((postings.size() + 1) * 2 > keys.size()) grow();
+    size_t mask = keys.size() - 1;
+    size_t i = bucket(key, mask);
+    for (; keys[i] != EMPTY; i = (i + 1) & mask) {
+        if (keys[i] == key) return postings[slots[i]];
+    }
+    keys[i] = key;
+    slots[i] = postings.size();
+    postings.emplace_back();
+    return postings.back();
+}
+
+void SearchIndex::grow() {
+    std::vector<uint32_t> oldKeys = std::move(keys);
+    std::vector<uint32_t> oldSlots = std::move(slots);
+    size_t size = oldKeys.empty() ? 4096 : oldKeys.size() * 2;
+    keys.assign(size, EMPTY);
+    slots.assign(size, 0);
+    size_t mask = size - 1;
+    for (size_t k = 0; k < oldKeys.size(); k++) {
+        if (oldKeys[k] == EMPTY) continue;
+        size_t i = bucket(oldKeys[k], mask);
+        while (keys[i] != EMPTY) i = (i + 1) & mask;
+        keys[i] = oldKeys[k];
+        slots[i] = oldSlots[k];
+    }
+}
+
+// --- Posting lists ---
+static inline void putVarint(std::vector<uint8_t>& bytes, uint32_t v) {
+    while (v >= 0x80) {
+        bytes.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back((uint8_t)v);
+}
+
+static inline uint32_t getVarint(const uint8_t*& p) {
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (b < 0x80) return v;
+    }
+}
+
+void SearchIndex::append(Posting& posting, uint32_t r) {
+    if (posting.count > 0 && r == posting.last) return;
+    uint32_t next = posting.count > 0 ? posting.last + 1 : 0;
+    if (r >= next) {
+        putVarint(posting.bytes, r - next + 1);
+    } else {
+        putVarint(posting.bytes, 0);
+        putVarint(posting.bytes, r);
+        posting.sorted = false;
+    }
+    posting.last = r;
+    posting.count++;
+}
+
+void SearchIndex::decode(const Posting& posting, std::vector<uint32_t>* out) {
+    out->clear();
+    out->reserve(posting.count);
+    const uint8_t* p = posting.bytes.data();
+    const uint8_t* end = p + posting.bytes.size();
+    uint32_t next = 0;
+    while (p < end) {
+        uint32_t gap = getVarint(p);
+        uint32_t r = gap ? next + gap - 1 : getVarint(p);
+        out->push_back(r);
+        next = r + 1;
+    }
+}
+
+void SearchIndex::encode(Posting& posting, const std::vector<uint32_t>& records) {
+    Posting fresh;
+    fresh.bytes.reserve(records.size() + records.size() / 4);
+    for (uint32_t r : records) append(fresh, r);
+    fresh.bytes.shrink_to_fit();
+    posting = std::move(fresh);
+}
+
+void SearchIndex::tidy(Posting& posting) {
+    if (posting.sorted) return;
+    std::vector<uint32_t> records;
+    decode(posting, &records);
+    if (records.size() * 16 < entryOf.size()) {
+        std::sort(records.begin(), records.end());
+        records.erase(std::unique(records.begin(), records.end()), records.end());
+    } else {
+        // Long lists (bytes and bigrams) through a bitmap of all records:
+        // no sort, and repeats fall out
+        std::vector<uint64_t> bits((entryOf.size() + 63) / 64);
+        for (uint32_t r : records) bits[r / 64] |= 1ULL << (r % 64);
+        records.clear();
+        for (size_t w = 0; w < bits.size(); w++) {
+            for (uint64_t word = bits[w]; word; word &= word - 1) records.push_back(w * 64 + lowestBit(word));
+        }
+    }
+    encode(posting, records);
+}
+
+// --- Index ---
+void SearchIndex::addGrams(uint32_t r, std::string_view folded, const std::vector<uint32_t>* skip) {
+    forEachGram(folded, [&](uint32_t key) {
+        if (skip && std::binary_search(skip->begin(), skip->end(), key)) return;
+        append(insert(key), r);
+    });
+}
+
+void SearchIndex::candidates(const std::vector<std::string>& terms, std::vector<uint32_t>* out,
+                             std::vector<std::string>* check) {
+    out->clear();
+    check->clear();
+    struct List {
+        Posting* posting;
+        size_t term;
+    };
+    std::vector<List> lists;
+    bool reading = false;   // records are read for a long term anyway
+    for (size_t t = 0; t < terms.size(); t++) {
+        size_t gram = std::min(terms[t].size(), GRAM_BYTES);
+        if (terms[t].size() > GRAM_BYTES) reading = true;
+        for (size_t i = 0; i + gram <= terms[t].size(); i++) {
+            Posting* posting = lookup(gramOf(terms[t].data() + i, gram));
+            // A gram nobody has: nothing can match
+            if (!posting) return;
+            lists.push_back({posting, t});
+        }
+    }
+
+    // Rarest first. A list is merged in while it is cheaper to decode than
+    // the candidates it could rule out are to check: not when it is long
+    // next to them, or holds most records. A short term's list always is
+    // when nothing else would read the records, since then it is the whole
+    // check.
+    std::sort(lists.begin(), lists.end(), [](const List& a, const List& b) {
+        return a.posting->count != b.posting->count ? a.posting->count < b.posting->count : a.posting < b.posting;
+    });
+    std::vector<uint8_t> whole(terms.size(), 0);   // the term needs no check
+    std::vector<uint32_t> other, both;
+    size_t merged = 0;
+    Posting* last = nullptr;
+    for (const List& list : lists) {
+        bool exact = terms[list.term].size() <= GRAM_BYTES;
+        if (list.posting == last) {
+            whole[list.term] |= exact;
+            continue;
+        }
+        if (merged > 0) {
+            bool cheap = list.posting->count <= out->size() * 16 && list.posting->count * 2 <= entryOf.size();
+            if (exact ? reading && !cheap : merged >= 4 || !cheap) continue;
+        }
+        tidy(*list.posting);
+        if (merged == 0) {
+            decode(*list.posting, out);
+        } else {
+            decode(*list.posting, &other);
+            both.clear();
+            std::set_intersection(out->begin(), out->end(), other.begin(), other.end(), std::back_inserter(both));
+            out->swap(both);
+        }
+        whole[list.term] |= exact;
+        last = list.posting;
+        merged++;
+        if (out->empty()) return;
+    }
+    for (size_t t = 0; t < terms.size(); t++) {
+        if (!whole[t]) check->push_back(terms[t]);
+    }
+}
+
+void SearchIndex::scan(const std::vector<std::string>& terms, const std::vector<std::string>& check,
+                       const std::vector<uint32_t>& pool, std::vector<uint32_t>* out) const {
+    size_t longest = 0;
+    for (size_t t = 1; t < check.size(); t++) {
+        if (check[t].size() > check[longest].size()) longest = t;
+    }
+    Needle needle(check[longest]);
+    size_t m = check[longest].size();
+    size_t n = entryOf.size();
+    size_t r = 0, k = 0;
+    size_t at = n ? starts[0] : text.size();
+    while ((at = findIn(text.data(), text.size(), at, needle)) != std::string_view::npos) {
+        while (r + 1 < n && starts[r + 1] <= at) r++;
+        // Past the end of the record: in bytes a shorter rewrite freed
+        if (entryOf[r] != EMPTY && at >= starts[r] && at + m <= starts[r] + lengths[r]) {
+            while (k < pool.size() && pool[k] < r) k++;
+            if (k == pool.size()) break;
+            if (pool[k] == r && matches(r, loose[r] ? terms : check)) out->push_back(entryOf[r]);
+        }
+        if (++r >= n) break;
+        at = starts[r];
+    }
+}
+
+void SearchIndex::search(const std::vector<std::string>& terms, const std::vector<uint32_t>* within,
+                         std::vector<uint32_t>* out) {
+    out->clear();
+    if (terms.empty()) {
+        for (uint32_t id = 0; id < size(); id++) out->push_back(id);
+        return;
+    }
+    std::vector<uint32_t> pool;
+    std::vector<std::string> check;
+    candidates(terms, &pool, &check);
+    if (check.empty()) {
+        for (uint32_t r : pool) {
+            if (entryOf[r] != EMPTY && (!loose[r] || matches(r, terms))) out->push_back(entryOf[r]);
+        }
+        return;
+    }
+    if (within && within->size() < pool.size()) {
+        // Entries and records are in the same order
+        std::vector<uint32_t> inside, both;
+        for (uint32_t id : *within) {
+            if (id < size()) inside.push_back(recordOf[id]);
+        }
+        std::set_intersection(pool.begin(), pool.end(), inside.begin(), inside.end(), std::back_inserter(both));
+        pool.swap(both);
+    }
+    // Records are read in order from here: the arena should be too
+    if (!ordered) compact();
+    // Most of the records: one pass over the arena costs less than a call
+    // per record
+    if (pool.size() * 2 > size()) {
+        scan(terms, check, pool, out);
+        return;
+    }
+    for (size_t k = 0; k < pool.size(); k++) {
+        // The text a few records on is fetched while this one is checked
+        if (k + 8 < pool.size()) prefetch(text.data() + starts[pool[k + 8]]);
+        uint32_t r = pool[k];
+        if (entryOf[r] != EMPTY && matches(r, loose[r] ? terms : check)) out->push_back(entryOf[r]);
+    }
+}
+
+void SearchIndex::erase(const std::vector<size_t>& ids) {
+    if (ids.empty()) return;
+    size_t n = size();
+    size_t removed = 0;
+    for (size_t id = 0; id < n; id++) {
+        uint32_t r = recordOf[id];
+        if (removed < ids.size() && ids[removed] == id) {
+            entryOf[r] = EMPTY;
+            garbage += lengths[r] + 1;
+            lengths[r] = 0;
+            dead++;
+            removed++;
+        } else {
+            recordOf[id - removed] = r;
+            entryOf[r] = id - removed;
+        }
+    }
+    recordOf.resize(n - removed);
+    if (dead * 2 > entryOf.size()) rebuild();
+}
+
+void SearchIndex::rebuild() {
+    std::string old;
+    old.swap(text);
+    std::vector<uint32_t> oldStarts, oldLengths, oldRecords;
+    oldStarts.swap(starts);
+    oldLengths.swap(lengths);
+    oldRecords.swap(recordOf);
+    entryOf.clear();
+    loose.clear();
+    std::vector<uint32_t>().swap(keys);
+    std::vector<uint32_t>().swap(slots);
+    std::vector<Posting>().swap(postings);
+    garbage = 0;
+    dead = 0;
+    ordered = true;
+    for (size_t id = 0; id < oldRecords.size(); id++) {
+        uint32_t r = oldRecords[id];
+        std::string_view folded(old.data() + oldStarts[r], oldLengths[r]);
+        addGrams(newRecord(id, folded), folded, nullptr);
+    }
+}
+
+void SearchIndex::clear() {
+    std::string().swap(text);
+    std::vector<uint32_t>().swap(starts);
+    std::vector<uint32_t>().swap(lengths);
+    std::vector<uint32_t>().swap(entryOf);
+    std::vector<uint32_t>().swap(recordOf);
+    std::vector<uint8_t>().swap(loose);
+    garbage = 0;
+    dead = 0;
+    ordered = true;
+    std::vector<uint32_t>().swap(keys);
+    std::vector<uint32_t>().swap(slots);
+    std::vector<Posting>().swap(postings);
+}
+
+size_t SearchIndex::memoryBytes() const {
+    size_t bytes = text.capacity() +
+                   (starts.capacity() + lengths.capacity() + entryOf.capacity() + recordOf.capacity()) * sizeof(uint32_t) +
+                   loose.capacity() +
+                   (keys.capacity() + slots.capacity()) * sizeof(uint32_t) + postings.capacity() * sizeof(Posting);
+    for (const Posting& posting : postings) bytes += posting.bytes.capacity();
+    return bytes;
+}
@@ -0,0 +1,105 @@
+#include "spectrum.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// Display range and motion, in normalized bar heights per frame
+const float FLOOR_DB = -60.0f;
+const float FALLOFF = 0.05f;
+const float PEAK_FALL = 0.015f;
+const int PEAK_HOLD_FRAMES = 15;
+const float MIN_HZ = 40.0f;
+const float MAX_HZ = 16000.0f;
+
+Spectrum::Spectrum(FrameCallback cb, void* data)
+    : fft(FFT_SIZE), history(FFT_SIZE, 0.0f), mags(FFT_SIZE / 2, 0.0f), onFrame(cb), frameData(data) {
+    worker = std::thread(&Spectrum::run, this);
+}
+
+Spectrum::~Spectrum() {
+    {
+        // Under the lock so the worker cannot miss it between check and wait
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        running = false;
+    }
+    wake.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+void Spectrum::push(const float* samples, size_t count, int sampleRate) {
+    rate.store(sampleRate, std::memory_order_relaxed);
+    pcm.pushBulk(samples, count);
+    wake.notify_one();
+}
+
+bool Spectrum::latest(SpectrumFrame* out) {
+    bool got = false;
+    while (frames.pop(*out)) got = true;
+    return got;
+}
+
+void Spectrum::run() {
+    float chunk[512];
+    size_t since = 0;
+
+    while (running) {
+        size_t got = pcm.popBulk(chunk, 512);
+        if (got == 0) {
+            // Sleep until audio arrives: no wakeups while paused or stopped.
+            // The producer never takes the lock, so a notify can slip past
+            // the check; the next buffer (a few ms later) wakes us anyway.
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [this] { return !running || pcm.size() > 0; });
+            continue;
+        }
+
+        // Slide the analysis window
+        std::memmove(history.data(), history.data() + got, (FFT_SIZE - got) * sizeof(float));
+        std::memcpy(history.data() + FFT_SIZE - got, chunk, got * sizeof(float));
+
+        since += got;
+        size_t hop = (size_t)rate.load(std::memory_order_relaxed) / FRAME_RATE;
+        if (since >= hop) {
+            since = 0;
+            analyze();
+        }
+    }
+}
+
+void Spectrum::analyze() {
+    fft.magnitudes(history.data(), mags.data());
+
+    const float sampleRate = (float)rate.load(std::memory_order_relaxed);
+    const float binHz = sampleRate / FFT_SIZE;
+    const float top = std::min(MAX_HZ, sampleRate / 2.0f);
+    const size_t bins = FFT_SIZE / 2;
+    // A full-scale sine peaks at N/4 after the Hann window
+    const float ref = FFT_SIZE / 4.0f;
+
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        float lo = MIN_HZ * std::pow(top / MIN_HZ, (float)b / SPECTRUM_BANDS);
+        float hi = MIN_HZ * std::pow(top / MIN_HZ, (float)(b + 1) / SPECTRUM_BANDS);
+        size_t kLo = std::min(bins - 1, (size_t)(lo / binHz));
+        size_t kHi = std::min(bins, std::max(kLo + 1, (size_t)std::ceil(hi / binHz)));
+
+        float mag = 0.0f;
+        for (size_t k = kLo; k < kHi; k++) mag = std::max(mag, mags[k]);
+
+        float db = 20.0f * std::log10(mag / ref + 1e-9f);
+        float v = std::clamp((db - FLOOR_DB) / -FLOOR_DB, 0.0f, 1.0f);
+
+        state.level[b] = std::max(v, state.level[b] - FALLOFF);
+
+        if (state.level[b] >= state.peak[b]) {
+            state.peak[b] = state.level[b];
+            hold[b] = PEAK_HOLD_FRAMES;
+        } else if (hold[b] > 0) {
+            hold[b]--;
+        } else {
+            state.peak[b] = std::max(0.0f, state.peak[b] - PEAK_FALL);
+        }
+    }
+
+    frames.push(state);
+    if (onFrame) onFrame(frameData);
+}
@@ -0,0 +1,821 @@
+#include "tags.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// First mapping of every file; grown on demand when a tag block says it is
+// bigger (cover art in ID3v2 or FLAC PICTURE). Untouched pages never load.
+static const size_t HEAD_SIZE = 256 * 1024;
+// Ogg comment packets are reassembled up to this size (embedded cover art
+// can make them megabytes; the text fields come first)
+static const size_t OGG_HEAD_SIZE = 1024 * 1024;
+static const size_t OGG_TAIL_SIZE = 64 * 1024;
+static const uint64_t MAX_MOOV = 32 * 1024 * 1024;
+// How far past the ID3v2 tag to look for the first MPEG frame
+static const size_t MPEG_SYNC_WINDOW = 64 * 1024;
+
+// --- BYTE HELPERS ---
+static inline uint32_t be16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static inline uint32_t be24(const uint8_t* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+static inline uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+static inline uint64_t be64(const uint8_t* p) { return ((uint64_t)be32(p) << 32) | be32(p + 4); }
+static inline uint32_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static inline uint32_t le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline uint64_t le64(const uint8_t* p) { return le32(p) | ((uint64_t)le32(p + 4) << 32); }
+static inline uint32_t syncsafe(const uint8_t* p) {
+    return ((p[0] & 0x7f) << 21) | ((p[1] & 0x7f) << 14) | ((p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+static std::string_view trim(const uint8_t* p, size_t n) {
+    while (n > 0 && (p[n - 1] == 0 || p[n - 1] == ' ')) n--;
+    return std::string_view((const char*)p, n);
+}
+
+static bool equalsNoCase(const uint8_t* p, size_t n, const char* key) {
+    size_t len = std::strlen(key);
+    if (n != len) return false;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = p[i];
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if (c != (unsigned char)key[i]) return false;
+    }
+    return true;
+}
+
+static void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xc0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += (char)(0xe0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    } else {
+        out += (char)(0xf0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3f));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+}
+
+static FileStamp stampOf(const struct stat& st) {
+    FileStamp stamp;
+    stamp.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.size = st.st_size;
+    return stamp;
+}
+
+// FNV-1a over the first 4 KiB, seeded with the size
+static uint64_t headHash(const uint8_t* p, size_t n, uint64_t size) {
+    uint64_t h = 14695981039346656037ull ^ size;
+    n = std::min<size_t>(n, 4096);
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+TrackInfo TagView::toInfo() const {
+    TrackInfo info;
+    info.title.assign(title);
+    info.artist.assign(artist);
+    info.album.assign(album);
+    info.duration = duration;
+    return info;
+}
+
+// --- MAPPING ---
+TagReader::~TagReader() {
+    release();
+}
+
+void TagReader::release() {
+    for (const Mapping& m : mappings) munmap(m.base, m.length);
+    mappings.clear();
+    owned.clear();
+    if (fd >= 0) close(fd);
+    fd = -1;
+    file_size = 0;
+}
+
+TagReader::Span TagReader::map(uint64_t offset, size_t length) {
+    static const uint64_t page = sysconf(_SC_PAGESIZE);
+    if (offset >= file_size || length == 0) return Span();
+    length = (size_t)std::min<uint64_t>(length, file_size - offset);
+
+    uint64_t start = offset & ~(page - 1);
+    size_t span = length + (size_t)(offset - start);
+    void* base = mmap(NULL, span, PROT_READ, MAP_PRIVATE, fd, (off_t)start);
+    if (base == MAP_FAILED) return Span();
+    mappings.push_back({base, span});
+
+    Span s;
+    s.data = (const uint8_t*)base + (offset - start);
+    s.size = length;
+    return s;
+}
+
+// Remaps the head so that [0, end) is covered, when the file has it
+void TagReader::ensure(Span& head, size_t end) {
+    if (end <= head.size || head.size >= file_size) return;
+    Span bigger = map(0, end);
+    if (bigger.data) head = bigger;
+}
+
+std::string_view TagReader::keep(std::string text) {
+    owned.push_back(std::move(text));
+    return owned.back();
+}
+
+std::string_view TagReader::latin1(const uint8_t* p, size_t n) {
+    std::string_view view = trim(p, n);
+    bool ascii = std::all_of(view.begin(), view.end(), [](char c) { return (unsigned char)c < 0x80; });
+    if (ascii) return view;
+
+    std::string out;
+    out.reserve(view.size() * 2);
+    for (char c : view) appendUtf8(out, (unsigned char)c);
+    return keep(std::move(out));
+}
+
+// ID3v2 text encodings: 0 Latin-1, 1 UTF-16 with BOM, 2 UTF-16BE, 3 UTF-8.
+// Multi-value frames are NUL-separated; the first value is used.
+std::string_view TagReader::text(const uint8_t* p, size_t n, int encoding) {
+    if (encoding == 0 || encoding == 3) {
+        const uint8_t* nul = (const uint8_t*)std::memchr(p, 0, n);
+        if (nul) n = nul - p;
+        return encoding == 0 ? latin1(p, n) : trim(p, n);
+    }
+    if (encoding != 1 && encoding != 2) return std::string_view();
+
+    bool big = (encoding == 2);
+    if (encoding == 1 && n >= 2) {
+        if (p[0] == 0xff && p[1] == 0xfe) { big = false; p += 2; n -= 2; }
+        else if (p[0] == 0xfe && p[1] == 0xff) { big = true; p += 2; n -= 2; }
+    }
+
+    std::string out;
+    out.reserve(n);
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        uint32_t unit = big ? be16(p + i) : le16(p + i);
+        if (unit == 0) break;
+        if (unit >= 0xd800 && unit < 0xdc00 && i + 3 < n) {
+            uint32_t low = big ? be16(p + i + 2) : le16(p + i + 2);
+            if (low >= 0xdc00 && low < 0xe000) {
+                unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                i += 2;
+            }
+        }
+        appendUtf8(out, unit);
+    }
+    while (!out.empty() && out.back() == ' ') out.pop_back();
+    return keep(std::move(out));
+}
+
+// --- ENTRY POINT ---
+bool TagReader::read(const std::string& path, TagView* out) {
+    release();
+    *out = TagView();
+
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        release();
+        return false;
+    }
+    file_size = st.st_size;
+    out->stamp = stampOf(st);
+
+    Span head = map(0, HEAD_SIZE);
+    if (head.size < 12) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    out->stamp.hash = headHash(head.data, head.size, file_size);
+
+    bool ok = true;
+    const uint8_t* p = head.data;
+    if (std::memcmp(p, "ID3", 3) == 0) {
+        size_t offset = parseId3v2(head, out);
+        // FLAC files sometimes carry a leading ID3v2 tag
+        if (offset + 4 <= head.size && std::memcmp(head.data + offset, "fLaC", 4) == 0) {
+            TagView id3 = *out;
+            ok = parseFlac(head, offset, out);
+            if (out->title.empty()) out->title = id3.title;
+            if (out->artist.empty()) out->artist = id3.artist;
+            if (out->album.empty()) out->album = id3.album;
+        } else {
+            bool v1 = false;
+            parseId3v1(out, &v1);
+            parseMpeg(head, offset, v1, out);
+        }
+    } else if (std::memcmp(p, "fLaC", 4) == 0) {
+        ok = parseFlac(head, 0, out);
+    } else if (std::memcmp(p, "OggS", 4) == 0) {
+        ok = parseOgg(out);
+    } else if (std::memcmp(p + 4, "ftyp", 4) == 0) {
+        ok = parseMp4(out);
+    } else if (std::memcmp(p, "RIFF", 4) == 0 && std::memcmp(p + 8, "WAVE", 4) == 0) {
+        ok = parseWav(head, out);
+    } else if (p[0] == 0xff && (p[1] & 0xe0) == 0xe0) {
+        bool v1 = false;
+        parseId3v1(out, &v1);
+        parseMpeg(head, 0, v1, out);
+    } else {
+        ok = false;
+    }
+
+    // Mappings outlive the descriptor
+    close(fd);
+    fd = -1;
+    return ok;
+}
+
+// --- ID3 ---
+// Returns the offset just past the tag (and its footer)
+size_t TagReader::parseId3v2(Span& head, TagView* out) {
+    const uint8_t* h = head.data;
+    int major = h[3];
+    int flags = h[5];
+    size_t size = syncsafe(h + 6);
+    size_t end = 10 + size + ((flags & 0x10) ? 10 : 0);
+    if (major < 2 || major > 4) return end;
+
+    ensure(head, end + MPEG_SYNC_WINDOW);
+    if (head.size < 10 + size) size = head.size - 10;
+
+    const uint8_t* tag = head.data + 10;
+    // v2.2/v2.3 unsynchronise the whole tag: undo it into owned storage
+    if ((flags & 0x80) && major < 4) {
+        std::string plain;
+        plain.reserve(size);
+        for (size_t i = 0; i < size; i++) {
+            plain += (char)tag[i];
+            if (tag[i] == 0xff && i + 1 < size && tag[i + 1] == 0) i++;
+        }
+        std::string_view kept = keep(std::move(plain));
+        tag = (const uint8_t*)kept.data();
+        size = kept.size();
+    }
+
+    size_t pos = 0;
+    if ((flags & 0x40) && major >= 3 && size >= 4) {
+        pos = (major == 3) ? 4 + be32(tag) : syncsafe(tag);
+    }
+
+    const size_t idLen = (major == 2) ? 3 : 4;
+    const size_t frameHeader = (major == 2) ? 6 : 10;
+    while (pos + frameHeader <= size) {
+        const uint8_t* f = tag + pos;
+        if (f[0] == 0) break;   // padding
+        size_t len = (major == 2) ? be24(f + 3) : (major == 3) ? be32(f + 4) : syncsafe(f + 4);
+        if (len > size - pos - frameHeader) break;
+
+        const uint8_t* body = f + frameHeader;
+        size_t bodyLen = len;
+        pos += frameHeader + len;
+        if (f[0] != 'T' || bodyLen < 2) continue;
+
+        std::string_view* field = nullptr;
+        if (idLen == 3) {
+            if (std::memcmp(f, "TT2", 3) == 0) field = &out->title;
+            else if (std::memcmp(f, "TP1", 3) == 0) field = &out->artist;
+            else if (std::memcmp(f, "TAL", 3) == 0) field = &out->album;
+            else if (std::memcmp(f, "TP2", 3) == 0 && out->artist.empty()) field = &out->artist;
+        } else {
+            if (std::memcmp(f, "TIT2", 4) == 0) field = &out->title;
+            else if (std::memcmp(f, "TPE1", 4) == 0) field = &out->artist;
+            else if (std::memcmp(f, "TALB", 4) == 0) field = &out->album;
+            else if (std::memcmp(f, "TPE2", 4) == 0 && out->artist.empty()) field = &out->artist;
+        }
+        if (!field) continue;
+
+        if (major == 3) {
+            if (f[9] & 0xc0) continue;            // compressed or encrypted
+            if (f[9] & 0x20) { body++; bodyLen--; }   // grouping id
+        } else if (major == 4) {
+            if (f[9] & 0x0c) continue;            // compressed or encrypted
+            if (f[9] & 0x40) { body++; bodyLen--; }
+            if (f[9] & 0x01) {                    // data length indicator
+                if (bodyLen < 5) continue;
+                body += 4;
+                bodyLen -= 4;
+            }
+            if (f[9] & 0x02) {
+                std::string plain;
+                plain.reserve(bodyLen);
+                for (size_t i = 0; i < bodyLen; i++) {
+                    plain += (char)body[i];
+                    if (body[i] == 0xff && i + 1 < bodyLen && body[i + 1] == 0) i++;
+                }
+                std::string_view kept = keep(std::move(plain));
+                body = (const uint8_t*)kept.data();
+                bodyLen = kept.size();
+            }
+        }
+        if (bodyLen < 2) continue;
+
+        std::string_view value = text(body + 1, bodyLen - 1, body[0]);
+        if (!value.empty()) *field = value;
+    }
+    return end;
+}
+
+// Fills whatever ID3v2 left empty from the 128-byte trailer
+void TagReader::parseId3v1(TagView* out, bool* present) {
+    *present = false;
+    if (file_size < 128 + 4) return;
+    Span tail = map(file_size - 128, 128);
+    if (tail.size != 128 || std::memcmp(tail.data, "TAG", 3) != 0) return;
+    *present = true;
+
+    const uint8_t* t = tail.data;
+    auto field = [&](const uint8_t* p, std::string_view* dst) {
+        if (!dst->empty()) return;
+        const uint8_t* nul = (const uint8_t*)std::memchr(p, 0, 30);
+        *dst = latin1(p, nul ? (size_t)(nul - p) : 30);
+    };
+    field(t + 3, &out->title);
+    field(t + 33, &out->artist);
+    field(t + 63, &out->album);
+}
+
+// --- MPEG AUDIO ---
+namespace {
+
+struct MpegHeader {
+    int version;      // 1, 2 or 25 (MPEG 2.5)
+    int layer;        // 1..3
+    int bitrate;      // kbit/s
+    int rate;         // Hz
+    bool mono;
+    int samples;      // per frame
+    size_t length;    // bytes
+};
+
+bool parseMpegHeader(const uint8_t* p, MpegHeader* h) {
+    static const int BITRATES[2][3][15] = {
+        {   // MPEG 1: layer I, II, III
+            {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+            {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        },
+        {   // MPEG 2 / 2.5
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        },
+    };
+    static const int RATES[3] = {44100, 48000, 32000};
+
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0) return false;
+    int v = (p[1] >> 3) & 3;
+    int l = (p[1] >> 1) & 3;
+    int b = p[2] >> 4;
+    int r = (p[2] >> 2) & 3;
+    if (v == 1 || l == 0 || b == 0 || b == 15 || r == 3) return false;
+
+    h->version = (v == 3) ? 1 : (v == 2) ? 2 : 25;
+    h->layer = 4 - l;
+    h->bitrate = BITRATES[h->version == 1 ? 0 : 1][h->layer - 1][b];
+    h->rate = RATES[r] >> (h->version == 1 ? 0 : h->version == 2 ? 1 : 2);
+    h->mono = (p[3] >> 6) == 3;
+
+    int padding = (p[2] >> 1) & 1;
+    if (h->layer == 1) {
+        h->samples = 384;
+        h->length = (12 * h->bitrate * 1000 / h->rate + padding) * 4;
+    } else {
+        h->samples = (h->layer == 3 && h->version != 1) ? 576 : 1152;
+        h->length = h->samples / 8 * h->bitrate * 1000 / h->rate + padding;
+    }
+    return h->length >= 4;
+}
+
+} // namespace
+
+// Duration from a Xing/Info or VBRI frame count, else from the bitrate
+void TagReader::parseMpeg(Span& head, size_t offset, bool id3v1, TagView* out) {
+    size_t limit = std::min(head.size, offset + MPEG_SYNC_WINDOW);
+    MpegHeader h;
+    size_t pos = offset;
+    for (; pos + 4 <= limit; pos++) {
+        if (head.data[pos] != 0xff) continue;
+        if (!parseMpegHeader(head.data + pos, &h)) continue;
+        // A second header where the first frame ends rules out stray 0xFF bytes
+        size_t next = pos + h.length;
+        MpegHeader h2;
+        if (next + 4 <= head.size && !parseMpegHeader(head.data + next, &h2)) continue;
+        break;
+    }
+    if (pos + 4 > limit) return;
+
+    const uint8_t* frame = head.data + pos;
+    size_t avail = head.size - pos;
+    uint64_t frames = 0;
+
+    size_t side = (h.version == 1) ? (h.mono ? 17 : 32) : (h.mono ? 9 : 17);
+    size_t xing = 4 + side;
+    if (xing + 12 <= avail &&
+        (std::memcmp(frame + xing, "Xing", 4) == 0 || std::memcmp(frame + xing, "Info", 4) == 0)) {
+        if (be32(frame + xing + 4) & 1) frames = be32(frame + xing + 8);
+    } else if (36 + 18 <= avail && std::memcmp(frame + 36, "VBRI", 4) == 0) {
+        frames = be32(frame + 36 + 14);
+    }
+
+    if (frames > 0) {
+        out->duration = (double)frames * h.samples / h.rate;
+    } else {
+        uint64_t tail = id3v1 ? 128 : 0;
+        uint64_t audio = pos + tail < file_size ? file_size - pos - tail : 0;
+        out->duration = audio * 8.0 / (h.bitrate * 1000.0);
+    }
+}
+
+// --- FLAC ---
+bool TagReader::parseFlac(Span& head, size_t offset, TagView* out) {
+    size_t pos = offset + 4;
+    for (;;) {
+        ensure(head, pos + 4);
+        if (pos + 4 > head.size) break;
+        const uint8_t* b = head.data + pos;
+        bool last = b[0] & 0x80;
+        int type = b[0] & 0x7f;
+        size_t len = be24(b + 1);
+        size_t body = pos + 4;
+
+        if (type == 0 || type == 4) {
+            ensure(head, body + len);
+            if (body + len > head.size) break;
+            const uint8_t* p = head.data + body;
+            if (type == 0 && len >= 18) {
+                uint32_t rate = (p[10] << 12) | (p[11] << 4) | (p[12] >> 4);
+                uint64_t samples = ((uint64_t)(p[13] & 0x0f) << 32) | be32(p + 14);
+                if (rate > 0) out->duration = (double)samples / rate;
+            } else if (type == 4) {
+                parseVorbisComments(p, len, out);
+            }
+        }
+        // PICTURE, SEEKTABLE, PADDING: skipped without touching their pages
+        pos = body + len;
+        if (last) break;
+    }
+    return true;
+}
+
+void TagReader::parseVorbisComments(const uint8_t* p, size_t n, TagView* out) {
+    if (n < 8) return;
+    size_t vendor = le32(p);
+    if (vendor > n - 8) return;
+    size_t pos = 4 + vendor;
+    uint32_t count = le32(p + pos);
+    pos += 4;
+
+    for (uint32_t i = 0; i < count && pos + 4 <= n; i++) {
+        size_t len = le32(p + pos);
+        pos += 4;
+        if (len > n - pos) break;   // truncated (Ogg cap) or corrupt
+        const uint8_t* c = p + pos;
+        pos += len;
+
+        const uint8_t* eq = (const uint8_t*)std::memchr(c, '=', len);
+        if (!eq) continue;
+        size_t keyLen = eq - c;
+        std::string_view value((const char*)eq + 1, len - keyLen - 1);
+        if (value.empty()) continue;
+
+        if (equalsNoCase(c, keyLen, "TITLE") && out->title.empty()) out->title = value;
+        else if (equalsNoCase(c, keyLen, "ARTIST") && out->artist.empty()) out->artist = value;
+        else if (equalsNoCase(c, keyLen, "ALBUM") && out->album.empty()) out->album = value;
+        else if (equalsNoCase(c, keyLen, "ALBUMARTIST") && out->artist.empty()) out->artist = value;
+    }
+}
+
+// --- OGG ---
+// Walks pages from the start, reassembling only the identification and
+// comment packets; duration comes from the last page's granule position.
+bool TagReader::parseOgg(TagView* out) {
+    Span head = map(0, OGG_HEAD_SIZE);
+    uint32_t serial = le32(head.data + 14);
+    uint32_t rate = 0;
+    uint64_t preskip = 0;
+
+    int packet = 0;
+    std::string* spill = nullptr;   // packet continued across pages
+    size_t pos = 0;
+    while (packet < 2 && pos + 27 <= head.size) {
+        const uint8_t* page = head.data + pos;
+        if (std::memcmp(page, "OggS", 4) != 0) break;
+        size_t segments = page[26];
+        size_t body = pos + 27 + segments;
+        if (body > head.size) break;
+        if (le32(page + 14) != serial) {   // other logical stream
+            size_t skip = 0;
+            for (size_t s = 0; s < segments; s++) skip += page[27 + s];
+            pos = body + skip;
+            continue;
+        }
+
+        size_t start = body, end = body;
+        for (size_t s = 0; s < segments && packet < 2; s++) {
+            end += page[27 + s];
+            if (page[27 + s] == 255) continue;
+            if (end > head.size) break;
+
+            const uint8_t* data = head.data + start;
+            size_t len = end - start;
+            if (spill) {
+                spill->append((const char*)data, len);
+                data = (const uint8_t*)spill->data();
+                len = spill->size();
+                spill = nullptr;
+            }
+
+            if (packet == 0) {
+                if (len >= 16 && std::memcmp(data, "\x01vorbis", 7) == 0) {
+                    rate = le32(data + 12);
+                } else if (len >= 19 && std::memcmp(data, "OpusHead", 8) == 0) {
+                    rate = 48000;
+                    preskip = le16(data + 10);
+                } else {
+                    return false;
+                }
+            } else if (len >= 7 && std::memcmp(data, "\x03vorbis", 7) == 0) {
+                parseVorbisComments(data + 7, len - 7, out);
+            } else if (len >= 8 && std::memcmp(data, "OpusTags", 8) == 0) {
+                parseVorbisComments(data + 8, len - 8, out);
+            }
+            packet++;
+            start = end;
+        }
+        if (packet >= 2) break;
+
+        size_t have = std::min(end, head.size);
+        if (have > start) {
+            if (!spill) {
+                owned.emplace_back();
+                spill = &owned.back();
+            }
+            spill->append((const char*)head.data + start, have - start);
+        }
+        if (end > head.size) {
+            // Capped: parse what was gathered (the text fields come first)
+            if (packet == 1 && spill && spill->size() > 8) {
+                const uint8_t* data = (const uint8_t*)spill->data();
+                size_t skip = (std::memcmp(data, "OpusTags", 8) == 0) ? 8 : 7;
+                parseVorbisComments(data + skip, spill->size() - skip, out);
+            }
+            break;
+        }
+        pos = end;
+    }
+    if (rate == 0) return packet > 0;
+
+    // Last page of this stream carries the total granule position
+    size_t tailLen = (size_t)std::min<uint64_t>(file_size, OGG_TAIL_SIZE);
+    Span tail = map(file_size - tailLen, tailLen);
+    for (size_t i = tail.size >= 27 ? tail.size - 27 + 1 : 0; i-- > 0;) {
+        const uint8_t* page = tail.data + i;
+        if (page[0] != 'O' || std::memcmp(page, "OggS", 4) != 0) continue;
+        if (le32(page + 14) != serial) continue;
+        uint64_t granule = le64(page + 6);
+        if (granule == ~0ull) continue;
+        if (granule > preskip) out->duration = (double)(granule - preskip) / rate;
+        break;
+    }
+    return true;
+}
+
+// --- MP4 ---
+namespace {
+
+// Calls fn(type, body, length) for each child atom in [p, p + n)
+template <typename Fn> void forEachAtom(const uint8_t* p, size_t n, Fn fn) {
+    size_t pos = 0;
+    while (pos + 8 <= n) {
+        uint64_t size = be32(p + pos);
+        size_t header = 8;
+        if (size == 1) {
+            if (pos + 16 > n) return;
+            size = be64(p + pos + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = n - pos;
+        }
+        if (size < header || size > n - pos) return;
+        fn(p + pos + 4, p + pos + header, (size_t)size - header);
+        pos += size;
+    }
+}
+
+inline bool is(const uint8_t* type, const char* name) {
+    return std::memcmp(type, name, 4) == 0;
+}
+
+} // namespace
+
+// Atom headers are read with pread until moov turns up (it can sit after
+// mdat); only moov itself is mapped.
+bool TagReader::parseMp4(TagView* out) {
+    uint64_t pos = 0;
+    Span moov;
+    while (pos + 8 <= file_size) {
+        uint8_t h[16];
+        if (pread(fd, h, sizeof(h), (off_t)pos) < 8) return false;
+        uint64_t size = be32(h);
+        uint64_t header = 8;
+        if (size == 1) {
+            size = be64(h + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = file_size - pos;
+        }
+        if (size < header) return false;
+        if (is(h + 4, "moov")) {
+            if (size - header > MAX_MOOV) return false;
+            moov = map(pos + header, (size_t)(size - header));
+            break;
+        }
+        pos += size;
+    }
+    if (!moov.data) return false;
+
+    auto item = [&](const uint8_t* body, size_t len, std::string_view* dst) {
+        if (!dst->empty()) return;
+        forEachAtom(body, len, [&](const uint8_t* type, const uint8_t* data, size_t n) {
+            // data atom: type indicator (1 = UTF-8), locale, value
+            if (is(type, "data") && n > 8 && be32(data) == 1) *dst = trim(data + 8, n - 8);
+        });
+    };
+
+    auto ilst = [&](const uint8_t* p, size_t n) {
+        forEachAtom(p, n, [&](const uint8_t* type, const uint8_t* body, size_t len) {
+            if (is(type, "\xa9nam")) item(body, len, &out->title);
+            else if (is(type, "\xa9" "ART")) item(body, len, &out->artist);
+            else if (is(type, "\xa9" "alb")) item(body, len, &out->album);
+            else if (is(type, "aART") && out->artist.empty()) item(body, len, &out->artist);
+        });
+    };
+
+    auto meta = [&](const uint8_t* p, size_t n) {
+        // ISO meta is a full box (version + flags); QuickTime's is not.
+        // Too short for either header: nothing to read
+        if (n < 8) return;
+        if (n >= 12 && !is(p + 8, "hdlr") && !is(p + 4, "hdlr")) return;
+        size_t skip = std::min<size_t>(is(p + 4, "hdlr") ? 0 : 4, n);
+        forEachAtom(p + skip, n - skip, [&](const uint8_t* type, const uint8_t* body, size_t len) {
+            if (is(type, "ilst")) ilst(body, len);
+        });
+    };
+
+    forEachAtom(moov.data, moov.size, [&](const uint8_t* type, const uint8_t* body, size_t len) {
+        if (is(type, "mvhd") && len >= 20) {
+            uint32_t timescale;
+            uint64_t duration;
+            if (body[0] == 1 && len >= 32) {
+                timescale = be32(body + 20);
+                duration = be64(body + 24);
+            } else {
+                timescale = be32(body + 12);
+                duration = be32(body + 16);
+            }
+            if (timescale > 0) out->duration = (double)duration / timescale;
+        } else if (is(type, "udta")) {
+            forEachAtom(body, len, [&](const uint8_t* t, const uint8_t* b, size_t l) {
+                if (is(t, "meta")) meta(b, l);
+            });
+        } else if (is(type, "meta")) {
+            meta(body, len);
+        }
+    });
+    return true;
+}
+
+// --- WAV ---
+bool TagReader::parseWav(Span& head, TagView* out) {
+    uint32_t byteRate = 0;
+    uint64_t dataSize = 0;
+    size_t pos = 12;
+    while (pos + 8 <= head.size) {
+        const uint8_t* c = head.data + pos;
+        size_t len = le32(c + 4);
+        size_t body = pos + 8;
+
+        if (std::memcmp(c, "fmt ", 4) == 0 && body + 12 <= head.size) {
+            byteRate = le32(head.data + body + 8);
+        } else if (std::memcmp(c, "data", 4) == 0) {
+            dataSize = std::min<uint64_t>(len, file_size - body);
+            break;   // LIST after data is rare; do not map the audio to find it
+        } else if (std::memcmp(c, "LIST", 4) == 0 && body + 4 <= head.size &&
+                   std::memcmp(head.data + body, "INFO", 4) == 0) {
+            size_t end = std::min(body + len, head.size);
+            for (size_t i = body + 4; i + 8 <= end;) {
+                const uint8_t* s = head.data + i;
+                size_t n = std::min<size_t>(le32(s + 4), end - i - 8);
+                std::string_view* field = nullptr;
+                if (std::memcmp(s, "INAM", 4) == 0) field = &out->title;
+                else if (std::memcmp(s, "IART", 4) == 0) field = &out->artist;
+                else if (std::memcmp(s, "IPRD", 4) == 0) field = &out->album;
+                if (field) *field = latin1(s + 8, n);
+                i += 8 + n + (n & 1);
+            }
+        }
+        pos = body + len + (len & 1);
+    }
+    if (byteRate > 0) out->duration = (double)dataSize / byteRate;
+    return true;
+}
+
+// --- POOL ---
+TagPool::TagPool(TagResultCallback cb, void* data, unsigned threads) : onResults(cb), resultData(data) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min(threads, MAX_THREADS));
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back(&TagPool::run, this);
+}
+
+TagPool::~TagPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    work.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void TagPool::submit(std::vector<TagJob>& jobs) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& job : jobs) queue.push_back(std::move(job));
+    }
+    jobs.clear();
+    work.notify_all();
+}
+
+void TagPool::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    if (active == 0) idle.notify_all();
+}
+
+void TagPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return queue.empty() && active == 0; });
+}
+
+void TagPool::run() {
+    TagReader reader;
+    TagView view;
+    std::vector<TagJob> jobs;
+    std::vector<TagResult> batch;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        work.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+
+        size_t n = std::min(queue.size(), BATCH);
+        for (size_t i = 0; i < n; i++) {
+            jobs.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        active++;
+        lock.unlock();
+
+        batch.reserve(jobs.size());
+        for (TagJob& job : jobs) {
+            TagResult result;
+            result.index = job.index;
+            // Known and untouched since: a stat instead of a read
+            struct stat st;
+            if (job.known.size > 0 && stat(job.path.c_str(), &st) == 0 &&
+                job.known.sameFile(stampOf(st))) {
+                result.unchanged = true;
+            } else {
+                if (reader.read(job.path, &view)) result.info = view.toInfo();
+                result.stamp = view.stamp;
+            }
+            result.path = std::move(job.path);
+            batch.push_back(std::move(result));
+        }
+        jobs.clear();
+        onResults(resultData, batch);
+        batch.clear();
+
+        lock.lock();
+        active--;
+        if (active == 0 && queue.empty()) idle.notify_all();
+    }
+}
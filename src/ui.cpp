@@ -2,6 +2,7 @@
 #include <iostream>      
 #include <iomanip>      
 #include <sstream>      
+#include <cstdio>
       
 // --- CONSTANTS ---      
 const int FULL_WIDTH = 320;      
@@ -11,10 +12,13 @@ const int MINI_HEIGHT_REPURPOSED = 180;
       
 UI::UI(int argc, char** argv) {      
     gtk_init(&argc, &argv);      
+    Utils::startupMark("gtk_init");
+    // Whatever GTK did not consume: files, folders, playlists      
+    for (int i = 1; i < argc; i++) startupPaths.push_back(argv[i]);      
     player = nullptr;      
     playlistMgr = nullptr;      
     visualizer = nullptr;      
-    playlistBox = nullptr;      
+    playlistView = nullptr;      
     drawingArea = nullptr;      
           
     // REFACTOR: Load resources via Utils      
@@ -22,7 +26,7 @@ UI::UI(int argc, char** argv) {
 }      
       
 UI::~UI() {      
-    if (playlistBox) g_object_unref(playlistBox);      
+    if (playlistView) g_object_unref(playlistView);      
     if (drawingArea) g_object_unref(drawingArea);      
     if (playlistMgr) delete playlistMgr;      
     if (visualizer) delete visualizer;      
@@ -74,17 +78,19 @@ void UI::onAboutClicked(GtkMenuItem* item, gpointer data) {
 void UI::toggleMiniMode(bool force_resize) {      
     is_mini_mode = !is_mini_mode;      
       
-    GtkWidget* scrolled = gtk_widget_get_parent(playlistBox);      
+    GtkWidget* scrolled = gtk_widget_get_parent(playlistView);      
     if (!scrolled) scrolled = gtk_widget_get_parent(drawingArea);      
       
     if (is_mini_mode) {      
         g_object_ref(drawingArea);      
-        g_object_ref(playlistBox);      
+        g_object_ref(playlistView);      
       
         gtk_container_remove(GTK_CONTAINER(visualizerContainerBox), drawingArea);      
         gtk_widget_hide(visualizerContainerBox);       
+        gtk_widget_hide(playlistBox);
+        gtk_widget_hide(searchEntry);
       
-        gtk_container_remove(GTK_CONTAINER(scrolled), playlistBox);      
+        gtk_container_remove(GTK_CONTAINER(scrolled), playlistView);      
         gtk_container_add(GTK_CONTAINER(scrolled), drawingArea);      
         gtk_widget_set_size_request(drawingArea, FULL_WIDTH, 120);       
         gtk_widget_show(drawingArea);      
@@ -93,14 +99,14 @@ void UI::toggleMiniMode(bool force_resize) {
         gtk_window_resize(GTK_WINDOW(window), FULL_WIDTH, MINI_HEIGHT_REPURPOSED);      
         gtk_button_set_label(GTK_BUTTON(btnMiniMode), "F");      
         g_object_unref(drawingArea);      
-        g_object_unref(playlistBox);      
+        g_object_unref(playlistView);      
     } else {      
         g_object_ref(drawingArea);      
-        g_object_ref(playlistBox);      
+        g_object_ref(playlistView);      
       
         gtk_container_remove(GTK_CONTAINER(scrolled), drawingArea);      
-        gtk_container_add(GTK_CONTAINER(scrolled), playlistBox);      
-        gtk_widget_show(playlistBox);      
+        gtk_container_add(GTK_CONTAINER(scrolled), playlistView);      
+        gtk_widget_show(playlistView);      
               
         gtk_box_pack_start(GTK_BOX(visualizerContainerBox), drawingArea, FALSE, FALSE, 0);      
         gtk_box_reorder_child(GTK_BOX(visualizerContainerBox), drawingArea, 0);      
@@ -108,16 +114,36 @@ void UI::toggleMiniMode(bool force_resize) {
         gtk_widget_set_size_request(drawingArea, -1, VISUALIZER_FULL_HEIGHT);      
         gtk_widget_show(visualizerContainerBox);      
         gtk_widget_show(drawingArea);      
+        gtk_widget_show(playlistBox);
+        gtk_widget_show(searchEntry);
       
         gtk_window_set_default_size(GTK_WINDOW(window), FULL_WIDTH, FULL_HEIGHT_INIT);      
         gtk_window_resize(GTK_WINDOW(window), FULL_WIDTH, FULL_HEIGHT_INIT);      
         gtk_button_set_label(GTK_BUTTON(btnMiniMode), "M");      
         g_object_unref(drawingArea);      
-        g_object_unref(playlistBox);      
+        g_object_unref(playlistView);      
     }      
 }      
       
-void UI::onMiniModeClicked(GtkButton* btn, gpointer data) { ((UI*)data)->toggleMiniMode(); }      
+void UI::onMiniModeClicked(GtkButton* btn, gpointer data) { ((UI*)data)->toggleMiniMode(); }
+void UI::onImportCancelClicked(GtkButton* btn, gpointer data) { ((UI*)data)->playlistMgr->cancelImport(); }
+void UI::onSearchChanged(GtkEditable* editable, gpointer data) {
+    ((UI*)data)->playlistMgr->setFilter(gtk_entry_get_text(GTK_ENTRY(editable)));
+}
+
+void UI::onImportProgress(void* data) {
+    UI* ui = (UI*)data;
+    // The playlist's total grows as rows land
+    ui->refreshStatus();
+    if (!ui->playlistMgr->importing()) {
+        gtk_widget_hide(ui->importBar);
+        return;
+    }
+    std::string text = "Importing... " + std::to_string(ui->playlistMgr->importedCount()) + " tracks";
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(ui->importProgress), text.c_str());
+    gtk_progress_bar_pulse(GTK_PROGRESS_BAR(ui->importProgress));
+    gtk_widget_show(ui->importBar);
+}      
 void UI::onPlayClicked(GtkButton* b, gpointer d) {       
     UI* ui = (UI*)d;      
     if (ui->appState.playlist.empty()) return;      
@@ -132,10 +158,10 @@ void UI::onPlayClicked(GtkButton* b, gpointer d) {
     if (ui->appState.current_track_idx == -1) {      
         ui->appState.current_track_idx = 0;      
         size_t idx = (!ui->appState.play_order.empty()) ? ui->appState.play_order[0] : 0;      
-        ui->player->load(ui->appState.playlist[idx]);      
+        ui->player->load(ui->appState.paths.path(ui->appState.playlist[idx]));      
     } else {      
         size_t idx = ui->appState.play_order[ui->appState.current_track_idx];      
-        ui->player->load(ui->appState.playlist[idx]);      
+        ui->player->load(ui->appState.paths.path(ui->appState.playlist[idx]));      
     }      
     ui->player->play();       
 }      
@@ -177,52 +203,203 @@ gboolean UI::onSeekRelease(GtkWidget* w, GdkEvent* e, gpointer d) {
     UI* ui = (UI*)d; ui->isSeeking = false;       
     ui->player->seek(gtk_range_get_value(GTK_RANGE(ui->seekScale))); return FALSE;       
 }      
+// Drags, wheel and key repeat all scrub; the player coalesces them and      
+// finishes with one accurate seek (release, or when the requests settle)      
 void UI::onSeekChanged(GtkRange* range, gpointer data) {      
     UI* ui = (UI*)data;       
-    if (!ui->isSeeking) ui->player->seek(gtk_range_get_value(range));       
+    ui->player->seek(gtk_range_get_value(range), true);       
 }      
-gboolean UI::onUpdateTick(gpointer data) {      
-    UI* ui = (UI*)data;      
-    if (!ui->player) return TRUE;      
-      
-    if (ui->appState.playing) {      
-        if (ui->window && gtk_widget_get_visible(ui->window)) {      
-            gtk_widget_queue_draw(ui->drawingArea);      
-        }      
-        double current = ui->player->getPosition();      
-        double duration = ui->player->getDuration();      
-        if (!ui->isSeeking && duration > 0) {      
-            g_signal_handlers_block_by_func(ui->seekScale, (void*)onSeekChanged, ui);      
-            gtk_range_set_range(GTK_RANGE(ui->seekScale), 0, duration);      
-            gtk_range_set_value(GTK_RANGE(ui->seekScale), current);      
-            g_signal_handlers_unblock_by_func(ui->seekScale, (void*)onSeekChanged, ui);      
+
+// Playlist bar: a drag only acts on release, since crossing tracks loads
+// a file; wheel and keys act at once
+gboolean UI::onPlaylistSeekPress(GtkWidget* w, GdkEvent* e, gpointer d) { ((UI*)d)->isPlaylistSeeking = true; return FALSE; }
+gboolean UI::onPlaylistSeekRelease(GtkWidget* w, GdkEvent* e, gpointer d) {
+    UI* ui = (UI*)d; ui->isPlaylistSeeking = false;
+    ui->playlistMgr->seekPlaylist(gtk_range_get_value(GTK_RANGE(ui->playlistScale)));
+    return FALSE;
+}
+void UI::onPlaylistSeekChanged(GtkRange* range, gpointer data) {
+    UI* ui = (UI*)data;
+    if (!ui->isPlaylistSeeking) ui->playlistMgr->seekPlaylist(gtk_range_get_value(range));
+}
+
+static std::string formatHours(double seconds) {
+    int total = (int)seconds;
+    char buf[32];
+    if (total >= 3600) std::snprintf(buf, sizeof(buf), "%d:%02d:%02d", total / 3600, total / 60 % 60, total % 60);
+    else std::snprintf(buf, sizeof(buf), "%d:%02d", total / 60, total % 60);
+    return buf;
+}
+// --- STATUS (event-driven) ---      
+// Updates the info label and seek bar, touching widgets only when the      
+// displayed value actually changed.      
+void UI::refreshStatus() {      
+    if (!player || !playlistMgr) return;      
+    std::string info;      
+    if (appState.playing) {      
+        double current = player->getPosition();      
+        double duration = player->getDuration();      
+        if (!isSeeking && duration > 0 && ((int)current != shownPosition || duration != shownDuration)) {      
+            g_signal_handlers_block_by_func(seekScale, (void*)onSeekChanged, this);      
+            if (duration != shownDuration) gtk_range_set_range(GTK_RANGE(seekScale), 0, duration);      
+            gtk_range_set_value(GTK_RANGE(seekScale), current);      
+            g_signal_handlers_unblock_by_func(seekScale, (void*)onSeekChanged, this);      
+            shownPosition = (int)current;      
+            shownDuration = duration;      
         }      
         int cM = (int)current / 60; int cS = (int)current % 60;      
         int dM = (int)duration / 60; int dS = (int)duration % 60;      
         std::ostringstream oss;      
-        oss << ui->appState.current_track_name << " ("       
-            << std::setfill('0') << std::setw(2) << cM << ":" << std::setw(2) << cS       
-            << " / "       
+        oss << appState.current_track_name << " ("      
+            << std::setfill('0') << std::setw(2) << cM << ":" << std::setw(2) << cS      
+            << " / "      
             << std::setw(2) << dM << ":" << std::setw(2) << dS << ")";      
-        gtk_label_set_text(GTK_LABEL(ui->lblInfo), oss.str().c_str());      
-    } else if (!ui->appState.playlist.empty() && ui->appState.current_track_idx != -1) {      
-        gtk_label_set_text(GTK_LABEL(ui->lblInfo), ui->appState.current_track_name.c_str());      
+        info = oss.str();      
+    } else if (!appState.playlist.empty() && appState.current_track_idx != -1) {      
+        info = appState.current_track_name;      
     } else {      
-        gtk_label_set_text(GTK_LABEL(ui->lblInfo), "Ready");      
+        info = "Ready";      
+    }      
+    if (info != shownInfo) {      
+        gtk_label_set_text(GTK_LABEL(lblInfo), info.c_str());      
+        shownInfo = info;      
+    }      
+
+    // Whole playlist: remaining / total, from the durations known so far
+    double elapsed = 0, total = 0;
+    if (!playlistMgr->playlistTime(&elapsed, &total)) total = 0;
+    if (total != shownPlaylistTotal || (int)elapsed != shownPlaylistElapsed) {
+        if (!isPlaylistSeeking) {
+            g_signal_handlers_block_by_func(playlistScale, (void*)onPlaylistSeekChanged, this);
+            if (total != shownPlaylistTotal) gtk_range_set_range(GTK_RANGE(playlistScale), 0, total > 0 ? total : 1);
+            gtk_range_set_value(GTK_RANGE(playlistScale), elapsed);
+            g_signal_handlers_unblock_by_func(playlistScale, (void*)onPlaylistSeekChanged, this);
+        }
+        std::string text = total > 0 ? "-" + formatHours(total - elapsed) + " / " + formatHours(total) : "";
+        gtk_label_set_text(GTK_LABEL(lblPlaylistTime), text.c_str());
+        shownPlaylistTotal = total;
+        shownPlaylistElapsed = (int)elapsed;
+    }
+}      
+      
+// One-shot timer armed for the next whole second of playback, only while      
+// playing and not minimized. Stopped or hidden means no wakeups at all.      
+void UI::scheduleTick() {      
+    if (tickSource) {      
+        g_source_remove(tickSource);      
+        tickSource = 0;      
     }      
-    return TRUE;      
+    if (!player || !appState.playing || minimized) return;      
+      
+    double pos = player->getPosition();      
+    guint delay = (guint)((1.0 - (pos - (int)pos)) * 1000.0) + 5;      
+    tickSource = g_timeout_add(delay, onUpdateTick, this);      
 }      
+      
+gboolean UI::onUpdateTick(gpointer data) {      
+    UI* ui = (UI*)data;      
+    ui->tickSource = 0;      
+    Utils::countWakeup();      
+    ui->refreshStatus();      
+    ui->scheduleTick();      
+    return G_SOURCE_REMOVE;      
+}      
+      
+void UI::onPlayerEvent(void* data) {      
+    UI* ui = (UI*)data;      
+    if (!ui->engineControls.empty() && ui->player->isReady()) {
+        for (GtkWidget* widget : ui->engineControls) gtk_widget_set_sensitive(widget, TRUE);
+        ui->engineControls.clear();
+    }
+    ui->refreshStatus();      
+    ui->scheduleTick();      
+    // Flat line on pause/stop; while playing the analyzer drives redraws      
+    if (!ui->appState.playing) gtk_widget_queue_draw(ui->drawingArea);      
+      
+    if (Utils::statsEnabled() && ui->appState.playing != ui->statsPlaying) {      
+        ui->reportStats();      
+        ui->statsPlaying = ui->appState.playing;      
+    }      
+}      
+      
+gboolean UI::onFirstDraw(GtkWidget* widget, cairo_t* cr, gpointer data) {
+    Utils::startupMark("first frame");
+    g_signal_handlers_disconnect_by_func(widget, (gpointer)onFirstDraw, data);
+    return FALSE;
+}
+
+gboolean UI::onWindowState(GtkWidget* widget, GdkEventWindowState* event, gpointer data) {      
+    UI* ui = (UI*)data;      
+    ui->minimized = (event->new_window_state & GDK_WINDOW_STATE_ICONIFIED) != 0;      
+    ui->visualizer->setActive(!ui->minimized);      
+    if (!ui->minimized) ui->refreshStatus();      
+    ui->scheduleTick();      
+    return FALSE;      
+}      
+      
+// Wakeups and CPU over the period that just ended (playing or idle)      
+void UI::reportStats() {      
+    gint64 now = g_get_monotonic_time();      
+    double cpu = Utils::cpuSeconds();      
+    unsigned long long wakeups = Utils::wakeups();      
+    double secs = (now - statsSince) / 1e6;      
+    if (secs > 0.5) {      
+        std::cerr << "[UI] " << (statsPlaying ? "Playing" : "Idle") << " for " << std::fixed << std::setprecision(1)      
+                  << secs << " s: " << (wakeups - statsWakeups) / secs << " wakeups/s, CPU "      
+                  << (cpu - statsCpu) / secs * 100.0 << "%" << std::endl;      
+    }      
+    statsSince = now;      
+    statsCpu = cpu;      
+    statsWakeups = wakeups;      
+}      
+      
 gboolean UI::onKeyPress(GtkWidget* widget, GdkEventKey* event, gpointer data) {      
     UI* ui = (UI*)data;      
+    // Typing a query: only the keys that leave the search box are ours
+    if (gtk_widget_has_focus(ui->searchEntry)) {
+        switch (event->keyval) {
+            case GDK_KEY_Escape:
+                gtk_entry_set_text(GTK_ENTRY(ui->searchEntry), "");
+                gtk_widget_grab_focus(ui->playlistView);
+                return TRUE;
+            case GDK_KEY_Down:
+                gtk_widget_grab_focus(ui->playlistView);
+                return TRUE;
+            case GDK_KEY_Return:
+                gtk_widget_grab_focus(ui->playlistView);
+                ui->playlistMgr->activateSelected();
+                return TRUE;
+        }
+        return FALSE;
+    }
+    bool find = event->keyval == GDK_KEY_slash ||
+                ((event->state & GDK_CONTROL_MASK) && (event->keyval == GDK_KEY_f || event->keyval == GDK_KEY_F));
+    if (find && !ui->is_mini_mode) {
+        gtk_widget_grab_focus(ui->searchEntry);
+        return TRUE;
+    }
     switch (event->keyval) {      
         case GDK_KEY_Up: ui->playlistMgr->selectPrev(); return TRUE;      
         case GDK_KEY_Down: ui->playlistMgr->selectNext(); return TRUE;      
         case GDK_KEY_Delete: ui->playlistMgr->deleteSelected(); return TRUE;      
+        case GDK_KEY_q:
+        case GDK_KEY_Q: ui->playlistMgr->playSelectedNext(); return TRUE;
+        case GDK_KEY_Escape:
+            if (ui->playlistMgr->importing()) {
+                ui->playlistMgr->cancelImport();
+                return TRUE;
+            }
+            if (!ui->playlistMgr->filtering()) return FALSE;
+            gtk_entry_set_text(GTK_ENTRY(ui->searchEntry), "");
+            return TRUE;
         case GDK_KEY_space: if(ui->appState.playing) ui->player->pause(); else UI::onPlayClicked(NULL, ui); return TRUE;      
         case GDK_KEY_M: ui->toggleMiniMode(); return TRUE;       
+        case GDK_KEY_G:      
+            ui->appState.gapless = !ui->appState.gapless;      
+            ui->player->refreshNext();      
+            return TRUE;      
         case GDK_KEY_Return: {      
-             GtkListBoxRow* row = gtk_list_box_get_selected_row(GTK_LIST_BOX(ui->playlistBox));      
-             if(row) ui->playlistMgr->onRowActivated(GTK_LIST_BOX(ui->playlistBox), row);      
+             ui->playlistMgr->activateSelected();      
              return TRUE;      
         }      
     }      
@@ -242,6 +419,7 @@ void UI::buildWidgets() {
       
     g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);      
     g_signal_connect(window, "key-press-event", G_CALLBACK(onKeyPress), this);      
+    g_signal_connect(window, "window-state-event", G_CALLBACK(onWindowState), this);      
       
     GtkWidget* mainBox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);      
     gtk_container_set_border_width(GTK_CONTAINER(mainBox), 5);      
@@ -310,6 +488,18 @@ void UI::buildWidgets() {
     g_signal_connect(seekScale, "button-press-event", G_CALLBACK(onSeekPress), this);      
     g_signal_connect(seekScale, "button-release-event", G_CALLBACK(onSeekRelease), this);      
     g_signal_connect(seekScale, "value-changed", G_CALLBACK(onSeekChanged), this);      
+
+    playlistBox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    playlistScale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0, 1, 1);
+    gtk_scale_set_draw_value(GTK_SCALE(playlistScale), FALSE);
+    gtk_widget_set_hexpand(playlistScale, TRUE);
+    lblPlaylistTime = gtk_label_new("");
+    gtk_box_pack_start(GTK_BOX(playlistBox), playlistScale, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(playlistBox), lblPlaylistTime, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(mainBox), playlistBox, FALSE, FALSE, 2);
+    g_signal_connect(playlistScale, "button-press-event", G_CALLBACK(onPlaylistSeekPress), this);
+    g_signal_connect(playlistScale, "button-release-event", G_CALLBACK(onPlaylistSeekRelease), this);
+    g_signal_connect(playlistScale, "value-changed", G_CALLBACK(onPlaylistSeekChanged), this);
       
     GtkWidget* volBox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);      
     GtkWidget* lblVol = gtk_label_new("Vol:");      
@@ -346,14 +536,39 @@ void UI::buildWidgets() {
     gtk_box_pack_start(GTK_BOX(controlsBox), btnClear, TRUE, TRUE, 0);      
       
     gtk_box_pack_start(GTK_BOX(mainBox), controlsBox, FALSE, FALSE, 2);      
+    // Usable while GStreamer loads: the playlist, adding files, modes.
+    // Keys and row activation still queue playback for when it is ready.
+    engineControls = {btnPrev, btnPlay, btnPause, btnStop, btnNext, seekScale, playlistScale};
+    for (GtkWidget* widget : engineControls) gtk_widget_set_sensitive(widget, FALSE);
+
+    searchEntry = gtk_search_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(searchEntry), "Search playlist");
+    gtk_box_pack_start(GTK_BOX(mainBox), searchEntry, FALSE, FALSE, 2);
+    // Every keystroke, not the delayed search-changed
+    g_signal_connect(searchEntry, "changed", G_CALLBACK(onSearchChanged), this);
       
     GtkWidget* scrolled = gtk_scrolled_window_new(NULL, NULL);      
     gtk_widget_set_vexpand(scrolled, TRUE);       
     gtk_scrolled_window_set_min_content_height(GTK_SCROLLED_WINDOW(scrolled), 150);       
-    playlistBox = gtk_list_box_new();      
-    g_object_ref(playlistBox);       
-    gtk_container_add(GTK_CONTAINER(scrolled), playlistBox);      
+    playlistView = gtk_tree_view_new();      
+    g_object_ref(playlistView);       
+    gtk_container_add(GTK_CONTAINER(scrolled), playlistView);      
     gtk_box_pack_start(GTK_BOX(mainBox), scrolled, TRUE, TRUE, 0);      
+
+    // Import progress: pulses as batches land, with a cancel button
+    importBar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 2);
+    importProgress = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(importProgress), TRUE);
+    gtk_widget_set_hexpand(importProgress, TRUE);
+    gtk_widget_set_valign(importProgress, GTK_ALIGN_CENTER);
+    GtkWidget* btnImportCancel = gtk_button_new_with_label("x");
+    gtk_box_pack_start(GTK_BOX(importBar), importProgress, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(importBar), btnImportCancel, FALSE, FALSE, 0);
+    gtk_widget_show(importProgress);
+    gtk_widget_show(btnImportCancel);
+    gtk_widget_set_no_show_all(importBar, TRUE);
+    gtk_box_pack_start(GTK_BOX(mainBox), importBar, FALSE, FALSE, 2);
+    g_signal_connect(btnImportCancel, "clicked", G_CALLBACK(onImportCancelClicked), this);
       
     g_signal_connect(btnPlay, "clicked", G_CALLBACK(onPlayClicked), this);      
     g_signal_connect(btnPause, "clicked", G_CALLBACK(onPauseClicked), this);      
@@ -372,13 +587,28 @@ int UI::run() {
     player = new Player(&appState);      
     visualizer = new Visualizer(&appState);       
     buildWidgets();       
-    playlistMgr = new PlaylistManager(&appState, player, playlistBox);      
+    playlistMgr = new PlaylistManager(&appState, player, playlistView);      
     player->setEOSCallback([](void* data){ ((PlaylistManager*)data)->autoAdvance(); }, playlistMgr);      
-    g_signal_connect(playlistBox, "row-activated", G_CALLBACK(+[](GtkListBox* b, GtkListBoxRow* r, gpointer d){      
-        ((PlaylistManager*)d)->onRowActivated(b, r);      
+    player->setTrackCallbacks(      
+        [](void* data, std::string* path){ return ((PlaylistManager*)data)->peekNextPath(path); },      
+        [](void* data, std::string* path){ return ((PlaylistManager*)data)->peekSkipPath(path); },      
+        [](void* data){ ((PlaylistManager*)data)->commitGaplessAdvance(); },      
+        playlistMgr);      
+    player->setPcmCallback(Visualizer::onPcm, visualizer);      
+    g_signal_connect(playlistView, "row-activated", G_CALLBACK(+[](GtkTreeView* v, GtkTreePath* p, GtkTreeViewColumn* c, gpointer d){      
+        ((PlaylistManager*)d)->onRowActivated(gtk_tree_path_get_indices(p)[0]);      
     }), playlistMgr);      
-    g_timeout_add(100, onUpdateTick, this);      
+    player->setEventCallback(onPlayerEvent, this);      
+    playlistMgr->setImportCallback(onImportProgress, this);
+    // Imported in the background; the first row plays as soon as it arrives
+    if (!startupPaths.empty()) playlistMgr->addPaths(startupPaths, true);
+    visualizer->setWidget(drawingArea);      
+    statsSince = g_get_monotonic_time();      
+    statsCpu = Utils::cpuSeconds();      
+    if (Utils::statsEnabled()) g_signal_connect_after(window, "draw", G_CALLBACK(onFirstDraw), this);
     gtk_widget_show_all(window);      
+    // Keys start out as shortcuts, not a query
+    gtk_widget_grab_focus(playlistView);
     gtk_main();      
     return 0;      
 }
@@ -3,6 +3,11 @@
 #include <limits.h>
 #include <unistd.h>
 #include <cstdlib>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/resource.h>
 
 std::string Utils::getResourcePath(const std::string& assetName) {
     // 1. Check standard Termux prefix
@@ -70,3 +75,65 @@ GtkWidget* Utils::createLogoImage(int size) {
     g_object_unref(pixbuf);
     return img;
 }
+
+bool Utils::statsEnabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("TERMAMP_STATS");
+        return env && *env && std::string(env) != "0";
+    }();
+    return enabled;
+}
+
+static std::atomic<unsigned long long> wakeupCount{0};
+
+void Utils::countWakeup() {
+    wakeupCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned long long Utils::wakeups() {
+    return wakeupCount.load(std::memory_order_relaxed);
+}
+
+double Utils::cpuSeconds() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Milliseconds since the kernel started this process, -1 if unknown.
+// /proc/self/stat gives the start in clock ticks since boot (10 ms on
+// most kernels), which CLOCK_BOOTTIME is measured from.
+static double processAgeMs() {
+    FILE* f = std::fopen("/proc/self/stat", "r");
+    if (!f) return -1;
+    char buf[1024];
+    size_t n = std::fread(buf, 1, sizeof(buf) - 1, f);
+    std::fclose(f);
+    buf[n] = 0;
+    // The command name may hold spaces: count fields from its closing ')'.
+    // Field 2 ends there, the start time is field 22.
+    const char* p = std::strrchr(buf, ')');
+    if (!p) return -1;
+    int spaces = 0;
+    for (p++; *p && spaces < 20; p++) {
+        if (*p == ' ') spaces++;
+    }
+    if (!*p) return -1;
+    double start = std::strtoull(p, NULL, 10) / (double)sysconf(_SC_CLK_TCK);
+    struct timespec now;
+    if (clock_gettime(CLOCK_BOOTTIME, &now) != 0) return -1;
+    return (now.tv_sec + now.tv_nsec / 1e9 - start) * 1000.0;
+}
+
+void Utils::startupMark(const char* milestone, const std::string& detail) {
+    if (!statsEnabled()) return;
+    // Without /proc, time is counted from the first milestone
+    static gint64 origin = g_get_monotonic_time();
+    static double last = 0;
+    double ms = processAgeMs();
+    if (ms < 0) ms = (g_get_monotonic_time() - origin) / 1000.0;
+    std::cerr << "[STARTUP] " << milestone << ": " << (long long)ms << " ms (+" << (long long)(ms - last) << ")"
+              << (detail.empty() ? "" : ", " + detail) << std::endl;
+    last = ms;
+}
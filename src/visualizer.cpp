@@ -1,9 +1,35 @@
 #include "visualizer.h"
+#include "utils.h"
 #include <cmath>
-#include <cstdlib>
 #include <gtk/gtk.h>
 
-Visualizer::Visualizer(AppState* state) : app(state) {}
+Visualizer::Visualizer(AppState* state) : app(state), spectrum(onFrame, this) {}
+
+void Visualizer::setWidget(GtkWidget* w) {
+    widget = w;
+}
+
+void Visualizer::setActive(bool value) {
+    active = value;
+}
+
+void Visualizer::onFrame(void* data) {
+    // One pending idle at a time; onDraw picks up whatever is newest
+    Visualizer* self = (Visualizer*)data;
+    if (!self->redraw_pending.exchange(true)) {
+        g_idle_add(onFrameIdle, self);
+    }
+}
+
+gboolean Visualizer::onFrameIdle(gpointer data) {
+    Visualizer* self = (Visualizer*)data;
+    self->redraw_pending = false;
+    Utils::countWakeup();
+    if (self->widget && gtk_widget_get_mapped(self->widget)) {
+        gtk_widget_queue_draw(self->widget);
+    }
+    return G_SOURCE_REMOVE;
+}
 
 gboolean Visualizer::onTick(gpointer widget) {
     if (GTK_IS_WIDGET(widget)) {
@@ -12,6 +38,13 @@ gboolean Visualizer::onTick(gpointer widget) {
     return G_SOURCE_CONTINUE;
 }
 
+void Visualizer::onPcm(void* data, const float* samples, size_t count, int rate) {
+    Visualizer* self = (Visualizer*)data;
+    if (self->active.load(std::memory_order_relaxed)) {
+        self->spectrum.push(samples, count, rate);
+    }
+}
+
 gboolean Visualizer::onDraw(GtkWidget* widget, cairo_t* cr, gpointer data) {
     // FIX: Cast data to Visualizer*, then access its 'app' member
     Visualizer* self = (Visualizer*)data;
@@ -40,14 +73,18 @@ gboolean Visualizer::onDraw(GtkWidget* widget, cairo_t* cr, gpointer data) {
         return FALSE;
     }
 
-    // 3. Draw Fake Visualization
+    // 3. Draw Spectrum (lock-free read of the analyzer's newest frame)
+    self->spectrum.latest(&self->frame);
+    const SpectrumFrame& frame = self->frame;
+
     cairo_set_source_rgb(cr, 0, 0.88, 0); 
     
-    int bars = 32;
+    int bars = SPECTRUM_BANDS;
     double barWidth = (double)width / bars;
+    double range = height - 4;
     
     for (int i = 0; i < bars; i++) {
-        double h = (rand() % (height - 4)) + 4;
+        double h = frame.level[i] * range;
         
         double x = i * barWidth + 1;
         double y = height - h;
@@ -56,8 +93,9 @@ gboolean Visualizer::onDraw(GtkWidget* widget, cairo_t* cr, gpointer data) {
         cairo_fill(cr);
         
         // Peak
+        double py = height - frame.peak[i] * range;
         cairo_set_source_rgb(cr, 0.8, 0.8, 0);
-        cairo_rectangle(cr, x, y - 3, barWidth - 2, 2);
+        cairo_rectangle(cr, x, py - 3, barWidth - 2, 2);
         cairo_fill(cr);
         
         cairo_set_source_rgb(cr, 0, 0.88, 0); 